@@ -1,600 +1,443 @@
+#include <algorithm>
+#include <thread>
 #include "Actions.h"
-#include <cmath>
+#include "balance.h"
+#include "deliverable.h"
+#include "contingency.h"
+#include "stats.h"
+#include "trace.h"
 
-Actions::Actions(vector<Reservoir> reservoirs_, vector<Station> stations_, vector<City> cities_, vector<Pipe> pipes_): reservoirs(reservoirs_), stations(stations_), cities(cities_), pipes(pipes_) {}
+Actions::Actions(vector<Reservoir> reservoirs_, vector<Station> stations_, vector<City> cities_, vector<Pipe> pipes_): reservoirs(reservoirs_), stations(stations_), cities(cities_), pipes(pipes_),
+    reservoirCodes(CodeDictionary::of(reservoirs)), stationCodes(CodeDictionary::of(stations)), cityCodes(CodeDictionary::of(cities)) {}
 
-///////////////////////////////////////////2.1///////////////////////////////////////////
-int Actions::maxFlowSpecificCity(Graph& g, std::string city) {
+ScenarioCache& Actions::getCache() {
+    return cache;
+}
 
-    int maxFlow = 0;
+const CodeDictionary& Actions::getReservoirCodes() const {
+    return reservoirCodes;
+}
 
-    g.addVertex("Si", VertexType::CITY, 20000);
-    g.addVertex("S", VertexType::RESERVOIR, 10000);
+const CodeDictionary& Actions::getStationCodes() const {
+    return stationCodes;
+}
 
-    for (auto it: g.getVertexSet()) {
-        if (it->isType(VertexType::CITY) && it->getInfo() != "Si") {
-            int demand =(int) cities[it->getId() - 1].getDemand();
-            g.addEdge(it->getInfo(), "Si", 1, demand);
-        }
-    }
+const CodeDictionary& Actions::getCityCodes() const {
+    return cityCodes;
+}
 
-    for (auto it: g.getVertexSet()) {
-        if (it->isType(VertexType::RESERVOIR) && it->getInfo() != "S") {
-            int max = reservoirs[it->getId() - 1].getMaxDelivery();
-            g.addEdge("S", it->getInfo(), 1, max);
+void Actions::useContingency(const ContingencyMatrix* matrix) {
+    contingency = matrix;
+}
+
+bool Actions::precomputed(const Graph& g) const {
+    return contingency != nullptr && g.getModifiedEdges().empty();
+}
+
+ScenarioCache::Entry Actions::solve(Graph& g) {
+    ScenarioCache::Key key;
+    {
+        STATS_PHASE(CACHE_LOOKUP);
+        key = {g.getVersion(), g.getModifiedEdges()};
+        if (const ScenarioCache::Entry* cached = cache.find(key)) {
+            g.setEdgeFlows(cached->edgeFlows);
+            return *cached;
         }
     }
 
-    g.edmondsKarp("S", "Si");
-
+    Trace::Scope scope("solve", key.modified.empty() ? "baseline" : to_string(key.modified.size()) + " capacities changed");
+    {
+        STATS_PHASE(SUPER_NODES);
+        g.addVertex("Si", VertexType::CITY, 20000);
+        g.addVertex("S", VertexType::RESERVOIR, 10000);
 
-    Vertex *v = g.findVertex(city);
+        for (auto it: g.getVertexSet()) {
+            if (it->isType(VertexType::CITY) && it->getInfo() != "Si") {
+                int demand =(int) cities[it->getId() - 1].getDemand();
+                g.addEdge(it->getInfo(), "Si", 1, demand);
+            }
+        }
 
-    for (Edge *edge: v->getPath()) {
-        maxFlow += edge->getFlow();
+        for (auto it: g.getVertexSet()) {
+            if (it->isType(VertexType::RESERVOIR) && it->getInfo() != "S") {
+                int max = reservoirs[it->getId() - 1].getMaxDelivery();
+                g.addEdge("S", it->getInfo(), 1, max);
+            }
+        }
     }
 
-    g.removeVertex("Si");
-    g.removeVertex("S");
+    g.edmondsKarp("S", "Si");
 
+    {
+        STATS_PHASE(SUPER_NODES);
+        g.removeVertex("Si");
+        g.removeVertex("S");
+        // The graph is back to what it was before the super source and sink were added
+        g.setVersion(key.version);
+    }
 
-    return maxFlow;
+    STATS_PHASE(READ_FLOWS);
+    ScenarioCache::Entry entry;
+    entry.cityFlows.assign(cities.size(), 0);
+    for (auto it: g.getVertexSet()) {
+        if (it->isType(VertexType::CITY)) {
+            entry.cityFlows[it->getId() - 1] = it->getInflow();
+        }
+    }
+    entry.edgeFlows = g.getEdgeFlows();
+    cache.insert(key, entry);
+    return entry;
 }
 
-map<string, int> Actions::maxFlowAllCities(Graph& g) {
-    map<string, int> City_flow;
-    for(auto c:cities){
-        int flow = maxFlowSpecificCity(g,c.getCode());
-        City_flow[c.getCode()] = flow;
+///////////////////////////////////////////2.1///////////////////////////////////////////
+int Actions::maxFlowSpecificCity(Graph& g, std::string city) {
+    STATS_PHASE(MAX_FLOW);
+    int index = cityCodes.find(city);
+    if (index < 0) {
+        return -1;
     }
-    return City_flow;
+    return solve(g).cityFlows[index];
+}
+
+vector<int> Actions::maxFlowAllCities(Graph& g) {
+    STATS_PHASE(MAX_FLOW);
+    return solve(g).cityFlows;
 }
 ///////////////////////////////////////////2.2///////////////////////////////////////////
-map<string, int> Actions::citiesInNeed(Graph &g) {
-    map<string, int> m;
-    map<string, int> res;
-    m = maxFlowAllCities(g);
-    for(auto it : cities){
-        float value = (float) m[it.getCode()];
-        if(it.getDemand() - value > 0) res[it.getCode()] = it.getDemand() - value;
+vector<int> Actions::citiesInNeed(Graph &g) {
+    STATS_PHASE(CITIES_IN_NEED);
+    Trace::Scope scope("cities in need");
+    vector<int> m = maxFlowAllCities(g);
+    vector<int> res(cities.size(), 0);
+    for(size_t i = 0; i < cities.size(); i++){
+        float value = (float) m[i];
+        if(cities[i].getDemand() - value > 0) res[i] = cities[i].getDemand() - value;
     }
     return res;
 }
 ///////////////////////////////////////////2.3///////////////////////////////////////////
-vector<double> Actions::calculateMetrics(Graph &g) {
-    // Calculate initial metrics
-    vector<double> res;
-    vector<int> diff;
-    int orig_max_diff = INT_MIN;
-    int sum = 0, count = 0;
-    double orig_average = 0, orig_variance = 0;
-
-    // Iterate over all vertices in the graph
-    for (Vertex* v : g.getVertexSet()) {
-        if (v->getInfo() != "S" && v->getInfo() != "Si") {
-            // Iterate over all edges adjacent to the current vertex
-            for (Edge *e: v->getAdj()) {
-                int d = e->getCapacity() - e->getFlow();
-                diff.push_back(d);
-                sum += d;
-                count++;
-                if (d > orig_max_diff) {
-                    orig_max_diff = d;
-                }
-            }
-        }
-    }
-    orig_average = sum / count;
-    for (int d : diff) {
-        orig_variance += pow(d - orig_average, 2);
-    }
-    orig_variance /= (count - 1);
-    res.push_back(orig_average);
-    res.push_back(orig_variance);
-    res.push_back(orig_max_diff);
-    return res;
+PipeMetrics Actions::calculateMetrics(Graph &g) {
+    return measurePipes(g);
 }
 
-void Actions::balanceAndCalculateMetrics(Graph& g) {
+Actions::BalanceMetrics Actions::balanceAndCalculateMetrics(Graph& g) {
+    STATS_PHASE(BALANCE);
+    Trace::Scope scope("balance");
 
-    //edmonds-karp
-    g.addVertex("Si", VertexType::CITY, 20000);
-    g.addVertex("S", VertexType::RESERVOIR, 10000);
+    solve(g);
 
-    for (auto it: g.getVertexSet()) {
-        if (it->isType(VertexType::CITY) && it->getInfo() != "Si") {
-            int demand =(int) cities[it->getId() - 1].getDemand();
-            g.addEdge(it->getInfo(), "Si", 1, demand);
-        }
-    }
-
-    for (auto it: g.getVertexSet()) {
-        if (it->isType(VertexType::RESERVOIR) && it->getInfo() != "S") {
-            int max = reservoirs[it->getId() - 1].getMaxDelivery();
-            g.addEdge("S", it->getInfo(), 1, max);
-        }
-    }
-
-
-    g.edmondsKarp("S", "Si");
-
-    g.removeVertex("Si");
-    g.removeVertex("S");
-
-    auto values = calculateMetrics(g);
+    BalanceMetrics metrics;
+    metrics.initial = calculateMetrics(g);
 
     //Initially the average of the difference between capacity and flow of each pipe was: 173
     //The variance of the difference between capacity and flow of each pipe was: 53450.5
     //And the maximum difference between capacity and flow of each pipe was: 750
 
-    cout << "Initially the average of the difference between capacity and flow of each pipe was: " << values[0] << endl; //orig_average
-    cout << "The variance of the difference between capacity and flow of each pipe was: " << values[1]  << endl; //orig_variance
-    cout << "And the maximum difference between capacity and flow of each pipe was: " << values[2]  << endl; //orig_max_diff
-    cout << endl;
+    // Balancing algorithm: the same total flow, spread to even out the pipes' utilisation
+    balanceFlows(g, reservoirs, cities);
 
-    // Balancing algorithm
+    metrics.balanced = calculateMetrics(g);
+    return metrics;
+}
 
-    g = heuristic_evaluation(g);
+DemandSweep Actions::demandSweep(Graph& g) {
+    STATS_PHASE(DEMAND_SWEEP);
+    Trace::Scope scope("demand sweep");
+    return sweepDemands(g, reservoirs, cities);
+}
 
-    g.removeVertex("SOURCE");
-    g.removeVertex("SINK");
+vector<long long> Actions::maxFlowEachCityAlone(Graph& g, int threads) {
+    STATS_PHASE(DELIVERABLE);
+    Trace::Scope scope("deliverable flows");
+    if (threads <= 0) threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    return maxDeliverable(g, reservoirs, cities, threads);
+}
 
+long long Actions::maxFlowCityAlone(Graph& g, const string& city) {
+    STATS_PHASE(DELIVERABLE);
+    int index = cityCodes.find(city);
+    if (index < 0) {
+        return -1;
+    }
+    Trace::Scope scope("deliverable flow", city);
+    return maxDeliverableTo(g, reservoirs, cities, index);
+}
 
-    auto finalValues = calculateMetrics(g);
+SupplyMatrix Actions::supplySources(Graph& g) {
+    STATS_PHASE(SUPPLY);
+    solve(g);
+    Trace::Scope scope("supply sources");
+    return traceSupply(g, reservoirs, cities);
+}
 
-    cout << "After using the balancing algorithm the average of the difference between capacity and flow of each pipe is: " << finalValues[0] << endl;
-    cout << "The variance of the difference between capacity and flow of each pipe is: " << finalValues[1] << endl;
-    cout << "And the maximum difference between capacity and flow of each pipe is: " << finalValues[2] << endl;
+///////////////////////////////////////////3.1///////////////////////////////////////////
 
-}
+bool Actions::analyseReservoirs(Graph& g, const string& reservoirCode, vector<ReservoirImpact>& impacts) {
+    STATS_PHASE(RESERVOIR_OUTAGE);
+    Trace::Scope scope("reservoir outage", reservoirCode);
+    int index = reservoirCodes.find(reservoirCode);
+    if (index < 0) {
+        return false;
+    }
 
-Graph Actions::heuristic_evaluation(Graph &g) {
-    vector<Edge*> edges;
-    map<string, int> m = maxFlowAllCities(g);
-
-    for(Vertex * it: g.getVertexSet()){
-        if (it->isType(VertexType::CITY)){
-            City city = cities[it->getId() -1];
-            float value = (float) m[it->getInfo()];
-            if(city.getDemand() - value == 0){
-                for(Edge * edge:it->getPath()){
-                    edges.push_back(edge);
-                }
-            }
+    if (precomputed(g)) {
+        const ContingencyMatrix::Impact* impact = contingency->getImpacts(index);
+        for (size_t i = 0; i < contingency->getImpactCount(index); i++, impact++) {
+            const City& city = cities[impact->city];
+            impacts.push_back({(int) impact->city, contingency->getBaseline(impact->city), impact->flow, city.getDemand() - impact->flow});
         }
+        return true;
     }
 
-    map<City, vector<Edge*>> cityEdges;
+    vector<int> oldFlows = maxFlowAllCities(g);
 
-    for(auto it : edges){
-        City city = cities[it->getDest()->getId()-1];
-        cityEdges[city].push_back(it);
-    }
+    // Set the capacity of edges connected to the reservoir to zero
+    vector<Edge*> edges = g.getAdjacentEdges(reservoirCode);
 
-    for(auto& c: cityEdges){
-        vector<Edge*> edgesToUse;
-        vector<Edge*> es = c.second;
-        int demand = (int) c.first.getDemand();
-        int nEdges = (int) c.second.size();
-        int bestDemand = demand/nEdges;
-
-        for(auto& edge: es){
-            auto path = edge->getSource()->getPath();
-            if(edge->getFlow() > bestDemand){
-                edgesToUse.push_back(edge);
-            }
-            else{
-                for(auto edge1 : path) {
-                    if(edge->getFlow() < edge1->getCapacity() && edge->getCapacity() < edge1->getCapacity()){
-                        edge->setFlow(edge->getCapacity());
-                    }
-                }
+    // When they carry no water the rest of the flow still fits without them, so every city keeps what it gets
+    if (std::all_of(edges.begin(), edges.end(), [](const Edge* e) { return e->getFlow() == 0; })) {
+        return true;
+    }
+    vector<int> capacities;
+    for (auto& edge : edges) {
+        capacities.push_back(edge->getCapacity());
+        edge->setCapacity(0);
+    }
 
-            }
+    // Calculate the maximum flow after removing the reservoir
+    vector<int> currentFlows = maxFlowAllCities(g);
 
-        }
-        int currentDemand = demand;
-        if(edgesToUse.size() > 0){
-            bestDemand = demand / edgesToUse.size();
-            for(auto& it: edgesToUse){
-                if(currentDemand >= bestDemand){
-                    it->setFlow(bestDemand);
-                    currentDemand = currentDemand - bestDemand;
-                }
-                else{
-                    it->setFlow(currentDemand);
-                }
-            }
-            for(auto &it: edgesToUse){
-                if(it->getFlow() > it->getCapacity()){
-                    it->setFlow(it->getCapacity());
-                }
-            }
-        }
+    for (size_t i = 0; i < edges.size(); i++) {
+        edges[i]->setCapacity(capacities[i]);
     }
-    for(auto it: g.getVertexSet()){
-        if(it->isType(VertexType::RESERVOIR)){
-            auto reservoir = reservoirs[it->getId() - 1];
-            int max = reservoir.getMaxDelivery();
-            int waterInUse = 0;
-            for(auto edge:it->getAdj()){
-                waterInUse += edge->getFlow();
-            }
-            int curr_water = max - waterInUse;
-            if(curr_water > 0){
-                for(auto edge:it->getAdj()){
-                    int residual = edge->getCapacity() - edge->getFlow();
-                    if(residual > 0){
-                        if(curr_water - residual >= 0){
-                            edge->setFlow(edge->getCapacity());
-                            curr_water = curr_water - residual;
-                        }
-                        else if(curr_water > 0 && (edge->getCapacity() - edge->getFlow()) > curr_water){
-                            edge->setFlow(edge->getFlow() + curr_water);
-                            curr_water = 0;
-                        }
-                    }
-                }
-            }
+
+    // Record the impact on delivery capacity for each city
+    for (size_t i = 0; i < cities.size(); i++) {
+        if (oldFlows[i] - currentFlows[i] > 0) {
+            impacts.push_back({(int) i, oldFlows[i], currentFlows[i], cities[i].getDemand() - currentFlows[i]});
         }
     }
-    return g;
+    return true;
 }
 
-///////////////////////////////////////////3.1///////////////////////////////////////////
-
-void Actions::analyseReservoirs(Graph& g) {
-    string reservoirCode;
-    cout << "Enter the code of the reservoir you want to analyse: ";
-    cin >> reservoirCode;
-
-    Reservoir* reservoir = nullptr;
+///////////////////////////////////////////3.2///////////////////////////////////////////
 
-    // Find the reservoir with the specified code
-    for (auto& res : reservoirs) {
-        if (res.getCode() == reservoirCode) {
-            reservoir = &res;
-            break;
+vector<Actions::AffectedCity> Actions::stationOutage(Graph& g, int station, const vector<int>& initialFlows) {
+    STATS_PHASE(STATION_OUTAGE);
+    Trace::Scope scope("station outage", stationCodes.code(station));
+    // Vector to store information about affected cities
+    vector<AffectedCity> affectedCities;
+
+    if (precomputed(g)) {
+        size_t component = reservoirs.size() + station;
+        const ContingencyMatrix::Impact* impact = contingency->getImpacts(component);
+        for (size_t i = 0; i < contingency->getImpactCount(component); i++, impact++) {
+            int deficit = cities[impact->city].getDemand() - impact->flow;
+            affectedCities.push_back({(int) impact->city, deficit});
         }
+        return affectedCities;
     }
 
-    if (reservoir == nullptr) {
-        cout << "Reservoir with code " << reservoirCode << " not found." << endl;
-        return;
-    }
-
-    // Create a copy of the original graph
-    Graph tempGraph = g;
-
-    map<string, int> oldFlowMap = maxFlowAllCities(tempGraph);
-
-
-    // Set the capacity of edges connected to the reservoir to zero
-    for (auto& edge : tempGraph.getAdjacentEdges(reservoirCode)) {
+    // Take the station out of service, remembering its pipes so they can be restored
+    vector<Edge*> edges = g.getAdjacentEdges(stationCodes.code(station));
+    vector<pair<int, int>> saved;
+    for (auto& edge : edges) {
+        saved.emplace_back(edge->getCapacity(), edge->getFlow());
         edge->setCapacity(0);
+        edge->setFlow(0);
     }
 
-    // Calculate the maximum flow after removing the reservoir
-    map<string, int> currentFlowMap = maxFlowAllCities(tempGraph);
-
-    int n = 0;
-
-    // Display the impact on delivery capacity for each city
-    cout << "Impact of removing reservoir " << reservoirCode << " on delivery capacity:" << endl;
-    for (const auto &city : cities) {
-        int originalFlow = oldFlowMap[city.getCode()];
-        int currentFlow = currentFlowMap[city.getCode()];
-        int impact = originalFlow - currentFlow;
-        if (impact > 0) {
-            n = 1;
-            cout << "City " << city.getCode() << ": " << "|OLD FLOW - " << originalFlow << "| NEW FLOW - " << currentFlow<<"| reduced by " << impact << " units. The deficit is " << city.getDemand() - currentFlow << "." << endl;
+    // The flow in each city after removing the pumping station
+    vector<int> currentFlows = maxFlowAllCities(g);
+
+    // Iterate through each city in the network
+    for (size_t i = 0; i < cities.size(); i++) {
+        // Check if the city's water supply is affected
+        if (currentFlows[i] < initialFlows[i]) { //current flow different from the initial
+            // Record the affected city and its water supply deficit
+            int deficit = cities[i].getDemand() - currentFlows[i];
+            affectedCities.push_back({(int) i, deficit});
         }
     }
 
-    if(n == 0){
-        cout << endl << "There are no cities affected" << endl;
+    for (size_t i = 0; i < edges.size(); i++) {
+        edges[i]->setCapacity(saved[i].first);
+        edges[i]->setFlow(saved[i].second);
     }
-
+    return affectedCities;
 }
 
-///////////////////////////////////////////3.2///////////////////////////////////////////
-
-void Actions::analyzePumpingStations(Graph& g) {
-    int count = 0; //number of stations that can be removed
-    vector<string> canBeRemoved;
-    map<string, vector<AffectedCity>> station_city;
-
-    Actions a(reservoirs, stations, cities, pipes);
+Actions::StationAnalysis Actions::analyzePumpingStations(Graph& g) {
+    StationAnalysis result;
 
-    //Map that will store the flow in the city before removing the vertex (for comparison later on)
-    map<string, int> initialFlowMap = a.maxFlowAllCities(g);
+    //The flow in each city before removing the vertex (for comparison later on)
+    vector<int> initialFlows;
+    if (!precomputed(g)) {
+        initialFlows = maxFlowAllCities(g);
+    }
 
     // Iterate through each pumping station in the network
-    for (const auto& station: stations) {
-        bool cityWaterSupplyAffected = false;
-
-        // Create a copy of the original graph
-        Graph tempGraph = g;
-
-        for (auto& edge : tempGraph.getAdjacentEdges(station.getCode())) {
-            edge->setCapacity(0);
-            edge->setFlow(0);
-        }
+    for (int station = 0; station < (int) stations.size(); station++) {
+        vector<AffectedCity> affectedCities = stationOutage(g, station, initialFlows);
 
-        // Map to store the flow in each city after removing the pumping station
-        map<string, int> currentFlowMap = a.maxFlowAllCities(tempGraph);
-
-        // Vector to store information about affected cities
-        vector<AffectedCity> affectedCities; //will store the codes
-
-        // Iterate through each city in the network
-        for (const auto &city: cities) {
-            // Check if the city's water supply is affected
-            if (currentFlowMap[city.getCode()] < initialFlowMap[city.getCode()]) { //current flow different from the initial
-                // Record the affected city and its water supply deficit
-                int deficit = city.getDemand() - a.maxFlowSpecificCity(tempGraph, city.getCode());
-                affectedCities.push_back({city.getCode(), deficit});
-                cityWaterSupplyAffected = true;
-            }
+        if (affectedCities.empty()) {
+            result.removable.push_back(station);
         }
-        //Insert the affectedCities vector on the map
-        station_city.insert({station.getCode(), affectedCities});
 
-
-        if (!cityWaterSupplyAffected) {
-            count++;
-            canBeRemoved.push_back(station.getCode());
-        }
-    }
-    if (count == 0) {
-        cout << "There are no pumping stations that can be temporarily taken out of service." << endl;
-    } else {
-        cout << "There are " << count << " pumping stations that can be temporarily taken out of service: ";
-        for (auto s: canBeRemoved) {cout<<s;}
-        cout << endl;
+        result.affectedCities.push_back(affectedCities);
     }
+    return result;
+}
 
-    int choice;
-    cout << "Do you wish to see the cities affected by the removal of a certain pumping station?" << endl;
-    cout << "1. Yes" << endl;
-    cout << "2. No" << endl;
-    cout << "Enter your choice: ";
-    cin >> choice;
-
-    if (choice == 1) {
-        do {
-            string stationCode;
-            cout << "Enter the code of the pumping station: ";
-            cin >> stationCode;
-
-            // Display affected cities for the specified pumping station
-            if (station_city.find(stationCode) != station_city.end()) {
-                cout << "Pumping station " << stationCode << " affects the following cities:" << endl;
-                for (const auto &city: station_city[stationCode]) {
-                    cout << "City " << city.code << " has a water supply deficit of " << city.deficit << endl;
-                }
-            } else {
-                cout << "Invalid pumping station code." << endl;
-            }
+bool Actions::analyzePumpingStation(Graph& g, const string& stationCode, vector<AffectedCity>& affectedCities) {
+    int station = stationCodes.find(stationCode);
+    if (station < 0) {
+        return false;
+    }
 
-            // Ask the user if they want to check another pumping station
-            cout << "Do you want to check another pumping station?\n";
-            cout << "1. Yes\n";
-            cout << "2. No\n";
-            char answer;
-            cin >> answer;
-            if (answer == '2') break;
-        } while(true);
+    vector<int> initialFlows;
+    if (!precomputed(g)) {
+        initialFlows = maxFlowAllCities(g);
     }
+    affectedCities = stationOutage(g, station, initialFlows);
+    return true;
 }
 
 ///////////////////////////////////////////3.3///////////////////////////////////////////
 
-std::map<std::string, std::map<std::string, std::map<std::string, float>>> Actions::crucialPipelines(Graph& g, const std::string& sourceVertex, const std::string& destVertex) {
-    std::map<std::string, std::map<std::string, std::map<std::string, float>>> affectedCitiesMap; // Map to store affected cities
-    Actions a(reservoirs, stations, cities, pipes);
-    map<string, int> originalFlowMap = a.maxFlowAllCities(g);
+bool Actions::crucialPipelines(Graph& g, const std::string& sourceVertex, const std::string& destVertex, vector<float>& deficits) {
+    STATS_PHASE(PIPE_OUTAGE);
+    bool found = false;
+    bool usePrecomputed = precomputed(g);
+    vector<int> originalFlows;
+    if (!usePrecomputed) {
+        originalFlows = maxFlowAllCities(g);
+    }
 
-    for (const auto& pipe : pipes) {
+    for (size_t p = 0; p < pipes.size(); p++) {
+        const Pipe& pipe = pipes[p];
         string source = pipe.getPointA();
         string dest = pipe.getPointB();
         int direction = pipe.getDirection();
 
         if (source == sourceVertex && dest == destVertex) {
 
-            Edge *edge = nullptr;
-            Edge *edge2 = nullptr; // For bidirectional pipes
-
-            if (direction == 1) {
-                edge = g.findEdge(source, dest);
-            } else { // Bidirectional
-                edge = g.findEdge(source, dest);
-                edge2 = g.findEdge(dest, source);
-            }
+            // A bidirectional pipe is a single undirected edge
+            Edge *edge = g.findEdge(source, dest);
 
             if (edge == nullptr) {
                 // Handle edge not found
                 continue;
             }
 
-            std::map<std::string, float> affectedCities;
-
-            // Handle unidirectional pipes
-            if (direction == 1) {
-                handleUnidirectionalPipe(edge, source, dest, originalFlowMap, a, g, affectedCities);
-            } else { // Handle bidirectional pipes
-                handleBidirectionalPipe(edge, edge2, source, dest, originalFlowMap, a, g, affectedCities);
+            found = true;
+            deficits.assign(cities.size(), 0);
+            Trace::Scope scope("pipe outage", source + "-" + dest);
+
+            if (usePrecomputed) {
+                size_t component = reservoirs.size() + stations.size() + p;
+                const ContingencyMatrix::Impact* impact = contingency->getImpacts(component);
+                for (size_t i = 0; i < contingency->getImpactCount(component); i++, impact++) {
+                    if (direction == 1) {
+                        deficits[impact->city] = cities[impact->city].getDemand() - impact->flow;
+                    } else {
+                        deficits[impact->city] = contingency->getBaseline(impact->city) - impact->flow;
+                    }
+                }
+            }
+            else {
+                handlePipeRupture(edge, direction, originalFlows, g, deficits);
             }
         }
     }
-    return affectedCitiesMap;
+    return found;
 }
 
-void Actions::handleUnidirectionalPipe(Edge* edge, const string& source, const string& dest,
-                                       const map<string, int>& originalFlowMap,
-                                       Actions& a, Graph& g, std::map<std::string, float>& affectedCities) {
-
+void Actions::handlePipeRupture(Edge* edge, int direction, const vector<int>& originalFlows, Graph& g,
+                                vector<float>& deficits) {
     int originalCapacity = edge->getCapacity();
     int originalFlow = edge->getFlow();
     edge->setCapacity(0);
     edge->setFlow(0);
 
-    map<string, int> currentFlowMap = a.maxFlowAllCities(g);
+    vector<int> currentFlows = maxFlowAllCities(g);
 
     edge->setCapacity(originalCapacity);
     edge->setFlow(originalFlow);
 
-    map<string,float> deficits;
-    for (const auto &city: cities) {
-        auto it = originalFlowMap.find(city.getCode());
-        if (it != originalFlowMap.end()) {
-            int initialFlow = it->second;
-            int currentFlow = currentFlowMap[city.getCode()];
-            float cityDemand = city.getDemand();
-            if (currentFlow < initialFlow) {
-                deficits[city.getCode()] = cityDemand - currentFlow;
-            }
-        }
-    }
-
-    if (!deficits.empty()) {
-        cout << source << " - " << dest << " is removed. Cities affected:" << endl;
-        for (const auto& pair : deficits) {
-            cout << "City " << pair.first << " has a water supply deficit of " << pair.second << endl;
-        }
-        cout << endl;
-    } else {
-        cout << source << " - " << dest << " is removed. No city is affected." << endl;
-    }
-}
-
-
-void Actions::handleBidirectionalPipe(Edge* edge1, Edge* edge2, const string& source, const string& dest,
-                                      const map<string, int>& originalFlowMap,
-                                      Actions& a, Graph& g, std::map<std::string, float>& affectedCities) {
-    int originalCapacity1 = edge1->getCapacity();
-    int originalFlow1 = edge1->getFlow();
-    edge1->setCapacity(0);
-    edge1->setFlow(0);
-
-    int originalFlow2 = edge2->getFlow();
-    edge2->setCapacity(0);
-    edge2->setFlow(0);
-
-    map<string, int> currentFlowMap = a.maxFlowAllCities(g);
-
-    edge1->setCapacity(originalCapacity1);
-    edge1->setFlow(originalFlow1);
-    edge2->setCapacity(originalCapacity1);
-    edge2->setFlow(originalFlow2);
-
-    map<string,int> deficits;
-    for (const auto &city: cities) {
-        auto it = originalFlowMap.find(city.getCode());
-        if (it != originalFlowMap.end()) {
-            int initialFlow = it->second;
-            int currentFlow = currentFlowMap[city.getCode()];
-            if (currentFlow < initialFlow) {
-                deficits[city.getCode()] = initialFlow - currentFlow;
+    for (size_t i = 0; i < cities.size(); i++) {
+        if (currentFlows[i] < originalFlows[i]) {
+            if (direction == 1) {
+                deficits[i] = cities[i].getDemand() - currentFlows[i];
+            } else {
+                deficits[i] = originalFlows[i] - currentFlows[i];
             }
         }
     }
-
-    if (!deficits.empty()) {
-        cout << source << " - " << dest << " is removed. Cities affected:" << endl;
-        for (const auto& pair : deficits) {
-            cout << "City " << pair.first << " has a water supply deficit of " << pair.second << endl;
-        }
-        cout << endl;
-    } else {
-        cout << source << " - " << dest << " is removed. No city is affected." << endl;
-        cout << "\n";
-    }
 }
 
-void Actions::crucialPipelines(Graph& g, const std::string& cityCode) {
+bool Actions::crucialPipelines(Graph& g, const std::string& cityCode, vector<Pipe>& crucial) {
+    STATS_PHASE(PIPE_OUTAGE);
     // Find the city with the specified code
-    City* city = nullptr;
-    for (auto& c : cities) {
-        if (c.getCode() == cityCode) {
-            city = &c;
-            break;
-        }
+    if (cityCodes.find(cityCode) < 0) {
+        return false;
     }
-    if (city == nullptr) {
-        cout << "City not found.\n";
-        return;
-    }
-
-    map<string, int> originalFlowMap = maxFlowAllCities(g);
-    map<string, int> currentFlowMap;
 
-    // Keep track of whether any pipelines affecting the city are found
-    bool foundCrucialPipelines = false;
+    bool usePrecomputed = precomputed(g);
+    vector<int> originalFlows;
+    if (!usePrecomputed) {
+        originalFlows = maxFlowAllCities(g);
+    }
+    vector<int> currentFlows;
 
     // Iterate over each pipeline
-    for (const auto& pipe : pipes) {
+    for (size_t p = 0; p < pipes.size(); p++) {
+        const Pipe& pipe = pipes[p];
         // Check if the pipeline connects to the specified city
         if (pipe.getPointA() == cityCode || pipe.getPointB() == cityCode) {
             string source = pipe.getPointA();
             string dest = pipe.getPointB();
-            int direction = pipe.getDirection();
 
-            Edge* edge = nullptr;
-            Edge* edge2 = nullptr; // For bidirectional pipes
-
-            // Find the edge corresponding to the pipeline
-            if (direction == 1) {
-                edge = g.findEdge(source, dest);
-            } else { // Bidirectional
-                edge = g.findEdge(source, dest);
-                edge2 = g.findEdge(dest, source);
-            }
+            // Find the edge corresponding to the pipeline, a single undirected one if it is bidirectional
+            Edge* edge = g.findEdge(source, dest);
 
             // Skip if the edge is not found
             if (edge == nullptr) {
                 continue;
             }
 
+            if (usePrecomputed) {
+                if (contingency->getImpactCount(reservoirs.size() + stations.size() + p) > 0) {
+                    crucial.push_back(pipe);
+                }
+                continue;
+            }
+            Trace::Scope scope("pipe outage", source + "-" + dest);
+
             // Temporarily set capacity to 0 to simulate pipeline malfunction
             int originalCapacity = edge->getCapacity();
             edge->setCapacity(0);
 
-            if (edge2 != nullptr) {
-                edge2->setCapacity(0);
-            }
-
             // Calculate the current flow after simulating pipeline malfunction
-            currentFlowMap = maxFlowAllCities(g);
+            currentFlows = maxFlowAllCities(g);
 
             // Reset the capacity back to the original value
             edge->setCapacity(originalCapacity);
-            if (edge2 != nullptr) {
-                edge2->setCapacity(originalCapacity);
-            }
 
             // Check if any city has a water supply deficit due to this pipeline malfunction
             bool affected = false;
-            for (const auto& pair : originalFlowMap) {
-                const string& cityCode = pair.first;
-                int initialFlow = pair.second;
-                int currentFlow = currentFlowMap[cityCode];
-                if (currentFlow < initialFlow) {
+            for (size_t i = 0; i < cities.size(); i++) {
+                if (currentFlows[i] < originalFlows[i]) {
                     affected = true;
                     break;
                 }
             }
 
-            // If any city is affected, display the pipeline as crucial
+            // If any city is affected, record the pipeline as crucial
             if (affected) {
-                foundCrucialPipelines = true;
-                cout << "Pipeline " << pipe.getPointA() << "-" << pipe.getPointB() << " is crucial for city " << cityCode << endl;
+                crucial.push_back(pipe);
             }
         }
     }
-
-    // If no pipelines affecting the city are found, display a message
-    if (!foundCrucialPipelines) {
-        cout << "There are no pipelines crucial to city " << cityCode << endl;
-    }
-}
\ No newline at end of file
+    return true;
+}
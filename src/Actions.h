@@ -10,6 +10,13 @@
 #include "Pipe.h"
 #include "Reservoir.h"
 #include "parse.h"
+#include "scenariocache.h"
+#include "dictionary.h"
+#include "pipemetrics.h"
+#include "parametric.h"
+#include "supply.h"
+
+class ContingencyMatrix;
 
 class Actions {
 
@@ -17,114 +24,225 @@ class Actions {
     vector<Station> stations;
     vector<City> cities;
     vector<Pipe> pipes;
+    CodeDictionary reservoirCodes;
+    CodeDictionary stationCodes;
+    CodeDictionary cityCodes;
 
     Graph graph;
+    ScenarioCache cache;
+    const ContingencyMatrix* contingency = nullptr;
 
 public:
     struct AffectedCity {
-        string code; // Código da cidade
+        int city; // Id da cidade
         int deficit; // Déficit no fornecimento de água para a cidade
     };
+    /**
+     * @brief Change in the water delivered to a city after a reservoir is taken out of service
+     */
+    struct ReservoirImpact {
+        int city;
+        int oldFlow;
+        int newFlow;
+        float deficit; // demand minus the new flow
+    };
+    /**
+     * @brief Result of taking each pumping station out of service, one at a time
+     */
+    struct StationAnalysis {
+        vector<int> removable; // stations that can be removed without affecting any city
+        vector<vector<AffectedCity>> affectedCities; // cities affected by each station, by station id
+    };
+    /**
+     * @brief Pipe metrics (statistics of capacity - flow, overall and by pipe class) before and after balancing
+     */
+    struct BalanceMetrics {
+        PipeMetrics initial;
+        PipeMetrics balanced;
+    };
     Actions(vector<Reservoir> reservoirs_, vector<Station> stations_, vector<City> cities_, vector<Pipe> pipes_);
+    /**
+     * @brief Get the cache of maximum flow solutions shared by the analyses
+     *
+     * @return ScenarioCache&
+     */
+    ScenarioCache& getCache();
+    /**
+     * @brief Get the codes of the reservoirs, by id
+     *
+     * @return const CodeDictionary&
+     */
+    const CodeDictionary& getReservoirCodes() const;
+    /**
+     * @brief Get the codes of the pumping stations, by id
+     *
+     * @return const CodeDictionary&
+     */
+    const CodeDictionary& getStationCodes() const;
+    /**
+     * @brief Get the codes of the cities, by id
+     *
+     * @return const CodeDictionary&
+     */
+    const CodeDictionary& getCityCodes() const;
+    /**
+     * @brief Answer the outage analyses from a precomputed matrix
+     *
+     * The matrix is used only while no capacity in the graph has been changed,
+     * and must have been built from the same network as this object.
+     *
+     * @param matrix The matrix to use, nullptr to always solve
+     */
+    void useContingency(const ContingencyMatrix* matrix);
     /**
      * @brief Calculates the maximum amount of water that can reach a specific city.
      *
      * @param g Reference to the graph representing the water supply network.
      * @param city The code of the city for which the maximum flow is to be calculated.
-     * @return The maximum amount of water that can reach the specified city.
+     * @return The maximum amount of water that can reach the specified city, -1 if there is no city with that code.
      */
     int maxFlowSpecificCity(Graph& g, string city); //2.1
     /**
      * @brief Calculates the maximum amount of water that can reach each city.
      *
      * @param g Reference to the graph representing the water supply network.
-     * @return A map containing the maximum amount of water that can reach each city.
+     * @return The maximum amount of water that can reach each city, by city id.
      */
-    map<string, int> maxFlowAllCities(Graph& g); //2.1
+    vector<int> maxFlowAllCities(Graph& g); //2.1
     /**
      * @brief Determine the cities in need of additional water supply.
      *
      * This function calculates the demand for water supply in each city based on the maximum
      * flow computed for the water distribution network represented by the given graph. It
      * compares the demand for water in each city with the maximum flow reaching that city and
-     * identifies the cities where the supply doesn't meet the demand. The result is a map
-     * containing the names of cities and the deficit amount of water they require.
+     * identifies the cities where the supply doesn't meet the demand.
      *
      * @param g Reference to the graph representing the water distribution network.
-     * @return std::map<std::string, int> A map containing the names of cities in need and their
-     * deficit amount of water supply.
+     * @return vector<int> The deficit of each city, by city id, 0 for the cities whose demand is met.
      */
-    map<string, int> citiesInNeed(Graph& g); //2.2
+    vector<int> citiesInNeed(Graph& g); //2.2
     /**
      * @brief Balances the water supply network and calculates the metrics.
      *
+     * The balanced flow is the allocation of balanceFlows: as much water as
+     * the maximum flow delivers, with every pipe as evenly utilised as the
+     * network allows. It is left on the graph's edges.
+     *
      * @param g Reference to the graph representing the water supply network.
+     * @return The metrics of the network before and after balancing.
      */
-    void balanceAndCalculateMetrics(Graph& g); //2.3
+    BalanceMetrics balanceAndCalculateMetrics(Graph& g); //2.3
     /**
-     * @brief Perform heuristic evaluation to optimize water flow in the graph.
+     * @brief Calculates the metrics of the water supply network.
      *
-     * This function conducts a heuristic evaluation of the water distribution network
-     * represented by the given graph to optimize water flow. It calculates the maximum flow
-     * for all cities in the network and adjusts the flow through edges based on predefined
-     * heuristic rules. The objective is to ensure that each city's demand is met efficiently
-     * while considering the capacities of pipes and reservoirs. The function returns the modified
-     * graph after applying the heuristic evaluation.
+     * The spare capacity of every pipe is streamed through measurePipes in
+     * one pass, without collecting it first.
      *
-     * @param g Reference to the graph representing the water distribution network.
-     * @return Graph The modified graph after heuristic evaluation.
+     * @param g Reference to the graph representing the water supply network.
+     * @return The mean, variance, extremes and quantiles of capacity - flow, overall and by pipe class.
      */
-    Graph heuristic_evaluation(Graph &g); //2.3
+    PipeMetrics calculateMetrics(Graph& g);//2.3
     /**
-     * @brief Calculates the metrics of the water supply network.
+     * @brief Find how the deficits evolve as every city's demand is scaled by the same factor
+     *
+     * Every breakpoint of the maximum flow as a function of the factor, and the
+     * factor up to which each city is served in full, from one parametric run
+     * of sweepDemands instead of a solve per factor.
+     *
+     * @param g Reference to the graph representing the water supply network.
+     * @return DemandSweep
+     */
+    DemandSweep demandSweep(Graph& g);
+    /**
+     * @brief Find the most water that could reach each city if it were the only one drawing from the network
+     *
+     * Unlike maxFlowSpecificCity, which is the city's share of one maximum flow
+     * to every city, this is the maximum flow with the city alone as the sink,
+     * computed for every city by maxDeliverable.
      *
      * @param g Reference to the graph representing the water supply network.
-     * @return A vector containing the metrics of the water supply network.
+     * @param threads Workers, 0 for one per core.
+     * @return vector<long long> The flow of each city, by city id.
      */
-    vector<double> calculateMetrics(Graph& g);//2.3
+    vector<long long> maxFlowEachCityAlone(Graph& g, int threads = 0);
     /**
-     * @brief Identifies the cities in need of water supply.
+     * @brief Find the most water that could reach one city if it were the only one drawing from the network
+     *
+     * The figure of maxFlowEachCityAlone for that city, from one solve (maxDeliverableTo).
      *
      * @param g Reference to the graph representing the water supply network.
-     * @return A map containing the cities in need of water supply and their respective deficits.
+     * @param city The code of the city.
+     * @return long long The flow, -1 if there is no city with that code.
      */
-    void analyseReservoirs(Graph& g); //3.1
+    long long maxFlowCityAlone(Graph& g, const string& city);
+    /**
+     * @brief Find which reservoirs the water reaching each city comes from
+     *
+     * The maximum flow of maxFlowAllCities, split between the reservoirs by
+     * traceSupply. It is one of the maximum flows: another could feed the
+     * cities from other reservoirs.
+     *
+     * @param g Reference to the graph representing the water supply network.
+     * @return SupplyMatrix
+     */
+    SupplyMatrix supplySources(Graph& g);
+    /**
+     * @brief Evaluates the impact of taking one reservoir out of commission.
+     *
+     * A reservoir whose pipes carry no water in the maximum flow affects no
+     * city, and is answered without solving again.
+     * The graph is left as it was found.
+     *
+     * @param g Reference to the graph representing the water supply network.
+     * @param reservoirCode The code of the reservoir to remove.
+     * @param impacts Filled with the cities whose delivery is reduced.
+     * @return false if there is no reservoir with that code.
+     */
+    bool analyseReservoirs(Graph& g, const string& reservoirCode, vector<ReservoirImpact>& impacts); //3.1
     /**
      * @brief Analyzes the pumping stations in the water supply network.
      *
+     * Each station is taken out of service on its own and the cities whose
+     * delivery drops are recorded. The graph is left as it was found.
+     *
      * @param g Reference to the graph representing the water supply network.
+     * @return The removable stations and the cities affected by each station.
      */
-    void analyzePumpingStations(Graph& g); //3.2
+    StationAnalysis analyzePumpingStations(Graph& g); //3.2
     /**
-     * @brief Identifies the cities in need of water supply.
+     * @brief Evaluates the impact of taking one pumping station out of service.
      *
      * @param g Reference to the graph representing the water supply network.
-     * @return A map containing the cities in need of water supply and their respective deficits.
+     * @param stationCode The code of the station to remove.
+     * @param affectedCities Filled with the affected cities and their water supply deficit.
+     * @return false if there is no station with that code.
      */
-    void handleBidirectionalPipe(Edge* edge1, Edge* edge2, const string& source,const string& dest, const map<string, int>& originalFlowMap,Actions& a, Graph& g, std::map<std::string, float>& affectedCities);
+    bool analyzePumpingStation(Graph& g, const string& stationCode, vector<AffectedCity>& affectedCities); //3.2
     /**
-     * @brief Identifies the cities in need of water supply.
+     * @brief Simulates the rupture of a pipe.
      *
+     * @param edge The pipe's edge, a single undirected one for a bidirectional pipe.
+     * @param direction The pipe's direction, 1 for a unidirectional pipe.
+     * @param originalFlows The flow of each city before the rupture, by city id.
      * @param g Reference to the graph representing the water supply network.
-     * @return A map containing the cities in need of water supply and their respective deficits.
+     * @param deficits Set for each affected city, by city id: its water supply deficit for a unidirectional pipe,
+     *                 the flow it loses for a bidirectional one.
      */
-    void handleUnidirectionalPipe(Edge* edge, const string& source, const string& dest,const map<string, int>& originalFlowMap,Actions& a, Graph& g, std::map<std::string, float>& affectedCities);
+    void handlePipeRupture(Edge* edge, int direction, const vector<int>& originalFlows, Graph& g, vector<float>& deficits);
     /**
-     * @brief Identify crucial pipelines and their impact on affected cities.
+     * @brief Determine the impact of a pipeline rupture on the cities.
      *
-     * This function analyzes the water distribution network represented by the given graph
-     * to identify crucial pipelines between the specified source and destination vertices.
-     * It determines the impact of these pipelines on affected cities, considering the current
-     * flow distribution in the network. The result is a nested map structure containing
-     * information about the crucial pipelines and their impact on affected cities.
+     * This function simulates the rupture of the pipeline between the specified source and
+     * destination vertices and determines the cities whose supply drops, considering the
+     * current flow distribution in the network.
      *
      * @param g Reference to the graph representing the water distribution network.
-     * @param sourceVertex The info attribute of the source vertex of crucial pipelines.
-     * @param destVertex The info attribute of the destination vertex of crucial pipelines.
-     * @return std::map<std::string, std::map<std::string, std::map<std::string, float>>> A map containing
-     * information about crucial pipelines and their impact on affected cities.
+     * @param sourceVertex The info attribute of the source vertex of the pipeline.
+     * @param destVertex The info attribute of the destination vertex of the pipeline.
+     * @param deficits Set to the deficit of each city, by city id, 0 for the cities that are not affected.
+     * @return false if there is no such pipeline.
      */
-    std::map<std::string, std::map<std::string, std::map<std::string, float>>> crucialPipelines(Graph& g, const std::string& sourceVertex, const std::string& destVertex); //3.3
+    bool crucialPipelines(Graph& g, const std::string& sourceVertex, const std::string& destVertex, vector<float>& deficits); //3.3
     /**
      * @brief Identify crucial pipelines affecting a specific city and their impact on water supply.
      *
@@ -136,7 +254,28 @@ public:
      *
      * @param g Reference to the graph representing the water distribution network.
      * @param cityCode The unique code identifying the city.
+     * @param crucial Filled with the crucial pipelines.
+     * @return false if there is no city with that code.
+     */
+    bool crucialPipelines(Graph& g, const std::string& cityCode, vector<Pipe>& crucial); //3.3
+
+private:
+    /**
+     * @brief Maximum flow from every reservoir to every city, with the edge flows left in the graph
+     *
+     * Solutions are looked up in the cache first, keyed by the graph version
+     * and the capacities the analyses changed.
+     */
+    ScenarioCache::Entry solve(Graph& g);
+    /**
+     * @brief Whether the outage analyses can be read from the contingency matrix
+     */
+    bool precomputed(const Graph& g) const;
+    /**
+     * @brief Takes a station out of service and finds the cities that receive less water.
+     *
+     * The station's pipes are restored before returning.
      */
-    void crucialPipelines(Graph& g, const std::string& cityCode); //3.3
+    vector<AffectedCity> stationOutage(Graph& g, int station, const vector<int>& initialFlows);
 };
 #endif
\ No newline at end of file
@@ -3,11 +3,13 @@
 Station::Station() {
     this->id = -1;
     this->code = "";
+    this->capacity = UNLIMITED;
 }
 
-Station::Station(const int &id, const string &code) {
+Station::Station(const int &id, const string &code, const int &capacity) {
     this->id = id;
     this->code = code;
+    this->capacity = capacity;
 }
 
 int Station::getId() const {
@@ -17,3 +19,11 @@ int Station::getId() const {
 string Station::getCode() const {
     return this->code;
 }
+
+int Station::getCapacity() const {
+    return this->capacity;
+}
+
+bool Station::isLimited() const {
+    return this->capacity != UNLIMITED;
+}
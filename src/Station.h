@@ -9,13 +9,20 @@ class Station {
 private:
     int id;
     string code;
+    int capacity;
 
 public:
+    /**
+     * @brief The capacity of a station that can pump whatever reaches it
+     */
+    static constexpr int UNLIMITED = -1;
+
     Station();
 
     Station(
             const int &id,
-            const string &code
+            const string &code,
+            const int &capacity = UNLIMITED
     );
 
     /**
@@ -30,6 +37,19 @@ public:
      * @return string
      */
     string getCode() const;
+    /**
+     * @brief Get the most the station can pump, in the units of the pipe capacities
+     *
+     * @return int UNLIMITED if the station has no pumping limit
+     */
+    int getCapacity() const;
+    /**
+     * @brief Check if the station has a pumping limit
+     *
+     * @return true
+     * @return false
+     */
+    bool isLimited() const;
 };
 
 
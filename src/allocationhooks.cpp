@@ -0,0 +1,39 @@
+#include <cstdlib>
+#include <new>
+#include "allocations.h"
+
+// Replaces the global operator new and delete so that every allocation made
+// by the program is counted in Allocations. Each block is preceded by a header
+// holding its size, so the live heap is known even where delete is not sized.
+// The header is as large as the strictest fundamental alignment, which keeps
+// the blocks returned suitably aligned.
+
+namespace {
+
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+const bool registered = (Allocations::markTracking(), true);
+
+}
+
+void* operator new(std::size_t size) {
+    if (char* p = static_cast<char*>(std::malloc(size + HEADER))) {
+        *reinterpret_cast<size_t*>(p) = size;
+        Allocations::recordAllocation(size);
+        return p + HEADER;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    char* block = static_cast<char*>(p) - HEADER;
+    Allocations::recordFree(*reinterpret_cast<size_t*>(block));
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <atomic>
+#include "allocations.h"
+
+namespace {
+std::atomic<bool> tracking(false);
+}
+
+thread_local Allocations::Counters Allocations::counters;
+
+Allocations::Scope::Scope(): start(counters), outerPeak(counters.peak) {
+    counters.peak = counters.live;
+}
+
+Allocations::Scope::~Scope() {
+    counters.peak = std::max(outerPeak, counters.peak);
+}
+
+Allocations::Usage Allocations::Scope::usage() const {
+    Usage u;
+    u.allocations = counters.allocations - start.allocations;
+    u.bytes = counters.bytes - start.bytes;
+    u.peak = (uint64_t) std::max<int64_t>(0, counters.peak - start.live);
+    return u;
+}
+
+bool Allocations::isTracking() {
+    return tracking.load(std::memory_order_relaxed);
+}
+
+void Allocations::markTracking() {
+    tracking = true;
+}
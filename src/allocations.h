@@ -0,0 +1,73 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_ALLOCATIONS_H
+#define WATER_SUPPLY_MANAGEMENT_ALLOCATIONS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Heap traffic of the calling thread
+ *
+ * The counts only move when the program links the counting operator new and
+ * delete in allocationhooks.cpp: the benchmark always does, the application
+ * when configured with -DWATER_SUPPLY_ALLOCATIONS=ON. Each thread counts what
+ * it allocates and frees, so memory freed by another thread than the one that
+ * allocated it shows up as a negative live size on the freeing thread.
+ */
+class Allocations {
+public:
+    struct Counters {
+        uint64_t allocations;
+        uint64_t bytes;
+        int64_t live;   // bytes allocated and not yet freed by this thread
+        int64_t peak;   // highest live since the innermost open Scope began
+    };
+
+    /**
+     * @brief What was allocated between a Scope's construction and now
+     */
+    struct Usage {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        uint64_t peak = 0;   // the most heap held at once above the starting point
+    };
+
+    /**
+     * @brief Measures the calling thread's heap use from construction to destruction
+     *
+     * Scopes nest: an inner scope's peak counts towards the outer one's.
+     */
+    class Scope {
+        Counters start;
+        int64_t outerPeak;
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Usage usage() const;
+    };
+
+    /**
+     * @brief Whether the counting operator new is linked into this program
+     */
+    static bool isTracking();
+    static void markTracking();
+
+    // Called by the counting operator new and delete only
+    static void recordAllocation(size_t size) {
+        Counters& c = counters;
+        c.allocations++;
+        c.bytes += size;
+        c.live += (int64_t) size;
+        if (c.live > c.peak) c.peak = c.live;
+    }
+    static void recordFree(size_t size) {
+        counters.live -= (int64_t) size;
+    }
+
+private:
+    // Zero-initialised, so reaching it from operator new never runs a constructor
+    static thread_local Counters counters;
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_ALLOCATIONS_H
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include "balance.h"
+#include "residual.h"
+
+namespace {
+
+const long long UTILISATION_SCALE = 8;     // the widest pipe's unit cost per piece, before the 1, 3, 5, ...
+const long long SCALING_FACTOR = 8;        // how much each refinement divides epsilon by
+
+/**
+ * @brief A residual network in compressed form: arc 2k is an arc and 2k + 1 its reverse
+ *
+ * Each arc pair is a pipe with a flow between its lower and upper bounds and a
+ * convex cost, linear in pieces of equal width on either side of zero. Once
+ * the costs are on, only the piece the flow is in is exposed, as the residual
+ * capacity and cost of the two arcs up to its ends, so a pipe is two arcs
+ * however many pieces it has.
+ *
+ * Solved in two steps. A maximum flow, by Dinic's algorithm with the costs
+ * off, fixes how much is delivered. Then the cost of that flow is brought down
+ * by cost-scaling push-relabel (Goldberg and Tarjan), which moves flow only
+ * between the paths the maximum flow could have used, so the amount delivered
+ * stays the same. Costs are multiplied by the number of nodes + 1, so that a
+ * flow within epsilon = 1 of optimal is optimal.
+ */
+class CostNetwork {
+    vector<int> from, to;
+    vector<long long> capacity, cost;           // of each arc, for the piece the flow is in
+    vector<long long> upper, lower, weight, flow;   // of each pair
+    vector<int> pieces;
+    vector<int> first, order;   // the arcs leaving each node are order[first[v] .. first[v + 1])
+    vector<long long> potential, excess, distance;
+    vector<int> current;
+    vector<bool> scanned;
+    int nodes;
+    bool priced = false;        // whether the costs are on
+    long long factor = 1;
+
+    long long bound(int p, int k) const {
+        return upper[p] * k / pieces[p];
+    }
+
+    long long unitCost(int p, int k) const {
+        return (2 * k + 1) * weight[p] * factor;
+    }
+
+    /**
+     * @brief Residual capacity and cost of moving a pair's flow, at x >= 0 on one side, further from zero up to limit
+     */
+    void away(int p, long long x, long long limit, long long& cap, long long& c) const {
+        if (x >= limit) {
+            cap = c = 0;
+            return;
+        }
+        int k = 0;
+        while (bound(p, k + 1) <= x) k++;
+        cap = bound(p, k + 1) - x;
+        c = unitCost(p, k);
+    }
+
+    /**
+     * @brief Residual capacity and cost of moving a pair's flow, at x > 0 on one side, back towards zero
+     */
+    void towards(int p, long long x, long long& cap, long long& c) const {
+        int k = 0;
+        while (bound(p, k + 1) < x) k++;
+        cap = x - bound(p, k);
+        c = -unitCost(p, k);
+    }
+
+    void refresh(int p) {
+        int a = 2 * p;
+        long long f = flow[p];
+        if (!priced) {
+            capacity[a] = upper[p] - f;
+            capacity[a + 1] = f - lower[p];
+            cost[a] = cost[a + 1] = 0;
+            return;
+        }
+        if (f >= 0) away(p, f, upper[p], capacity[a], cost[a]);
+        else towards(p, -f, capacity[a], cost[a]);
+        if (f > 0) towards(p, f, capacity[a + 1], cost[a + 1]);
+        else away(p, -f, -lower[p], capacity[a + 1], cost[a + 1]);
+    }
+
+    long long reducedCost(int a) const {
+        return cost[a] + potential[from[a]] - potential[to[a]];
+    }
+
+    void push(int a, long long amount) {
+        flow[a / 2] += a % 2 == 0 ? amount : -amount;
+        refresh(a / 2);
+        excess[from[a]] -= amount;
+        excess[to[a]] += amount;
+    }
+
+    /**
+     * @brief Turn a flow within epsilon * factor of optimal into one within epsilon
+     *
+     * Saturates every arc of negative reduced cost, then pushes the excess this
+     * leaves downhill, first in first out, lowering the potential of a node
+     * with excess and nowhere to push it. Every so many relabels the
+     * potentials are all lowered at once to the distance from the nearest
+     * deficit, which saves most of the relabels.
+     */
+    void refine(long long epsilon) {
+        for (int a = 0; a < (int) from.size(); a++) {
+            while (capacity[a] > 0 && reducedCost(a) < 0) push(a, capacity[a]);
+        }
+        queue<int> active;
+        for (int v = 0; v < nodes; v++) {
+            if (excess[v] > 0) active.push(v);
+        }
+        globalUpdate(epsilon);
+        int relabels = 0;
+        while (!active.empty()) {
+            int v = active.front();
+            active.pop();
+            while (excess[v] > 0) {
+                if (current[v] == first[v + 1]) {
+                    relabel(v, epsilon);
+                    if (++relabels == nodes) {
+                        globalUpdate(epsilon);
+                        relabels = 0;
+                    }
+                    continue;
+                }
+                int a = order[current[v]];
+                if (capacity[a] > 0 && reducedCost(a) < 0) {
+                    int w = to[a];
+                    bool idle = excess[w] <= 0;
+                    push(a, std::min(excess[v], capacity[a]));
+                    if (idle && excess[w] > 0) active.push(w);
+                }
+                else {
+                    current[v]++;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Lower each potential by epsilon times the node's distance from the nearest deficit
+     *
+     * The length of a residual arc is how many epsilons its reduced cost is
+     * above -epsilon, so the flow stays within epsilon of optimal and every
+     * node with excess gets an admissible path. The search stops once it has
+     * reached all of those; the nodes beyond are lowered as much as the last.
+     */
+    void globalUpdate(long long epsilon) {
+        int waiting = 0;
+        using Item = pair<long long, int>;
+        priority_queue<Item, vector<Item>, greater<Item>> q;
+        distance.assign(nodes, std::numeric_limits<long long>::max());
+        scanned.assign(nodes, false);
+        for (int v = 0; v < nodes; v++) {
+            if (excess[v] > 0) waiting++;
+            if (excess[v] < 0) {
+                distance[v] = 0;
+                q.push({0, v});
+            }
+        }
+        long long last = 0;
+        while (!q.empty() && waiting > 0) {
+            auto [d, u] = q.top();
+            q.pop();
+            if (d > distance[u]) continue;
+            scanned[u] = true;
+            last = d;
+            if (excess[u] > 0) waiting--;
+            for (int i = first[u]; i < first[u + 1]; i++) {
+                int b = order[i] ^ 1;       // the arc into u from the other end
+                int v = from[b];
+                if (capacity[b] <= 0 || scanned[v]) continue;
+                long long rc = reducedCost(b);
+                long long nd = d + (rc < 0 ? 0 : rc / epsilon + 1);
+                if (nd < distance[v]) {
+                    distance[v] = nd;
+                    q.push({nd, v});
+                }
+            }
+        }
+        for (int v = 0; v < nodes; v++) {
+            potential[v] -= epsilon * (scanned[v] ? distance[v] : last);
+            current[v] = first[v];
+        }
+    }
+
+    void relabel(int v, long long epsilon) {
+        long long highest = std::numeric_limits<long long>::min();
+        for (int i = first[v]; i < first[v + 1]; i++) {
+            int a = order[i];
+            if (capacity[a] > 0) highest = std::max(highest, potential[to[a]] - cost[a]);
+        }
+        potential[v] = highest - epsilon;
+        current[v] = first[v];
+    }
+
+    void setPriced(bool on) {
+        priced = on;
+        factor = on ? nodes + 1 : 1;
+        for (int p = 0; p < (int) flow.size(); p++) refresh(p);
+    }
+
+public:
+    explicit CostNetwork(int n): nodes(n) {}
+
+    /**
+     * @brief A pair of arcs from u to v, carrying between lower and upper, each unit costing weight, 3 weight, ... per piece
+     *
+     * @return int The pair
+     */
+    int addPair(int u, int v, long long up, long long low, long long unit, int count) {
+        from.push_back(u); to.push_back(v);
+        from.push_back(v); to.push_back(u);
+        capacity.resize(from.size());
+        cost.resize(from.size());
+        upper.push_back(up); lower.push_back(low); weight.push_back(unit); flow.push_back(0);
+        pieces.push_back(std::max(1, count));
+        return (int) flow.size() - 1;
+    }
+
+    long long getFlow(int p) const {
+        return flow[p];
+    }
+
+    void index() {
+        first.assign(nodes + 1, 0);
+        for (int u : from) first[u + 1]++;
+        for (int v = 0; v < nodes; v++) first[v + 1] += first[v];
+        order.resize(from.size());
+        vector<int> next(first.begin(), first.end() - 1);
+        for (int a = 0; a < (int) from.size(); a++) order[next[from[a]]++] = a;
+        potential.assign(nodes, 0);
+        excess.assign(nodes, 0);
+        current.assign(nodes, 0);
+    }
+
+    /**
+     * @brief A maximum flow from s to t of least cost
+     *
+     * @param s
+     * @param t
+     * @param refinements Incremented by the cost scaling rounds it took
+     * @return long long The flow delivered
+     */
+    long long solve(int s, int t, int& refinements) {
+        setPriced(false);
+        // The maximum flow by the same Dinic as the other solvers, over the pairs' bounds
+        ArcTopology topology(nodes);
+        for (int p = 0; p < (int) flow.size(); p++) topology.addArc(from[2 * p], to[2 * p], upper[p], -lower[p]);
+        topology.index();
+        ResidualNetwork network(topology);
+        long long delivered = network.maxFlow(s, t);
+        for (int p = 0; p < (int) flow.size(); p++) flow[p] = network.getFlow(2 * p);
+        excess.assign(nodes, 0);
+
+        setPriced(true);
+        long long epsilon = 0;
+        for (int p = 0; p < (int) flow.size(); p++) epsilon = std::max(epsilon, unitCost(p, pieces[p] - 1));
+        while (epsilon > 1) {
+            epsilon = std::max(1LL, epsilon / SCALING_FACTOR);
+            refine(epsilon);
+            refinements++;
+        }
+        return delivered;
+    }
+
+    /**
+     * @brief The cost of the flow, in units of the pairs' weights
+     */
+    long long totalCost() const {
+        long long total = 0;
+        for (int p = 0; p < (int) flow.size(); p++) {
+            long long x = std::abs(flow[p]);
+            for (int k = 0; k < pieces[p] && bound(p, k) < x; k++) {
+                total += (std::min(x, bound(p, k + 1)) - bound(p, k)) * (2 * k + 1) * weight[p];
+            }
+        }
+        return total;
+    }
+};
+
+}
+
+BalancedFlow balanceFlows(Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities, int segments) {
+    segments = std::max(1, segments);
+    SplitNetwork split(g, reservoirs, cities);
+    CostNetwork network(split.getNodes());
+    for (const SplitArc& arc : split.getArcs()) {
+        if (arc.kind != SplitArc::PIPE) network.addPair(arc.from, arc.to, arc.capacity, 0, 0, 1);
+    }
+
+    // A unit of flow costs a pipe 1 / capacity per piece it has filled, scaled to integers so that the
+    // widest pipe still tells its pieces apart
+    long long widest = 1;
+    for (Vertex* v : split.getVertices()) {
+        for (Edge* e : v->getAdj()) widest = std::max(widest, (long long) e->getCapacity());
+    }
+    const double scale = (double) (UTILISATION_SCALE * widest);
+
+    // A bidirectional pipe is one pair, working either way, unless a limited station at an end needs
+    // its two directions to leave from different nodes
+    struct PipeArcs {
+        Edge* edge;
+        int forward, backward;
+    };
+    vector<PipeArcs> pipes;
+    for (const SplitArc& arc : split.getArcs()) {
+        if (arc.kind != SplitArc::PIPE) continue;
+        Edge* e = arc.edge;
+        long long c = arc.capacity;
+        long long unit = std::max(1LL, std::llround(scale / (double) c));
+        bool oneWay = !e->isUndirected() || e->getSource()->isLimited() || e->getDest()->isLimited();
+        if (!arc.reverse) {
+            pipes.push_back({e, network.addPair(arc.from, arc.to, c, oneWay ? 0 : -c, unit, segments), -1});
+        }
+        else if (oneWay) {
+            // Right after the way there
+            pipes.back().backward = network.addPair(arc.from, arc.to, c, 0, unit, segments);
+        }
+    }
+    network.index();
+
+    BalancedFlow result;
+    result.delivered = network.solve(split.getSource(), split.getSink(), result.refinements);
+    result.cost = network.totalCost();
+
+    for (Vertex* v : g.getVertexSet()) {
+        for (Edge* e : v->getAdj()) e->setFlow(0);
+    }
+    for (const auto& p : pipes) {
+        long long flow = network.getFlow(p.forward);
+        if (p.backward >= 0) flow -= network.getFlow(p.backward);
+        p.edge->setFlow((int) flow);
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_BALANCE_H
+#define WATER_SUPPLY_MANAGEMENT_BALANCE_H
+
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief What balanceFlows found
+ */
+struct BalancedFlow {
+    long long delivered = 0;    // total flow reaching the cities, the same as a maximum flow
+    long long cost = 0;         // of the piecewise-linear objective, in the solver's integer units
+    int refinements = 0;        // cost scaling rounds
+};
+
+/**
+ * @brief Spread a maximum flow over the pipes as evenly as their capacities allow
+ *
+ * Among the flows that deliver as much as a maximum flow, finds one that
+ * minimises the sum over the pipes of (flow / capacity)^2. Loading a pipe
+ * costs more the fuller it already is and the narrower it is, so flow moves
+ * onto idle and wide routes and the spread of capacity - flow shrinks. The
+ * square is approximated by segments linear pieces per pipe, whose unit costs
+ * grow 1, 3, 5, ... times 1 / capacity (rounded to integers relative to the
+ * widest pipe).
+ *
+ * A maximum flow by Dinic's algorithm fixes how much is delivered, then
+ * cost-scaling push-relabel (Goldberg and Tarjan, with global price updates)
+ * brings its cost down without changing that amount. A pipe stays two arcs
+ * however many pieces it has, and the work is local to where flow moves, so
+ * networks a thousand times the dataset's size solve in seconds.
+ *
+ * Flow is conserved at every station, and station limits, reservoir
+ * deliveries and (truncated) city demands are respected as in Actions. The
+ * super source and sink are ignored if attached. The graph's edge flows are
+ * replaced by the balanced allocation.
+ *
+ * @param g
+ * @param reservoirs Their maximum deliveries, by id
+ * @param cities Their demands, by id
+ * @param segments Linear pieces per pipe, 1 for a plain min-cost maximum flow
+ * @return BalancedFlow
+ */
+BalancedFlow balanceFlows(Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities, int segments = 4);
+
+#endif //WATER_SUPPLY_MANAGEMENT_BALANCE_H
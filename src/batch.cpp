@@ -0,0 +1,77 @@
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "batch.h"
+#include "jobs.h"
+#include "json.h"
+#include "trace.h"
+
+int runBatch(const std::string& jobFile, const std::string& outputFile, int threads,
+             const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+             const std::vector<Pipe>& pipes, const std::vector<City>& cities) {
+    std::ifstream input(jobFile);
+    if (!input.is_open()) {
+        std::cerr << "Error: Unable to open " << jobFile << "\n";
+        return -1;
+    }
+
+    std::vector<Job> jobs;
+    std::vector<std::string> results;
+    std::string line, error;
+    int lineNumber = 0;
+    while (getline(input, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        Job job;
+        error.clear();
+        bool valid = parseJob(line, job, error);
+        if (valid && job.command.empty())
+            continue;
+        job.line = lineNumber;
+        jobs.push_back(job);
+        results.push_back(valid ? "" : "\"error\":" + jsonString(error));
+    }
+
+    std::ofstream output(outputFile);
+    if (!output.is_open()) {
+        std::cerr << "Error: Unable to open " << outputFile << "\n";
+        return -1;
+    }
+
+    // Analyses change capacities and flows while they run, so every worker gets its own graph
+    std::atomic<size_t> next{0};
+    auto worker = [&](int number) {
+        Trace::nameThread("batch worker " + std::to_string(number));
+        Graph g;
+        {
+            Trace::Scope scope("build graph");
+            g = g.buildGraph(reservoirs, stations, pipes, cities);
+        }
+        Actions a(reservoirs, stations, cities, pipes);
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            if (!results[i].empty())
+                continue;
+            Trace::Scope scope("job", jobs[i].text);
+            std::string jobError;
+            std::string result = runJob(jobs[i], g, a, jobError);
+            results[i] = result.empty() ? "\"error\":" + jsonString(jobError) : "\"result\":" + result;
+        }
+    };
+
+    threads = std::max(1, std::min(threads, (int) jobs.size()));
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto& w : workers)
+        w.join();
+
+    Trace::Scope scope("write results", outputFile);
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (results[i].compare(0, 8, "\"error\":") == 0) failed++;
+        output << "{\"line\":" << jobs[i].line << ",\"job\":" << jsonString(jobs[i].text) << "," << results[i] << "}\n";
+    }
+    return failed;
+}
@@ -0,0 +1,27 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_BATCH_H
+#define WATER_SUPPLY_MANAGEMENT_BATCH_H
+
+#include <string>
+#include <vector>
+#include "Reservoir.h"
+#include "Station.h"
+#include "City.h"
+#include "Pipe.h"
+
+/**
+ * @brief Run every job of a job file and write the results as JSON lines
+ *
+ * Jobs are independent, so they are spread over worker threads, each with its
+ * own graph. The output has one object per job, in job file order:
+ * {"line": n, "job": "...", "result": {...}} or {"line": n, "job": "...", "error": "..."}.
+ *
+ * @param jobFile
+ * @param outputFile
+ * @param threads Number of worker threads (at least 1)
+ * @return int Number of jobs that failed, or -1 if a file could not be opened
+ */
+int runBatch(const std::string& jobFile, const std::string& outputFile, int threads,
+             const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+             const std::vector<Pipe>& pipes, const std::vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_BATCH_H
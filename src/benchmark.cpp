@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include "Actions.h"
+#include "balance.h"
+#include "deliverable.h"
+#include "parametric.h"
+#include "simulation.h"
+#include "supply.h"
+#include "pipemetrics.h"
+#include "generator.h"
+#include "parse.h"
+#include "reliability.h"
+#include "perfcounters.h"
+#include "allocations.h"
+
+namespace {
+
+/**
+ * @brief Measurements of one run of a benchmark case
+ */
+struct Sample {
+    double seconds;
+    Allocations::Usage heap;
+    HardwareCounters::Reading counters;
+};
+
+/**
+ * @brief Summary of all the runs of a case on one network
+ *
+ * A solve is one complete run of the timed operation, so solves per second is
+ * the throughput of that operation.
+ */
+struct Result {
+    std::string name;
+    std::string network;
+    size_t samples = 0;
+    double median = 0, p90 = 0, p99 = 0;
+    double solvesPerSecond = 0;
+    double allocationsPerRun = 0;
+    double bytesPerRun = 0;
+    double peakBytes = 0;
+    double instructionsPerRun = 0;
+    double ipc = 0;
+    double cacheMissesPerRun = 0;
+    double branchMissesPerRun = 0;
+};
+
+struct Options {
+    std::string dataset = "../Dataset";
+    std::vector<double> scales = {1, 4, 16};
+    Topology topology = Topology::GRID;
+    uint64_t seed = 1;
+    double limitedStations = 0;
+    int iterations = 15;
+    double maxSeconds = 2;
+    bool allScales = false;
+    bool counters = false;
+    std::vector<std::string> cases;
+    std::string csv;
+    std::string baseline;
+};
+
+/**
+ * @brief A timed operation
+ *
+ * prepare runs before every sample and is not timed; it rebuilds whatever the
+ * operation consumes.
+ */
+struct Case {
+    std::string name;
+    double maxScale;
+    std::function<void(Graph&, Actions&)> prepare;
+    std::function<void(Graph&, Actions&)> run;
+};
+
+/**
+ * @brief Nearest-rank percentile of sorted values
+ */
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t) std::ceil(p / 100 * (double) sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+/**
+ * @brief Add the super source S and super sink Si used by Actions to a graph
+ */
+template <typename F>
+void attachSuperNodes(BasicGraph<F>& g, const Network& network) {
+    g.addVertex("Si", VertexType::CITY, 20000);
+    g.addVertex("S", VertexType::RESERVOIR, 10000);
+    for (const auto& c : network.cities)
+        g.addEdge(c.getCode(), "Si", 1, FlowTraits<F>::fromQuantity(c.getDemand()));
+    for (const auto& r : network.reservoirs)
+        g.addEdge("S", r.getCode(), 1, FlowTraits<F>::fromQuantity(r.getMaxDelivery()));
+}
+
+template <typename F>
+void resetFlows(BasicGraph<F>& g) {
+    for (auto v : g.getVertexSet())
+        for (auto e : v->getAdj())
+            e->setFlow(F());
+}
+
+template <typename F = int>
+BasicGraph<F> build(const Network& network) {
+    BasicGraph<F> g;
+    return g.buildGraph(network.reservoirs, network.stations, network.pipes, network.cities);
+}
+
+/**
+ * @brief Edmonds-Karp on capacities of type F, on a graph of its own
+ */
+template <typename F>
+Case edmondsKarpAs(const Network& network) {
+    auto typed = std::make_shared<BasicGraph<F>>();
+    return {std::string("edmondsKarp<") + FlowTraits<F>::NAME + ">", 1e9,
+            [&network, typed](Graph&, Actions&) {
+                *typed = build<F>(network);
+                attachSuperNodes(*typed, network);
+                resetFlows(*typed);
+            },
+            [typed](Graph&, Actions&) { typed->edmondsKarp("S", "Si"); }};
+}
+
+/**
+ * @brief A week of generated profiles, every hour warm-started from the last or solved from zero
+ */
+Case simulateWeek(const Network& network, bool warm) {
+    auto profiles = std::make_shared<std::vector<ProfileChange>>(generateProfiles(network, 168, 1));
+    auto simulation = std::make_shared<std::unique_ptr<Simulation>>();
+    return {warm ? "simulateWeek" : "simulateWeek<cold>", 1e9,
+            [&network, profiles, simulation, warm](Graph&, Actions&) {
+                *simulation = std::make_unique<Simulation>(network.reservoirs, network.stations, network.pipes, network.cities);
+                std::string error;
+                (*simulation)->addProfile(*profiles, error);
+                (*simulation)->setWarmStart(warm);
+            },
+            [simulation](Graph&, Actions&) {
+                std::vector<int> flows;
+                for (int hour = 0; hour < 168; hour++) (*simulation)->step(flows);
+            }};
+}
+
+std::vector<Case> makeCases(const Network& network) {
+    auto fresh = [&network](Graph& g, Actions&) { g = build(network); };
+    auto superNodes = [&network](Graph& g, Actions&) {
+        g = build(network);
+        attachSuperNodes(g, network);
+        resetFlows(g);
+    };
+    std::string city = network.cities.front().getCode();
+    return {
+        {"buildGraph", 1e9, [](Graph&, Actions&) {},
+         [&network](Graph& g, Actions&) { g = build(network); }},
+        {"bfs", 1e9, superNodes,
+         [](Graph& g, Actions&) { g.bfs(g.findVertex("S"), g.findVertex("Si")); }},
+        {"edmondsKarp", 1e9, superNodes,
+         [](Graph& g, Actions&) { g.edmondsKarp("S", "Si"); }},
+        edmondsKarpAs<int64_t>(network),
+        edmondsKarpAs<double>(network),
+        edmondsKarpAs<Milli>(network),
+        {"balanceFlows", 1e9, fresh,
+         [&network](Graph& g, Actions&) { balanceFlows(g, network.reservoirs, network.cities); }},
+        {"sweepDemands", 1e9, fresh,
+         [&network](Graph& g, Actions&) { sweepDemands(g, network.reservoirs, network.cities); }},
+        {"maxDeliverable", 1e9, fresh,
+         [&network](Graph& g, Actions&) { maxDeliverable(g, network.reservoirs, network.cities); }},
+        {"traceSupply", 1e9,
+         [&network](Graph& g, Actions& a) {
+             g = build(network);
+             a.maxFlowAllCities(g);
+         },
+         [&network](Graph& g, Actions&) { traceSupply(g, network.reservoirs, network.cities); }},
+        simulateWeek(network, true),
+        simulateWeek(network, false),
+        {"estimateReliability", 1e9, [](Graph&, Actions&) {},
+         [&network](Graph&, Actions&) {
+             ReliabilityOptions options;
+             options.pipeFailure = options.stationFailure = options.reservoirFailure = 0.01;
+             options.minSamples = options.maxSamples = 1000;
+             estimateReliability(network.reservoirs, network.stations, network.pipes, network.cities, options);
+         }},
+        {"measurePipes", 1e9, fresh,
+         [](Graph& g, Actions&) { measurePipes(g); }},
+        {"maxFlowAllCities", 4, fresh,
+         [](Graph& g, Actions& a) { a.maxFlowAllCities(g); }},
+        {"analyzePumpingStations", 1, fresh,
+         [](Graph& g, Actions& a) { a.analyzePumpingStations(g); }},
+        {"crucialPipelines", 4, fresh,
+         [city](Graph& g, Actions& a) {
+             vector<Pipe> crucial;
+             a.crucialPipelines(g, city, crucial);
+         }},
+    };
+}
+
+Result measure(const Case& c, const std::string& networkName, const Network& network, const Options& options) {
+    Actions actions(network.reservoirs, network.stations, network.cities, network.pipes);
+    Graph g;
+    std::vector<Sample> samples;
+    double elapsed = 0;
+
+    // One untimed warm-up run, then sample until the iteration count or the time budget runs out
+    for (int i = 0; i <= options.iterations && (i <= 1 || elapsed < options.maxSeconds); i++) {
+        c.prepare(g, actions);
+        HardwareCounters::Reading counters;
+        Allocations::Usage heap;
+        std::chrono::steady_clock::time_point start, end;
+        {
+            Allocations::Scope heapScope;
+            HardwareCounters::Scope scope(counters);
+            start = std::chrono::steady_clock::now();
+            c.run(g, actions);
+            end = std::chrono::steady_clock::now();
+            heap = heapScope.usage();
+        }
+        Sample s{std::chrono::duration<double>(end - start).count(), heap, counters};
+        if (i > 0) {
+            samples.push_back(s);
+            elapsed += s.seconds;
+        }
+    }
+
+    Result r;
+    r.name = c.name;
+    r.network = networkName;
+    r.samples = samples.size();
+    std::vector<double> times;
+    double total = 0;
+    HardwareCounters::Reading counters;
+    for (const auto& s : samples) {
+        counters += s.counters;
+        times.push_back(s.seconds);
+        total += s.seconds;
+        r.allocationsPerRun += (double) s.heap.allocations;
+        r.bytesPerRun += (double) s.heap.bytes;
+        r.peakBytes = std::max(r.peakBytes, (double) s.heap.peak);
+    }
+    std::sort(times.begin(), times.end());
+    r.median = percentile(times, 50);
+    r.p90 = percentile(times, 90);
+    r.p99 = percentile(times, 99);
+    r.solvesPerSecond = total > 0 ? (double) samples.size() / total : 0;
+    r.allocationsPerRun /= (double) samples.size();
+    r.bytesPerRun /= (double) samples.size();
+    r.instructionsPerRun = (double) counters[HardwareCounters::INSTRUCTIONS] / (double) samples.size();
+    r.ipc = counters[HardwareCounters::CYCLES] == 0 ? 0
+          : (double) counters[HardwareCounters::INSTRUCTIONS] / (double) counters[HardwareCounters::CYCLES];
+    r.cacheMissesPerRun = (double) counters[HardwareCounters::CACHE_MISSES] / (double) samples.size();
+    r.branchMissesPerRun = (double) counters[HardwareCounters::BRANCH_MISSES] / (double) samples.size();
+    return r;
+}
+
+std::map<std::string, double> loadBaseline(const std::string& path) {
+    std::map<std::string, double> medians;
+    std::ifstream file(path);
+    std::string line;
+    getline(file, line);
+    while (getline(file, line)) {
+        std::istringstream iss(line);
+        std::string name, network, samples, median;
+        getline(iss, name, ',');
+        getline(iss, network, ',');
+        getline(iss, samples, ',');
+        getline(iss, median, ',');
+        medians[name + "," + network] = std::stod(median);
+    }
+    return medians;
+}
+
+void report(const std::vector<Result>& results, const Options& options) {
+    std::map<std::string, double> baseline;
+    if (!options.baseline.empty())
+        baseline = loadBaseline(options.baseline);
+
+    std::cout << std::left << std::setw(24) << "case" << std::setw(16) << "network" << std::right
+              << std::setw(6) << "runs" << std::setw(12) << "median ms" << std::setw(12) << "p90 ms"
+              << std::setw(12) << "p99 ms" << std::setw(12) << "solves/s" << std::setw(12) << "allocs"
+              << std::setw(12) << "KiB" << std::setw(12) << "peak KiB";
+    if (options.counters)
+        std::cout << std::setw(14) << "instructions" << std::setw(8) << "IPC" << std::setw(14) << "cache misses"
+                  << std::setw(14) << "branch misses";
+    if (!baseline.empty()) std::cout << std::setw(10) << "speedup";
+    std::cout << "\n" << std::fixed;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(24) << r.name << std::setw(16) << r.network << std::right
+                  << std::setw(6) << r.samples << std::setprecision(3)
+                  << std::setw(12) << r.median * 1e3 << std::setw(12) << r.p90 * 1e3 << std::setw(12) << r.p99 * 1e3
+                  << std::setprecision(1) << std::setw(12) << r.solvesPerSecond
+                  << std::setprecision(0) << std::setw(12) << r.allocationsPerRun
+                  << std::setw(12) << r.bytesPerRun / 1024 << std::setw(12) << r.peakBytes / 1024;
+        if (options.counters)
+            std::cout << std::setw(14) << r.instructionsPerRun << std::setprecision(2) << std::setw(8) << r.ipc
+                      << std::setprecision(0) << std::setw(14) << r.cacheMissesPerRun
+                      << std::setw(14) << r.branchMissesPerRun;
+        auto it = baseline.find(r.name + "," + r.network);
+        if (it != baseline.end())
+            std::cout << std::setprecision(2) << std::setw(9) << it->second / (r.median * 1e3) << "x";
+        std::cout << "\n";
+    }
+
+    if (!options.csv.empty()) {
+        std::ofstream file(options.csv);
+        file << "case,network,runs,median_ms,p90_ms,p99_ms,solves_per_sec,allocs_per_run,bytes_per_run,peak_bytes";
+        if (options.counters)
+            file << ",instructions_per_run,ipc,cache_misses_per_run,branch_misses_per_run";
+        file << "\n";
+        file << std::setprecision(6);
+        for (const auto& r : results) {
+            file << r.name << ',' << r.network << ',' << r.samples << ',' << r.median * 1e3 << ','
+                 << r.p90 * 1e3 << ',' << r.p99 * 1e3 << ',' << r.solvesPerSecond << ','
+                 << r.allocationsPerRun << ',' << r.bytesPerRun << ',' << r.peakBytes;
+            if (options.counters)
+                file << ',' << r.instructionsPerRun << ',' << r.ipc << ',' << r.cacheMissesPerRun << ','
+                     << r.branchMissesPerRun;
+            file << '\n';
+        }
+    }
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream iss(list);
+    std::string item;
+    while (getline(iss, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+void usage() {
+    std::cout << "Usage: Water_Supply_Benchmark [options]\n"
+              << "  --dataset <dir>       bundled dataset to run on (default ../Dataset, 'none' to skip)\n"
+              << "  --scales <list>       generated network sizes relative to the dataset (default 1,4,16)\n"
+              << "  --topology <name>     topology of the generated networks (default grid)\n"
+              << "  --seed <n>            generator seed (default 1)\n"
+              << "  --limited-stations <f>  give this share of the generated stations a pumping limit (default 0)\n"
+              << "  --iterations <n>      timed runs per case (default 15)\n"
+              << "  --max-seconds <s>     stop sampling a case after this much time (default 2)\n"
+              << "  --cases <list>        only run these cases\n"
+              << "  --all-scales          run the slow analyses on every scale\n"
+              << "  --counters            add CPU hardware counters per run, where perf events are available\n"
+              << "  --csv <file>          write the results as CSV\n"
+              << "  --baseline <file>     compare medians against an earlier --csv file\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        if (arg == "--all-scales") {
+            options.allScales = true;
+            continue;
+        }
+        if (arg == "--counters") {
+            options.counters = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--dataset") options.dataset = value;
+            else if (arg == "--scales") {
+                options.scales.clear();
+                for (const auto& s : split(value)) options.scales.push_back(std::stod(s));
+            }
+            else if (arg == "--topology") {
+                if (!parseTopology(value, options.topology)) {
+                    std::cerr << "Unknown topology " << value << "\n";
+                    return 1;
+                }
+            }
+            else if (arg == "--seed") options.seed = std::stoull(value);
+            else if (arg == "--limited-stations") options.limitedStations = std::stod(value);
+            else if (arg == "--iterations") options.iterations = std::max(1, std::stoi(value));
+            else if (arg == "--max-seconds") options.maxSeconds = std::stod(value);
+            else if (arg == "--cases") options.cases = split(value);
+            else if (arg == "--csv") options.csv = value;
+            else if (arg == "--baseline") options.baseline = value;
+            else {
+                std::cerr << "Unknown option " << arg << "\n";
+                usage();
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    if (options.counters) {
+        std::string error;
+        if (!HardwareCounters::enable(error)) {
+            std::cerr << "Hardware counters unavailable, measuring without them: " << error << "\n";
+            options.counters = false;
+        }
+    }
+
+    std::vector<std::pair<std::string, Network>> networks;
+    if (options.dataset != "none") {
+        Network dataset;
+        std::string error;
+        if (!parseDataset(options.dataset, dataset.reservoirs, dataset.stations, dataset.pipes, dataset.cities, error)) {
+            std::cerr << "Could not read the dataset: " << error << "\n";
+            return 1;
+        }
+        networks.emplace_back("dataset", std::move(dataset));
+    }
+    for (double scale : options.scales) {
+        GeneratorOptions g;
+        g.topology = options.topology;
+        g.seed = options.seed;
+        g.reservoirs = std::max(1, (int) (24 * scale));
+        g.stations = std::max(1, (int) (81 * scale));
+        g.cities = std::max(1, (int) (22 * scale));
+        g.pipes = std::max(1L, (long) (173 * scale));
+        g.limitedStations = options.limitedStations;
+        std::ostringstream name;
+        name << topologyName(options.topology) << " x" << scale << (g.limitedStations > 0 ? " limited" : "");
+        networks.emplace_back(name.str(), generateNetwork(g));
+    }
+
+    std::vector<Result> results;
+    for (const auto& [name, network] : networks) {
+        double scale = (double) network.pipes.size() / 173;
+        for (const auto& c : makeCases(network)) {
+            if (!options.cases.empty() && std::find(options.cases.begin(), options.cases.end(), c.name) == options.cases.end())
+                continue;
+            if (!options.allScales && scale > c.maxScale * 1.01)
+                continue;
+            results.push_back(measure(c, name, network, options));
+            std::cerr << "  " << c.name << " on " << name << " done\n";
+        }
+    }
+    report(results, options);
+    return 0;
+}
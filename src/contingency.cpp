@@ -0,0 +1,252 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "contingency.h"
+#include "trace.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const datasetFiles[] = {"Reservoir.csv", "Stations.csv", "Pipes.csv", "Cities.csv"};
+
+uint64_t fnv1a(uint64_t h, const char* bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char) bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief The edges closed to take a component out of service, as the analyses in Actions close them
+ */
+vector<Edge*> outageEdges(Graph& g, const string& code) {
+    return g.getAdjacentEdges(code);
+}
+
+vector<Edge*> outageEdges(Graph& g, const Pipe& pipe) {
+    vector<Edge*> edges;
+    Edge* edge = g.findEdge(pipe.getPointA(), pipe.getPointB());
+    if (edge == nullptr) {
+        return edges;
+    }
+    edges.push_back(edge);
+    return edges;
+}
+
+template <typename T>
+void append(vector<char>& out, const T* values, size_t n) {
+    const char* bytes = reinterpret_cast<const char*>(values);
+    out.insert(out.end(), bytes, bytes + n * sizeof(T));
+}
+
+}
+
+ContingencyMatrix::~ContingencyMatrix() {
+    release();
+}
+
+void ContingencyMatrix::release() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    baseline = nullptr;
+    offsets = nullptr;
+    impacts = nullptr;
+}
+
+bool ContingencyMatrix::hashDataset(const std::string& directory, uint64_t& hash, std::string& error) {
+    hash = fnv1a(0xcbf29ce484222325ULL, "WSCM", 4);
+    for (const char* name : datasetFiles) {
+        std::ifstream file(directory + "/" + name, std::ios::binary);
+        if (!file.is_open()) {
+            error = "cannot read " + directory + "/" + name;
+            return false;
+        }
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        hash = fnv1a(hash, name, strlen(name) + 1);
+        hash = fnv1a(hash, contents.data(), contents.size());
+    }
+    return true;
+}
+
+bool ContingencyMatrix::attach(uint64_t hash, size_t cities, size_t components) {
+    Header header;
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(Header));
+    if (memcmp(header.magic, "WSCM", 4) != 0 || header.format != FORMAT || header.hash != hash
+        || header.cities != cities || header.components != components) {
+        return false;
+    }
+
+    size_t tables = sizeof(Header) + cities * sizeof(int32_t) + (components + 1) * sizeof(uint32_t);
+    if (size < tables) {
+        return false;
+    }
+    const uint32_t* offs = reinterpret_cast<const uint32_t*>(data + sizeof(Header) + cities * sizeof(int32_t));
+    for (size_t i = 0; i < components; i++) {
+        if (offs[i] > offs[i + 1]) {
+            return false;
+        }
+    }
+    if (size != tables + (size_t) offs[components] * sizeof(Impact)) {
+        return false;
+    }
+
+    baseline = reinterpret_cast<const int32_t*>(data + sizeof(Header));
+    offsets = offs;
+    impacts = reinterpret_cast<const Impact*>(data + tables);
+    for (size_t i = 0; i < offsets[components]; i++) {
+        if (impacts[i].city >= cities) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ContingencyMatrix::load(const std::string& path, uint64_t hash, size_t cities, size_t components) {
+    release();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const char*>(addr);
+    size = (size_t) st.st_size;
+    mapped = true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+#endif
+    if (!attach(hash, cities, components)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void ContingencyMatrix::build(Graph& g, Actions& a, const vector<Reservoir>& reservoirs, const vector<Station>& stations,
+                              const vector<Pipe>& pipes, const vector<City>& cities, uint64_t hash) {
+    release();
+
+    vector<int> flows = a.maxFlowAllCities(g);
+    vector<int32_t> base(flows.begin(), flows.end());
+
+    vector<vector<Edge*>> outages;
+    vector<string> names;
+    for (const auto& r : reservoirs) {
+        outages.push_back(outageEdges(g, r.getCode()));
+        names.push_back(r.getCode());
+    }
+    for (const auto& s : stations) {
+        outages.push_back(outageEdges(g, s.getCode()));
+        names.push_back(s.getCode());
+    }
+    for (const auto& p : pipes) {
+        outages.push_back(outageEdges(g, p));
+        names.push_back(p.getPointA() + "-" + p.getPointB());
+    }
+
+    vector<uint32_t> offs = {0};
+    vector<Impact> found;
+    for (size_t c = 0; c < outages.size(); c++) {
+        const auto& edges = outages[c];
+        Trace::Scope scope("outage", names[c]);
+        vector<int> capacities;
+        for (auto edge : edges) {
+            capacities.push_back(edge->getCapacity());
+            edge->setCapacity(0);
+        }
+        if (!edges.empty()) {
+            flows = a.maxFlowAllCities(g);
+            for (size_t i = 0; i < cities.size(); i++) {
+                if (flows[i] < base[i]) {
+                    found.push_back({(uint32_t) i, flows[i]});
+                }
+            }
+        }
+        // Backwards, in case the same edge was closed twice
+        for (size_t i = edges.size(); i-- > 0;) {
+            edges[i]->setCapacity(capacities[i]);
+        }
+        offs.push_back((uint32_t) found.size());
+    }
+
+    Header header;
+    memcpy(header.magic, "WSCM", 4);
+    header.format = FORMAT;
+    header.hash = hash;
+    header.cities = (uint32_t) cities.size();
+    header.components = (uint32_t) outages.size();
+
+    append(buffer, &header, 1);
+    append(buffer, base.data(), base.size());
+    append(buffer, offs.data(), offs.size());
+    append(buffer, found.data(), found.size());
+    data = buffer.data();
+    size = buffer.size();
+    attach(hash, cities.size(), outages.size());
+}
+
+bool ContingencyMatrix::save(const std::string& path, std::string& error) const {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(data, (std::streamsize) size)) {
+            error = "cannot write " + temporary;
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool ContingencyMatrix::isMapped() const {
+    return mapped;
+}
+
+int ContingencyMatrix::getBaseline(size_t city) const {
+    return baseline[city];
+}
+
+size_t ContingencyMatrix::getImpactCount(size_t component) const {
+    return offsets[component + 1] - offsets[component];
+}
+
+const ContingencyMatrix::Impact* ContingencyMatrix::getImpacts(size_t component) const {
+    return impacts + offsets[component];
+}
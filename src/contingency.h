@@ -0,0 +1,112 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_CONTINGENCY_H
+#define WATER_SUPPLY_MANAGEMENT_CONTINGENCY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Actions.h"
+
+/**
+ * @brief Flow reaching every city with each component out of service, one at a time
+ *
+ * The components are the reservoirs, then the stations, then the pipes, each
+ * in dataset order, and they are taken out of service exactly as
+ * Actions::analyseReservoirs, Actions::analyzePumpingStations and
+ * Actions::crucialPipelines do it. Only the cities that lose water are stored.
+ *
+ * The matrix is computed once per dataset and saved next to it, tagged with a
+ * hash of the CSV files, so later runs map it from disk instead of solving
+ * again until the data changes.
+ *
+ * File layout, in native byte order:
+ *
+ *     char     magic[4]            "WSCM"
+ *     uint32_t format
+ *     uint64_t hash                hashDataset of the CSVs it was computed from
+ *     uint32_t cities
+ *     uint32_t components
+ *     int32_t  baseline[cities]    flow reaching each city with everything in service
+ *     uint32_t offsets[components + 1]
+ *     Impact   impacts[offsets[components]]
+ */
+class ContingencyMatrix {
+public:
+    struct Impact {
+        uint32_t city; // position in the cities vector
+        int32_t flow;  // flow reaching the city with the component out of service
+    };
+
+    ContingencyMatrix() = default;
+    ~ContingencyMatrix();
+    ContingencyMatrix(const ContingencyMatrix&) = delete;
+    ContingencyMatrix& operator=(const ContingencyMatrix&) = delete;
+
+    /**
+     * @brief Hash the contents of the dataset's CSV files
+     *
+     * @param directory
+     * @param hash
+     * @param error Set when a file cannot be read
+     * @return false if a file cannot be read
+     */
+    static bool hashDataset(const std::string& directory, uint64_t& hash, std::string& error);
+    /**
+     * @brief Map a matrix saved earlier
+     *
+     * @param path
+     * @param hash The dataset hash the matrix must have been computed from
+     * @param cities
+     * @param components
+     * @return false if there is no such file or it does not match the dataset
+     */
+    bool load(const std::string& path, uint64_t hash, size_t cities, size_t components);
+    /**
+     * @brief Compute the matrix by solving once per component
+     *
+     * The graph is left as it was found.
+     */
+    void build(Graph& g, Actions& a, const vector<Reservoir>& reservoirs, const vector<Station>& stations,
+               const vector<Pipe>& pipes, const vector<City>& cities, uint64_t hash);
+    /**
+     * @brief Save the matrix, replacing the file only once it is completely written
+     *
+     * @param path
+     * @param error
+     * @return false if the file could not be written
+     */
+    bool save(const std::string& path, std::string& error) const;
+
+    bool isMapped() const;
+    int getBaseline(size_t city) const;
+    size_t getImpactCount(size_t component) const;
+    const Impact* getImpacts(size_t component) const;
+
+private:
+    static const uint32_t FORMAT = 3; // 2: both edges of a bidirectional pipe are closed, 3: a bidirectional pipe is one edge
+
+    struct Header {
+        char magic[4];
+        uint32_t format;
+        uint64_t hash;
+        uint32_t cities;
+        uint32_t components;
+    };
+
+    vector<char> buffer;
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+
+    const int32_t* baseline = nullptr;
+    const uint32_t* offsets = nullptr;
+    const Impact* impacts = nullptr;
+
+    /**
+     * @brief Check the layout of data and point the arrays into it
+     */
+    bool attach(uint64_t hash, size_t cities, size_t components);
+    void release();
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_CONTINGENCY_H
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "deliverable.h"
+#include "residual.h"
+#include "trace.h"
+
+namespace {
+
+/**
+ * @brief The network with an arc to the sink from every city, closed until the city's turn
+ */
+struct CitySinks {
+    ArcTopology topology;
+    int source, sink;
+    vector<int> sinkArc;        // by city id, -1 for a city not in the graph
+    vector<long long> bound;    // what the reservoirs and the city's own pipes allow
+    vector<int> distances;      // from the source, the same for every city
+
+    CitySinks(const SplitNetwork& split, size_t cities): topology(split.getNodes()), source(split.getSource()),
+                                                         sink(split.getSink()), sinkArc(cities, -1), bound(cities, 0) {
+        long long delivery = 0;
+        for (const SplitArc& arc : split.getArcs()) {
+            if (arc.kind == SplitArc::DEMAND) {
+                sinkArc[arc.vertex->getId() - 1] = topology.addArc(arc.from, arc.to, 0);
+                continue;
+            }
+            topology.addArc(arc.from, arc.to, arc.capacity);
+            if (arc.kind == SplitArc::DELIVERY) delivery += arc.capacity;
+            if (arc.kind == SplitArc::PIPE && arc.vertex->isType(VertexType::CITY)) bound[arc.vertex->getId() - 1] += arc.capacity;
+        }
+        topology.index();
+        for (long long& b : bound) b = std::min(b, delivery);
+
+        // The first search of every solve is the same one from the source, done once and shared
+        distances = ResidualNetwork(topology).distancesFrom(source);
+    }
+
+    /**
+     * @brief The maximum flow with the city alone as the sink, on a network over the topology
+     */
+    long long solve(ResidualNetwork& network, size_t city) const {
+        if (sinkArc[city] < 0) return 0;
+        network.reset();
+        network.setCapacity(sinkArc[city], ResidualNetwork::UNLIMITED);
+        // Once the bound is met there is nothing left to prove
+        return network.maxFlow(source, sink, bound[city], &distances);
+    }
+};
+
+}
+
+vector<long long> maxDeliverable(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities,
+                                 int threads) {
+    const CitySinks sinks(SplitNetwork(g, reservoirs, cities), cities.size());
+
+    vector<long long> flows(cities.size(), 0);
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        ResidualNetwork network(sinks.topology);
+        for (size_t city = next++; city < cities.size(); city = next++) {
+            flows[city] = sinks.solve(network, city);
+        }
+    };
+
+    threads = std::max(1, std::min(threads, (int) cities.size()));
+    vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back([&work, t] {
+            Trace::nameThread("deliverable worker " + std::to_string(t));
+            work();
+        });
+    }
+    work();
+    for (auto& w : workers) w.join();
+    return flows;
+}
+
+long long maxDeliverableTo(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities, int city) {
+    const CitySinks sinks(SplitNetwork(g, reservoirs, cities), cities.size());
+    ResidualNetwork network(sinks.topology);
+    return sinks.solve(network, (size_t) city);
+}
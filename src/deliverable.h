@@ -0,0 +1,49 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_DELIVERABLE_H
+#define WATER_SUPPLY_MANAGEMENT_DELIVERABLE_H
+
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief Find, for every city, the most water it could receive with no other city drawing from the network
+ *
+ * Actions::maxFlowSpecificCity reports a city's share of one maximum flow to
+ * all the cities at once, which depends on the order the paths were found
+ * in. This is the maximum flow with the city as the only sink, limited by the
+ * reservoirs' deliveries, the pipes and the stations but not by its demand:
+ * an upper bound on any share it can get.
+ *
+ * The network is laid out once, read-only (ArcTopology), and shared by the
+ * workers, each with its own residual capacities and search buffers
+ * (ResidualNetwork) that it reuses from city to city. Every solve is Dinic's
+ * algorithm from the same source, over the same network but for one arc to
+ * the sink, so the first search is the same for all of them: it is done once
+ * and its distances shared. A solve stops as soon as the city gets what its
+ * own pipes (or the reservoirs) can carry, without a last search to prove it.
+ *
+ * Pipe capacities (as they are, with closed pipes at 0), station limits and
+ * reservoir deliveries are as in Actions. The super source and sink are
+ * ignored if attached; the graph is not changed.
+ *
+ * @param g
+ * @param reservoirs Their maximum deliveries, by id
+ * @param cities
+ * @param threads Workers, at least 1
+ * @return vector<long long> The flow of each city, by id
+ */
+vector<long long> maxDeliverable(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities,
+                                 int threads = 1);
+/**
+ * @brief Find the most water that could reach one city with no other city drawing from the network
+ *
+ * The figure maxDeliverable finds for the city, from a single solve.
+ *
+ * @param g
+ * @param reservoirs Their maximum deliveries, by id
+ * @param cities
+ * @param city Its id - 1
+ * @return long long
+ */
+long long maxDeliverableTo(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities, int city);
+
+#endif //WATER_SUPPLY_MANAGEMENT_DELIVERABLE_H
@@ -0,0 +1,27 @@
+#include <algorithm>
+#include "dictionary.h"
+
+CodeDictionary::CodeDictionary(vector<string> codes_): codes(std::move(codes_)) {
+    for (size_t i = 0; i < codes.size(); i++) {
+        ids.emplace(codes[i], (int) i);
+        sorted.push_back((int) i);
+    }
+    std::sort(sorted.begin(), sorted.end(), [this](int a, int b) { return codes[a] < codes[b]; });
+}
+
+int CodeDictionary::find(const string& code) const {
+    auto it = ids.find(code);
+    return it == ids.end() ? -1 : it->second;
+}
+
+const string& CodeDictionary::code(int id) const {
+    return codes[id];
+}
+
+size_t CodeDictionary::size() const {
+    return codes.size();
+}
+
+const vector<int>& CodeDictionary::inCodeOrder() const {
+    return sorted;
+}
@@ -0,0 +1,61 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_DICTIONARY_H
+#define WATER_SUPPLY_MANAGEMENT_DICTIONARY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Dense ids for the codes of one kind of entity
+ *
+ * The analyses index their results by id, the position of the entity in the
+ * dataset (a city's id is its Id column minus one), and only turn ids back
+ * into codes to read a code from the user or to display a result.
+ */
+class CodeDictionary {
+    vector<string> codes;
+    unordered_map<string, int> ids;
+    vector<int> sorted;
+public:
+    CodeDictionary() = default;
+    /**
+     * @brief Construct a dictionary giving each code its position as id
+     *
+     * @param codes
+     */
+    explicit CodeDictionary(vector<string> codes);
+    /**
+     * @brief Construct a dictionary from the codes of reservoirs, stations or cities
+     *
+     * @param entities
+     * @return CodeDictionary
+     */
+    template <typename T>
+    static CodeDictionary of(const vector<T>& entities) {
+        vector<string> codes;
+        codes.reserve(entities.size());
+        for (const auto& e : entities) {
+            codes.push_back(e.getCode());
+        }
+        return CodeDictionary(std::move(codes));
+    }
+    /**
+     * @brief Get the id of a code
+     *
+     * @param code
+     * @return int -1 if the code is unknown
+     */
+    int find(const string& code) const;
+    const string& code(int id) const;
+    size_t size() const;
+    /**
+     * @brief Get every id, ordered by code, for listings sorted by code
+     *
+     * @return const vector<int>&
+     */
+    const vector<int>& inCodeOrder() const;
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_DICTIONARY_H
@@ -0,0 +1,146 @@
+#include "flowmodel.h"
+#include "stats.h"
+#include "trace.h"
+
+FlowModel::FlowModel(const vector<Reservoir>& reservoirs, const vector<Station>& stations, const vector<Pipe>& pipes_, const vector<City>& cities_): pipes(pipes_), cities(cities_), cityCodes(CodeDictionary::of(cities_)) {
+    graph = graph.buildGraph(reservoirs, stations, pipes, cities);
+
+    // Same super source and sink as Actions::maxFlowSpecificCity
+    graph.addVertex("Si", VertexType::CITY, 20000);
+    graph.addVertex("S", VertexType::RESERVOIR, 10000);
+    for (const auto& c : cities) {
+        graph.addEdge(c.getCode(), "Si", 1, (int) c.getDemand());
+        cityVertices.push_back(graph.findVertex(c.getCode()));
+    }
+    for (const auto& r : reservoirs) {
+        graph.addEdge("S", r.getCode(), 1, r.getMaxDelivery());
+    }
+    source = graph.findVertex("S");
+    sink = graph.findVertex("Si");
+    for (Vertex* v : graph.getVertexSet()) {
+        if (v != source && v != sink) vertices[v->getInfo()] = v;
+    }
+    for (size_t i = 0; i < pipes.size(); i++) {
+        pipeIds.emplace(pipes[i].getPointA() + "-" + pipes[i].getPointB(), i);
+        pipeIds.emplace(pipes[i].getPointB() + "-" + pipes[i].getPointA(), i);
+    }
+
+    Trace::Scope scope("baseline solve");
+    graph.edmondsKarp("S", "Si");
+
+    for (auto v : graph.getVertexSet()) {
+        for (auto e : v->getAdj()) {
+            edges.push_back(e);
+            baselineFlow.push_back(e->getFlow());
+        }
+    }
+    baseline = cityFlows();
+    baselineSlack = graph.getSlackTally();
+}
+
+vector<int> FlowModel::cityFlows() const {
+    vector<int> flows(cities.size(), 0);
+    for (size_t i = 0; i < cities.size(); i++) {
+        flows[i] = cityVertices[i]->getInflow();
+    }
+    return flows;
+}
+
+bool FlowModel::componentEdges(const string& component, vector<Edge*>& out, string& error) const {
+    if (component.find('-') != string::npos) {
+        auto pipe = pipeIds.find(component);
+        if (pipe == pipeIds.end()) {
+            error = "pipe " + component + " not found";
+            return false;
+        }
+        // A bidirectional pipe is a single undirected edge, found from either end
+        const Pipe& p = pipes[pipe->second];
+        auto end = vertices.find(p.getPointA());
+        if (end == vertices.end()) return true;
+        Vertex* a = end->second;
+        for (Edge* e : a->getAdj()) {
+            if (e->getDest()->getInfo() == p.getPointB()) {
+                out.push_back(e);
+                return true;
+            }
+        }
+        for (Edge* e : a->getPath()) {
+            if (e->isUndirected() && e->getSource()->getInfo() == p.getPointB()) {
+                out.push_back(e);
+                return true;
+            }
+        }
+        return true;
+    }
+
+    auto it = vertices.find(component);
+    if (it == vertices.end() || it->second->isType(VertexType::CITY)) {
+        error = "reservoir or station " + component + " not found";
+        return false;
+    }
+    // Same edges as Graph::getAdjacentEdges
+    Vertex* v = it->second;
+    out.insert(out.end(), v->getAdj().begin(), v->getAdj().end());
+    for (Edge* e : v->getPath()) {
+        if (e->isUndirected()) out.push_back(e);
+    }
+    return true;
+}
+
+const vector<int>& FlowModel::getBaseline() const {
+    return baseline;
+}
+
+const SlackTally<int>& FlowModel::getBaselineSlack() const {
+    return baselineSlack;
+}
+
+const vector<City>& FlowModel::getCities() const {
+    return cities;
+}
+
+const CodeDictionary& FlowModel::getCityCodes() const {
+    return cityCodes;
+}
+
+bool FlowModel::solve(const vector<string>& disabled, vector<int>& flows, string& error, SlackTally<int>* slack) {
+    string components;
+    if (Trace::isActive()) {
+        for (const auto& component : disabled) {
+            components += (components.empty() ? "" : " ") + component;
+        }
+    }
+    Trace::Scope scope("warm-start solve", components);
+    vector<Edge*> closed;
+    for (const auto& component : disabled) {
+        if (!componentEdges(component, closed, error)) {
+            return false;
+        }
+    }
+    solve(closed, flows, slack);
+    return true;
+}
+
+void FlowModel::solve(const vector<Edge*>& closed, vector<int>& flows, SlackTally<int>* slack) {
+    vector<int> capacities;
+    for (Edge* e : closed) {
+        capacities.push_back(e->getCapacity());
+        graph.cancelFlow(e, source, sink);
+        e->setCapacity(0);
+    }
+
+    graph.augment(source, sink);
+    {
+        STATS_PHASE(READ_FLOWS);
+        flows = cityFlows();
+        if (slack != nullptr) *slack = graph.getSlackTally();
+    }
+
+    // Restore in reverse, so an edge closed twice gets its original capacity back
+    for (size_t i = closed.size(); i-- > 0;) {
+        closed[i]->setCapacity(capacities[i]);
+    }
+    for (size_t i = 0; i < edges.size(); i++) {
+        edges[i]->setFlow(baselineFlow[i]);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_FLOWMODEL_H
+#define WATER_SUPPLY_MANAGEMENT_FLOWMODEL_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "graph.h"
+#include "dictionary.h"
+
+/**
+ * @brief A network kept in memory together with its baseline maximum flow
+ *
+ * What-if questions ("how much reaches each city without R_3?") are answered
+ * by warm-starting from the baseline: the flow through the disabled components
+ * is cancelled and the remaining flow is augmented back to a maximum, instead
+ * of solving from zero. The graph is back at the baseline after every solve.
+ *
+ * The baseline is the same solution Actions::maxFlowAllCities reports. A
+ * warm-started solve reaches the same total flow as a cold one, but may split
+ * it between cities differently when the maximum flow is not unique.
+ */
+class FlowModel {
+    Graph graph;
+    Vertex* source;
+    Vertex* sink;
+    vector<Pipe> pipes;
+    vector<City> cities;
+    CodeDictionary cityCodes;
+    vector<Vertex*> cityVertices;
+    vector<Edge*> edges;
+    unordered_map<string, Vertex*> vertices;    // by code, without the super source and sink
+    unordered_map<string, size_t> pipeIds;      // by "A-B" and "B-A", the first pipe between the two
+    vector<int> baselineFlow;
+    vector<int> baseline;
+    SlackTally<int> baselineSlack;
+
+    vector<int> cityFlows() const;
+public:
+    FlowModel(const vector<Reservoir>& reservoirs, const vector<Station>& stations, const vector<Pipe>& pipes, const vector<City>& cities);
+    FlowModel(const FlowModel&) = delete;
+    FlowModel& operator=(const FlowModel&) = delete;
+
+    /**
+     * @brief Get the flow reaching each city with every component in service
+     *
+     * @return const vector<int>& The flow of each city, by city id
+     */
+    const vector<int>& getBaseline() const;
+    /**
+     * @brief Get the spare capacity of the pipes with every component in service
+     *
+     * @return const SlackTally<int>&
+     */
+    const SlackTally<int>& getBaselineSlack() const;
+    /**
+     * @brief Get the cities of the network
+     *
+     * @return const vector<City>&
+     */
+    const vector<City>& getCities() const;
+    /**
+     * @brief Get the codes of the cities, by id
+     *
+     * @return const CodeDictionary&
+     */
+    const CodeDictionary& getCityCodes() const;
+    /**
+     * @brief Find the edges to close to take a component out of service
+     *
+     * @param component A reservoir or station code, or a pipe as "A-B"
+     * @param out The edges are appended to it
+     * @param error Set when the component does not exist
+     * @return false if the component does not exist
+     */
+    bool componentEdges(const string& component, vector<Edge*>& out, string& error) const;
+    /**
+     * @brief Compute the flow reaching each city with some components out of service
+     *
+     * @param disabled Reservoir and station codes, and pipes written as "A-B"
+     * @param flows Set to the flow reaching each city, by city id
+     * @param error Set when a component does not exist
+     * @param slack If given, set to the spare capacity of the pipes in the scenario, read off the
+     * graph's running tally rather than its edges
+     * @return false if a component does not exist
+     */
+    bool solve(const vector<string>& disabled, vector<int>& flows, string& error, SlackTally<int>* slack = nullptr);
+    /**
+     * @brief Compute the flow reaching each city with some edges closed
+     *
+     * For callers that look the components' edges up once (componentEdges)
+     * and solve many scenarios over them. An edge may be listed more than once.
+     *
+     * @param closed Edges of this model's graph
+     * @param flows Set to the flow reaching each city, by city id
+     * @param slack If given, set to the spare capacity of the pipes in the scenario
+     */
+    void solve(const vector<Edge*>& closed, vector<int>& flows, SlackTally<int>* slack = nullptr);
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_FLOWMODEL_H
@@ -0,0 +1,100 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_FLOWTYPE_H
+#define WATER_SUPPLY_MANAGEMENT_FLOWTYPE_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+constexpr int64_t powerOfTen(int exponent) {
+    return exponent == 0 ? 1 : 10 * powerOfTen(exponent - 1);
+}
+
+/**
+ * @brief A quantity stored as an integer count of 10^-Decimals units
+ *
+ * Sums and differences are exact, like integers, while demands with a
+ * fractional part are kept to Decimals places instead of being truncated.
+ */
+template <int Decimals>
+class FixedPoint {
+    int64_t raw = 0;
+public:
+    static constexpr int64_t SCALE = powerOfTen(Decimals);
+
+    constexpr FixedPoint() = default;
+    /**
+     * @brief The nearest representable value to a quantity in whole units
+     *
+     * @param units
+     */
+    explicit FixedPoint(double units): raw(std::llround(units * (double) SCALE)) {}
+    static constexpr FixedPoint fromRaw(int64_t r) {
+        FixedPoint f;
+        f.raw = r;
+        return f;
+    }
+    constexpr int64_t getRaw() const { return raw; }
+    double toDouble() const { return (double) raw / (double) SCALE; }
+
+    constexpr FixedPoint operator+(FixedPoint o) const { return fromRaw(raw + o.raw); }
+    constexpr FixedPoint operator-(FixedPoint o) const { return fromRaw(raw - o.raw); }
+    FixedPoint& operator+=(FixedPoint o) { raw += o.raw; return *this; }
+    FixedPoint& operator-=(FixedPoint o) { raw -= o.raw; return *this; }
+    constexpr bool operator==(FixedPoint o) const { return raw == o.raw; }
+    constexpr bool operator!=(FixedPoint o) const { return raw != o.raw; }
+    constexpr bool operator<(FixedPoint o) const { return raw < o.raw; }
+    constexpr bool operator>(FixedPoint o) const { return raw > o.raw; }
+    constexpr bool operator<=(FixedPoint o) const { return raw <= o.raw; }
+    constexpr bool operator>=(FixedPoint o) const { return raw >= o.raw; }
+};
+
+/**
+ * @brief What the flow engine needs to know about a capacity type
+ *
+ * The primary template covers the integer types: quantities read from the
+ * dataset are truncated, as the engine always did with int, and any positive
+ * residual is usable.
+ */
+template <typename F>
+struct FlowTraits {
+    static constexpr const char* NAME = std::numeric_limits<F>::digits > 32 ? "int64" : "int32";
+
+    static F infinity() { return std::numeric_limits<F>::max(); }
+    static F fromQuantity(double units) { return (F) units; }
+    static double toDouble(F value) { return (double) value; }
+    static bool positive(F value) { return value > 0; }
+};
+
+/**
+ * @brief Floating point capacities, exact for fractional demands
+ *
+ * Residuals below EPSILON are treated as zero, so that rounding left over from
+ * repeated augmentations does not keep producing paths of negligible flow.
+ */
+template <>
+struct FlowTraits<double> {
+    static constexpr const char* NAME = "double";
+    static constexpr double EPSILON = 1e-9;
+
+    static double infinity() { return std::numeric_limits<double>::infinity(); }
+    static double fromQuantity(double units) { return units; }
+    static double toDouble(double value) { return value; }
+    static bool positive(double value) { return value > EPSILON; }
+};
+
+template <int Decimals>
+struct FlowTraits<FixedPoint<Decimals>> {
+    static constexpr const char* NAME = "fixed";
+
+    static FixedPoint<Decimals> infinity() { return FixedPoint<Decimals>::fromRaw(std::numeric_limits<int64_t>::max()); }
+    static FixedPoint<Decimals> fromQuantity(double units) { return FixedPoint<Decimals>(units); }
+    static double toDouble(FixedPoint<Decimals> value) { return value.toDouble(); }
+    static bool positive(FixedPoint<Decimals> value) { return value.getRaw() > 0; }
+};
+
+/**
+ * @brief Thousandths of a unit, the fixed-point type the engine is compiled for
+ */
+using Milli = FixedPoint<3>;
+
+#endif //WATER_SUPPLY_MANAGEMENT_FLOWTYPE_H
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+#include "generator.h"
+#include "random.h"
+
+namespace {
+
+class NetworkBuilder {
+    const GeneratorOptions& options;
+    Random rng;
+    Network network;
+    std::unordered_set<uint64_t> links;
+    std::vector<long> endpoints;
+
+    static uint64_t linkKey(long a, long b) {
+        if (a > b) std::swap(a, b);
+        return ((uint64_t) a << 32) | (uint64_t) b;
+    }
+
+    /**
+     * @brief Add a pipe between two stations, unless they are already linked
+     *
+     * @return true If the pipe was added
+     */
+    bool addStationLink(long a, long b, int capacity, int direction) {
+        if (a == b || !links.insert(linkKey(a, b)).second)
+            return false;
+        network.pipes.emplace_back("PS_" + std::to_string(a + 1), "PS_" + std::to_string(b + 1), capacity, direction);
+        endpoints.push_back(a);
+        endpoints.push_back(b);
+        return true;
+    }
+
+    bool addReservoirOutlet(long r, long s) {
+        if (!links.insert(linkKey(options.stations + r, s)).second)
+            return false;
+        network.pipes.emplace_back("R_" + std::to_string(r + 1), "PS_" + std::to_string(s + 1),
+                                   (int) rng.uniform(1000, 14000), 1);
+        return true;
+    }
+
+    bool addCityFeeder(long s, long c) {
+        if (!links.insert(linkKey(options.stations + options.reservoirs + c, s)).second)
+            return false;
+        network.pipes.emplace_back("PS_" + std::to_string(s + 1), "C_" + std::to_string(c + 1),
+                                   (int) rng.uniform(10, 1000), 1);
+        return true;
+    }
+
+    int meshDirection() {
+        return rng.chance(0.6) ? 0 : 1;
+    }
+
+    int meshCapacity() {
+        return (int) rng.uniform(200, 3000);
+    }
+
+    /**
+     * @brief Keep drawing candidate pipes until the budget is spent or candidates run out
+     *
+     * @param count Number of pipes to add
+     * @param candidate Draws one pipe and returns whether it was new
+     */
+    template<typename F>
+    void fill(long count, F candidate) {
+        long failures = 0, limit = 64 + count * 8;
+        while (count > 0 && failures < limit) {
+            if (candidate(failures)) count--;
+            else failures++;
+        }
+    }
+
+    /// Split the pipes left after the backbone into outlets, feeders and station links
+    void addExtras(long extra, const std::function<bool(long)>& stationLink,
+                   const std::function<long()>& outletStation, const std::function<long(long)>& feederStation) {
+        long outlets = extra / 10;
+        long feeders = extra / 5;
+        fill(outlets, [&](long) { return addReservoirOutlet(rng.uniform(0, options.reservoirs - 1), outletStation()); });
+        fill(feeders, [&](long) {
+            long c = rng.uniform(0, options.cities - 1);
+            return addCityFeeder(feederStation(c), c);
+        });
+        fill(extra - outlets - feeders, stationLink);
+    }
+
+    void buildGrid(long extra) {
+        long s = options.stations;
+        long w = (long) std::ceil(std::sqrt((double) s));
+        // Rows plus the first column make a comb that reaches every station
+        for (long i = 1; i < s; i++) {
+            if (i % w != 0) addStationLink(i - 1, i, meshCapacity(), meshDirection());
+            else addStationLink(i - w, i, meshCapacity(), meshDirection());
+        }
+        auto near = [&](long i, long radius) {
+            for (;;) {
+                long x = i % w + rng.uniform(-radius, radius);
+                long y = i / w + rng.uniform(-radius, radius);
+                if (x >= 0 && x < w && y >= 0 && x + y * w < s) return x + y * w;
+            }
+        };
+        auto border = [&]() {
+            long i = rng.uniform(0, s - 1);
+            switch (rng.uniform(0, 3)) {
+                case 0: return i % w;
+                case 1: return std::min(s - 1, (w - 1) + (i / w) * w);
+                case 2: return (i / w) * w;
+                default: return std::min(s - 1, (s - 1) / w * w + i % w);
+            }
+        };
+        std::vector<long> home(options.cities);
+        for (long r = 0; r < options.reservoirs; r++) addReservoirOutlet(r, border());
+        for (long c = 0; c < options.cities; c++) {
+            home[c] = rng.uniform(0, s - 1);
+            addCityFeeder(home[c], c);
+        }
+        addExtras(extra,
+                  [&](long failures) {
+                      long i = rng.uniform(0, s - 1);
+                      return addStationLink(i, near(i, 1 + failures / 32), meshCapacity(), meshDirection());
+                  },
+                  border,
+                  [&](long c) { return near(home[c], 1); });
+    }
+
+    void buildTree(long extra) {
+        long s = options.stations;
+        long roots = std::max<long>(1, std::min<long>(options.reservoirs, s / 4));
+        std::vector<int> depth(s, 0);
+        // The roots hang from reservoirs rather than from each other
+        extra += roots - 1;
+        // Station i belongs to tree i % roots and hangs from an earlier station of the same tree
+        for (long i = roots; i < s; i++) {
+            long t = i % roots, k = i / roots;
+            long parent = t + rng.uniform(k / 2, k - 1) * roots;
+            depth[i] = depth[parent] + 1;
+            int capacity = std::max(20, (int) (8000 * std::pow(0.85, depth[i])));
+            addStationLink(parent, i, capacity, 1);
+        }
+        std::vector<long> home(options.cities);
+        for (long r = 0; r < options.reservoirs; r++) addReservoirOutlet(r, r % roots);
+        auto deep = [&]() { return rng.uniform(s / 2, s - 1); };
+        for (long c = 0; c < options.cities; c++) {
+            home[c] = deep();
+            addCityFeeder(home[c], c);
+        }
+        addExtras(extra,
+                  [&](long failures) {
+                      // Loop closures between branches at a similar depth
+                      long i = rng.uniform(0, s - 1);
+                      long reach = std::min(s, roots * (4 + failures / 32));
+                      long j = rng.uniform(std::max(0L, i - reach), std::min(s - 1, i + reach));
+                      return addStationLink(i, j, (int) rng.uniform(50, 1500), 0);
+                  },
+                  [&]() { return rng.uniform(0, roots - 1); },
+                  [&](long c) { return rng.chance(0.5) ? deep() : home[c]; });
+    }
+
+    void buildScaleFree(long extra) {
+        long s = options.stations;
+        long budget = extra * 7 / 10;
+        long m = std::min<long>(50, 1 + (budget + s - 1) / s);
+        auto preferential = [&]() { return endpoints[rng.uniform(0, (long) endpoints.size() - 1)]; };
+        endpoints.push_back(0);
+        long used = 0;
+        for (long i = 1; i < s; i++) {
+            // The first link keeps the network connected, all of them follow the degree distribution
+            addStationLink(preferential(), i, meshCapacity(), meshDirection());
+            for (long k = 1; k < std::min(m, i) && used < budget; k++)
+                if (addStationLink(preferential(), i, meshCapacity(), meshDirection())) used++;
+        }
+        for (long r = 0; r < options.reservoirs; r++) addReservoirOutlet(r, preferential());
+        for (long c = 0; c < options.cities; c++) addCityFeeder(rng.uniform(0, s - 1), c);
+        long outlets = extra / 10, feeders = extra / 5;
+        fill(outlets, [&](long) { return addReservoirOutlet(rng.uniform(0, options.reservoirs - 1), preferential()); });
+        fill(feeders, [&](long) { return addCityFeeder(rng.uniform(0, s - 1), rng.uniform(0, options.cities - 1)); });
+        fill(extra - outlets - feeders - used, [&](long) {
+            return addStationLink(preferential(), rng.uniform(0, s - 1), meshCapacity(), meshDirection());
+        });
+    }
+
+    void buildClusters(long extra) {
+        long s = options.stations;
+        long k = std::max<long>(1, std::min<long>(options.clusters, s));
+        auto member = [&](long cluster) {
+            long size = (s - cluster + k - 1) / k;
+            return cluster + rng.uniform(0, size - 1) * k;
+        };
+        // Random spanning tree inside each region
+        for (long i = k; i < s; i++)
+            addStationLink(i - k * rng.uniform(1, i / k), i, meshCapacity(), meshDirection());
+        // Trunks between the first stations of consecutive regions
+        for (long c = 1; c < k; c++)
+            addStationLink(c - 1, c, (int) rng.uniform(3000, 8000), 0);
+        for (long r = 0; r < options.reservoirs; r++) addReservoirOutlet(r, member(r % k));
+        for (long c = 0; c < options.cities; c++) addCityFeeder(member(c % k), c);
+        addExtras(extra,
+                  [&](long) {
+                      long a = member(rng.uniform(0, k - 1));
+                      if (rng.chance(0.1))
+                          return addStationLink(a, member(rng.uniform(0, k - 1)), (int) rng.uniform(3000, 8000), 0);
+                      return addStationLink(a, member(a % k), meshCapacity(), meshDirection());
+                  },
+                  [&]() { return member(rng.uniform(0, k - 1)); },
+                  [&](long c) { return member(c % k); });
+    }
+
+    /**
+     * @brief Give a share of the stations a pumping limit below what their pipes bring in
+     *
+     * Drawn from a generator of its own, so the rest of the network is the
+     * same with or without limits.
+     */
+    void limitStations() {
+        if (options.limitedStations <= 0)
+            return;
+        Random limits(options.seed ^ 0x53544154494F4E53ULL);
+        std::vector<long> inflow(network.stations.size(), 0);
+        auto station = [](const std::string& code) {
+            return code.rfind("PS_", 0) == 0 ? std::stol(code.substr(3)) - 1 : -1L;
+        };
+        for (const auto& p : network.pipes) {
+            long b = station(p.getPointB());
+            if (b >= 0) inflow[b] += p.getCapacity();
+            long a = station(p.getPointA());
+            if (a >= 0 && p.getDirection() == 0) inflow[a] += p.getCapacity();
+        }
+        for (size_t i = 0; i < network.stations.size(); i++) {
+            if (!limits.chance(options.limitedStations) || inflow[i] == 0)
+                continue;
+            int capacity = std::max(1, (int) std::lround((double) inflow[i] * (0.2 + 0.6 * limits.real())));
+            network.stations[i] = Station(network.stations[i].getId(), network.stations[i].getCode(), capacity);
+        }
+    }
+
+public:
+    explicit NetworkBuilder(const GeneratorOptions& o): options(o), rng(o.seed) {}
+
+    Network build() {
+        double totalDemand = 0;
+        for (int c = 0; c < options.cities; c++) {
+            float demand = (float) rng.uniform(2000, 80000) / 100;
+            totalDemand += demand;
+            network.cities.emplace_back("City " + std::to_string(c + 1), c + 1, "C_" + std::to_string(c + 1),
+                                        demand, (int) rng.uniform(1000, 500000));
+        }
+        // Reservoirs can deliver about 30% more than the cities ask for, unevenly spread
+        std::vector<double> share(options.reservoirs);
+        double shareSum = 0;
+        for (auto& x : share) shareSum += (x = 0.2 + rng.real());
+        for (int r = 0; r < options.reservoirs; r++) {
+            int delivery = std::max(1, (int) std::lround(1.3 * totalDemand * share[r] / shareSum));
+            network.reservoirs.emplace_back("Reservoir " + std::to_string(r + 1),
+                                            "Region " + std::to_string(r % std::max(1, options.clusters) + 1),
+                                            r + 1, "R_" + std::to_string(r + 1), delivery);
+        }
+        for (int i = 0; i < options.stations; i++)
+            network.stations.emplace_back(i + 1, "PS_" + std::to_string(i + 1));
+
+        long base = options.reservoirs + options.cities + options.stations - 1;
+        long extra = std::max(0L, options.pipes - base);
+        network.pipes.reserve(std::max(base, options.pipes));
+        switch (options.topology) {
+            case Topology::GRID: buildGrid(extra); break;
+            case Topology::TREE: buildTree(extra); break;
+            case Topology::SCALE_FREE: buildScaleFree(extra); break;
+            case Topology::CLUSTERS: buildClusters(extra); break;
+        }
+        limitStations();
+        return std::move(network);
+    }
+};
+
+}
+
+Network generateNetwork(const GeneratorOptions& options) {
+    if (options.reservoirs < 1 || options.stations < 1 || options.cities < 1)
+        return {};
+    return NetworkBuilder(options).build();
+}
+
+std::vector<ProfileChange> generateProfiles(const Network& network, int hours, uint64_t seed) {
+    const double HOURS_PER_YEAR = 8760, HOURS_PER_MONTH = 730;
+    Random rng(seed);
+    std::vector<double> offsets;    // when each city's day peaks, in hours from 15:00
+    for (size_t i = 0; i < network.cities.size(); i++) offsets.push_back(rng.real() * 4 - 2);
+
+    std::vector<ProfileChange> changes;
+    for (int hour = 0; hour < hours; hour++) {
+        if (hour % (int) HOURS_PER_MONTH == 0) {
+            // Wettest in January, driest in late July
+            double season = 0.85 + 0.2 * std::cos(2 * M_PI * hour / HOURS_PER_YEAR);
+            for (const auto& r : network.reservoirs) {
+                double value = r.getMaxDelivery() * season * (0.95 + 0.1 * rng.real());
+                changes.push_back({hour, r.getCode(), std::floor(value)});
+            }
+        }
+        // Highest in late July
+        double season = 1 + 0.15 * std::cos(2 * M_PI * (hour - 4900) / HOURS_PER_YEAR);
+        for (size_t i = 0; i < network.cities.size(); i++) {
+            const City& c = network.cities[i];
+            double day = 1 + 0.3 * std::sin(2 * M_PI * (hour % 24 - 9 - offsets[i]) / 24);
+            double value = c.getDemand() * day * season * (0.97 + 0.06 * rng.real());
+            changes.push_back({hour, c.getCode(), std::round(value * 100) / 100});
+        }
+    }
+    return changes;
+}
+
+bool writeNetwork(const Network& network, const std::string& directory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::ofstream reservoirs(directory + "/Reservoir.csv");
+    std::ofstream stations(directory + "/Stations.csv");
+    std::ofstream cities(directory + "/Cities.csv");
+    std::ofstream pipes(directory + "/Pipes.csv");
+    if (!reservoirs || !stations || !cities || !pipes)
+        return false;
+
+    reservoirs << "Reservoir,Municipality,Id,Code,Maximum Delivery (m3/sec)\n";
+    for (const auto& r : network.reservoirs)
+        reservoirs << r.getName() << ',' << r.getMunicipality() << ',' << r.getId() << ',' << r.getCode() << ','
+                   << r.getMaxDelivery() << '\n';
+
+    // The capacity column is only written when some station has a pumping limit
+    bool limited = std::any_of(network.stations.begin(), network.stations.end(),
+                               [](const Station& s) { return s.isLimited(); });
+    stations << (limited ? "Id,Code,Capacity\n" : "Id,Code\n");
+    for (const auto& s : network.stations) {
+        stations << s.getId() << ',' << s.getCode();
+        if (limited) {
+            stations << ',';
+            if (s.isLimited()) stations << s.getCapacity();
+        }
+        stations << '\n';
+    }
+
+    cities << "City,Id,Code,Demand,Population\n";
+    cities.setf(std::ios::fixed);
+    cities.precision(2);
+    for (const auto& c : network.cities)
+        cities << c.getName() << ',' << c.getId() << ',' << c.getCode() << ',' << c.getDemand() << ','
+               << c.getPopulation() << '\n';
+
+    pipes << "Service_Point_A,Service_Point_B,Capacity,Direction\n";
+    for (const auto& p : network.pipes)
+        pipes << p.getPointA() << ',' << p.getPointB() << ',' << p.getCapacity() << ',' << p.getDirection() << '\n';
+
+    return (bool) reservoirs && (bool) stations && (bool) cities && (bool) pipes;
+}
+
+bool parseTopology(const std::string& name, Topology& topology) {
+    if (name == "grid") topology = Topology::GRID;
+    else if (name == "tree") topology = Topology::TREE;
+    else if (name == "scale-free") topology = Topology::SCALE_FREE;
+    else if (name == "clusters") topology = Topology::CLUSTERS;
+    else return false;
+    return true;
+}
+
+std::string topologyName(Topology topology) {
+    switch (topology) {
+        case Topology::GRID: return "grid";
+        case Topology::TREE: return "tree";
+        case Topology::SCALE_FREE: return "scale-free";
+        case Topology::CLUSTERS: return "clusters";
+    }
+    return "";
+}
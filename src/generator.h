@@ -0,0 +1,103 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_GENERATOR_H
+#define WATER_SUPPLY_MANAGEMENT_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Reservoir.h"
+#include "Station.h"
+#include "City.h"
+#include "Pipe.h"
+#include "simulation.h"
+
+/**
+ * @brief Shape of the station network produced by the generator
+ */
+enum class Topology {
+    GRID,       ///< stations on a square lattice with local meshing
+    TREE,       ///< trunk mains branching from the reservoirs towards the cities
+    SCALE_FREE, ///< preferential attachment, a few heavily connected hubs
+    CLUSTERS    ///< dense regional meshes joined by a few inter-region trunks
+};
+
+/**
+ * @brief Parameters of a synthetic network
+ *
+ * The defaults reproduce the size of the bundled dataset. The pipe count is a
+ * target: every reservoir, station and city is always connected, so the
+ * generator never goes below the pipes needed for that.
+ */
+struct GeneratorOptions {
+    Topology topology = Topology::GRID;
+    int reservoirs = 24;
+    int stations = 81;
+    int cities = 22;
+    long pipes = 173;
+    int clusters = 8;
+    uint64_t seed = 1;
+    double limitedStations = 0; ///< share of the stations given a pumping limit
+};
+
+/**
+ * @brief Entities of a network, in the same form the parsers return them
+ */
+struct Network {
+    std::vector<Reservoir> reservoirs;
+    std::vector<Station> stations;
+    std::vector<City> cities;
+    std::vector<Pipe> pipes;
+};
+
+/**
+ * @brief Generate a synthetic water supply network
+ *
+ * The same options (seed included) always produce the same network, on every
+ * platform.
+ *
+ * @param options
+ * @return Network
+ */
+Network generateNetwork(const GeneratorOptions& options);
+/**
+ * @brief Write a network as Reservoir.csv, Stations.csv, Cities.csv and Pipes.csv
+ *
+ * @param network
+ * @param directory Created if it does not exist
+ * @return true
+ * @return false If a file could not be written
+ */
+bool writeNetwork(const Network& network, const std::string& directory);
+/**
+ * @brief Generate hourly demand and delivery profiles for a network, as Simulation reads them
+ *
+ * Every city's demand follows a daily curve (low at night, peaking in the
+ * afternoon, a little earlier or later from city to city) over a seasonal one
+ * (highest in summer), around its demand in the network, with some noise; a
+ * line per city and hour. Every reservoir's maximum delivery changes monthly,
+ * from above its value in winter to below it in late summer. Hour 0 is the
+ * start of January.
+ *
+ * @param network
+ * @param hours
+ * @param seed The same network, hours and seed always produce the same profiles
+ * @return std::vector<ProfileChange> In hour order
+ */
+std::vector<ProfileChange> generateProfiles(const Network& network, int hours, uint64_t seed);
+/**
+ * @brief Convert a topology name (grid, tree, scale-free, clusters) to a Topology
+ *
+ * @param name
+ * @param topology
+ * @return true
+ * @return false If the name is unknown
+ */
+bool parseTopology(const std::string& name, Topology& topology);
+/**
+ * @brief Get the name of a topology
+ *
+ * @param topology
+ * @return std::string
+ */
+std::string topologyName(Topology topology);
+
+#endif //WATER_SUPPLY_MANAGEMENT_GENERATOR_H
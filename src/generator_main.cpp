@@ -0,0 +1,124 @@
+#include <iostream>
+#include <string>
+#include "generator.h"
+#include "parse.h"
+
+namespace {
+
+void usage() {
+    std::cout << "Usage: Water_Supply_Generator [options]\n"
+              << "  --topology <grid|tree|scale-free|clusters>  (default grid)\n"
+              << "  --reservoirs <n>    (default 24)\n"
+              << "  --stations <n>      (default 81)\n"
+              << "  --cities <n>        (default 22)\n"
+              << "  --pipes <n>         target number of pipes (default 173)\n"
+              << "  --scale <f>         multiply the bundled dataset sizes by f\n"
+              << "  --clusters <n>      regions for the clusters topology (default 8)\n"
+              << "  --seed <n>          (default 1)\n"
+              << "  --limited-stations <f>  share of the stations given a pumping limit (default 0)\n"
+              << "  --hours <n>         also write Profiles.csv, n hours of demand and delivery profiles\n"
+              << "  --dataset <dir>     only write the profiles, for the network in <dir>\n"
+              << "  --output <dir>      (default generated)\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    std::string output = "generated";
+    std::string dataset;
+    int hours = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--topology") {
+                if (!parseTopology(value, options.topology)) {
+                    std::cerr << "Unknown topology " << value << "\n";
+                    return 1;
+                }
+            }
+            else if (arg == "--reservoirs") options.reservoirs = std::stoi(value);
+            else if (arg == "--stations") options.stations = std::stoi(value);
+            else if (arg == "--cities") options.cities = std::stoi(value);
+            else if (arg == "--pipes") options.pipes = std::stol(value);
+            else if (arg == "--clusters") options.clusters = std::stoi(value);
+            else if (arg == "--seed") options.seed = std::stoull(value);
+            else if (arg == "--limited-stations") options.limitedStations = std::stod(value);
+            else if (arg == "--output") output = value;
+            else if (arg == "--hours") hours = std::stoi(value);
+            else if (arg == "--dataset") dataset = value;
+            else if (arg == "--scale") {
+                double scale = std::stod(value);
+                options.reservoirs = std::max(1, (int) (24 * scale));
+                options.stations = std::max(1, (int) (81 * scale));
+                options.cities = std::max(1, (int) (22 * scale));
+                options.pipes = std::max(1L, (long) (173 * scale));
+            }
+            else {
+                std::cerr << "Unknown option " << arg << "\n";
+                usage();
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    if (!dataset.empty()) {
+        if (hours < 1) {
+            std::cerr << "--dataset needs --hours\n";
+            return 1;
+        }
+        Network network;
+        std::string error;
+        if (!parseDataset(dataset, network.reservoirs, network.stations, network.pipes, network.cities, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        std::string path = dataset + "/Profiles.csv";
+        if (!writeProfile(generateProfiles(network, hours, options.seed), path)) {
+            std::cerr << "Error: Unable to write " << path << "\n";
+            return 1;
+        }
+        std::cout << "Wrote " << hours << " hours of profiles for " << dataset << " to " << path << "\n";
+        return 0;
+    }
+
+    if (options.reservoirs < 1 || options.stations < 1 || options.cities < 1) {
+        std::cerr << "A network needs at least one reservoir, station and city\n";
+        return 1;
+    }
+
+    Network network = generateNetwork(options);
+    if (!writeNetwork(network, output)) {
+        std::cerr << "Error: Unable to write the network to " << output << "\n";
+        return 1;
+    }
+
+    std::cout << "Generated a " << topologyName(options.topology) << " network with "
+              << network.reservoirs.size() << " reservoirs, " << network.stations.size() << " stations, "
+              << network.cities.size() << " cities and " << network.pipes.size() << " pipes in " << output << "\n";
+    if (hours > 0) {
+        if (!writeProfile(generateProfiles(network, hours, options.seed), output + "/Profiles.csv")) {
+            std::cerr << "Error: Unable to write " << output << "/Profiles.csv\n";
+            return 1;
+        }
+        std::cout << "Wrote " << hours << " hours of demand and delivery profiles to " << output << "/Profiles.csv\n";
+    }
+    if ((long) network.pipes.size() < options.pipes)
+        std::cout << "The topology ran out of distinct pipes before reaching " << options.pipes
+                  << "; add stations to reach it.\n";
+    return 0;
+}
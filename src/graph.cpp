@@ -1,122 +1,382 @@
 #include <algorithm>
+#include <atomic>
 #include "graph.h"
+#include "stats.h"
 
-Vertex::Vertex(const std::string& in, int i, VertexType t): info(in), id(i), type(t) {}
+// Shared by every graph, so that graphs built separately never share a version
+static std::atomic<unsigned long> nextVersion(0);
 
-Edge::Edge(Vertex *d): dest(d) {}
+namespace {
 
-Edge::Edge(Vertex *s, Vertex *d, int ca):src(s), dest(d), capacity(ca) {}
+template <typename F>
+bool isSuper(const BasicVertex<F>* v) {
+    const std::string& info = v->getInfo();
+    return info == "S" || info == "Si";
+}
+
+}
 
-bool Vertex::isType(VertexType t) const {
+template <typename F>
+void SlackTally<F>::add(F slack) {
+    long double x = FlowTraits<F>::toDouble(slack);
+    pipes++;
+    sum += x;
+    squares += x * x;
+    if (!FlowTraits<F>::positive(slack)) saturated++;
+    if ((atMax == 0 && pipes == 1) || max < slack) {
+        max = slack;
+        atMax = 1;
+    }
+    else if (slack == max) {
+        atMax++;
+    }
+}
+
+template <typename F>
+void SlackTally<F>::remove(F slack) {
+    long double x = FlowTraits<F>::toDouble(slack);
+    pipes--;
+    sum -= x;
+    squares -= x * x;
+    if (!FlowTraits<F>::positive(slack)) saturated--;
+    if (slack == max && atMax > 0) atMax--;
+    if (pipes == 0) {
+        sum = squares = 0;
+        max = F();
+        atMax = 0;
+    }
+}
+
+template <typename F>
+size_t SlackTally<F>::getPipes() const {
+    return pipes;
+}
+
+template <typename F>
+size_t SlackTally<F>::getSaturated() const {
+    return saturated;
+}
+
+template <typename F>
+long double SlackTally<F>::getSum() const {
+    return sum;
+}
+
+template <typename F>
+long double SlackTally<F>::getSumOfSquares() const {
+    return squares;
+}
+
+template <typename F>
+double SlackTally<F>::getMean() const {
+    return pipes ? (double) (sum / pipes) : 0;
+}
+
+template <typename F>
+double SlackTally<F>::getVariance() const {
+    if (pipes < 2) return 0;
+    long double m2 = squares - sum * sum / pipes;
+    return m2 > 0 ? (double) (m2 / (pipes - 1)) : 0;
+}
+
+template <typename F>
+F SlackTally<F>::getMax() const {
+    return max;
+}
+
+template <typename F>
+BasicVertex<F>::BasicVertex(const std::string& in, int i, VertexType t): info(in), id(i), type(t) {}
+
+template <typename F>
+BasicEdge<F>::BasicEdge(Vertex *d): dest(d) {}
+
+template <typename F>
+BasicEdge<F>::BasicEdge(Vertex *s, Vertex *d, F ca, bool u):src(s), dest(d), flow(), capacity(ca), nominal(ca), undirected(u) {}
+
+template <typename F>
+bool BasicVertex<F>::isType(VertexType t) const {
     return type == t;
 }
 
-int Vertex::getId() const {
+template <typename F>
+int BasicVertex<F>::getId() const {
     return id;
 }
 
-std::string Vertex::getInfo() const {
+template <typename F>
+std::string BasicVertex<F>::getInfo() const {
     return info;
 }
 
-void Vertex::setInfo(const std::string& in) {
+template <typename F>
+void BasicVertex<F>::setInfo(const std::string& in) {
     info = in;
 }
 
-Edge* Vertex::getPrev() const {
+template <typename F>
+BasicEdge<F>* BasicVertex<F>::getPrev() const {
     return prev;
 }
 
-void Vertex::setPrev(Edge* p) {
+template <typename F>
+void BasicVertex<F>::setPrev(Edge* p) {
     prev = p;
 }
 
-Vertex* Edge::getDest() const {
+template <typename F>
+BasicVertex<F>* BasicEdge<F>::getDest() const {
     return dest;
 }
 
-Vertex* Edge::getSource() const {
+template <typename F>
+BasicVertex<F>* BasicEdge<F>::getSource() const {
     return src;
 }
 
-void Edge::setDest(Vertex* d) {
+template <typename F>
+void BasicEdge<F>::setDest(Vertex* d) {
     dest = d;
 }
 
-int Edge::getCapacity() const {
+template <typename F>
+F BasicEdge<F>::getCapacity() const {
     return capacity;
 }
 
-void Edge::setFlow(int f) {
+template <typename F>
+void BasicEdge<F>::assign(F f, F c) {
+    if (tally != nullptr) tally->remove(capacity - getCarried());
+    countThrough(false);
     flow = f;
+    capacity = c;
+    countThrough(true);
+    if (tally != nullptr) tally->add(capacity - getCarried());
+}
+
+template <typename F>
+void BasicEdge<F>::countThrough(bool add) {
+    if (flow > F()) {
+        dest->through = add ? dest->through + flow : dest->through - flow;
+    }
+    else if (flow < F()) {
+        src->through = add ? src->through - flow : src->through + flow;
+    }
+}
+
+template <typename F>
+void BasicEdge<F>::setFlow(F f) {
+    assign(f, capacity);
 }
 
-int Edge::getFlow() const {
+template <typename F>
+F BasicEdge<F>::getFlow() const {
     return flow;
 }
 
-void Edge::setCapacity(int c) {
-    capacity = c;
+template <typename F>
+void BasicEdge<F>::setCapacity(F c) {
+    assign(flow, c);
+}
+
+template <typename F>
+bool BasicEdge<F>::isUndirected() const {
+    return undirected;
+}
+
+template <typename F>
+F BasicEdge<F>::getResidual(const Vertex* from) const {
+    if (from == src) {
+        return capacity - flow;
+    }
+    // Back from dest: cancel the flow, and for a pipe that works both ways, use its capacity too
+    return undirected ? capacity + flow : flow;
+}
+
+template <typename F>
+F BasicEdge<F>::getCarried() const {
+    return flow < F() ? F() - flow : flow;
 }
 
-Vertex* Graph::findVertex(const std::string& in) const {
+template <typename F>
+BasicVertex<F>* BasicGraph<F>::findVertex(const std::string& in) const {
     for (auto v : vertexSet)
         if (v->info == in)
             return v;
     return nullptr;
 }
 
-vector<Vertex *> Graph::getVertexSet() const {
+template <typename F>
+vector<BasicVertex<F>*> BasicGraph<F>::getVertexSet() const {
     return vertexSet;
 }
 
-std::vector<Edge*> Graph::getAdjacentEdges(const std::string& vertexInfo) const {
+template <typename F>
+vector<BasicEdge<F>*> BasicGraph<F>::getAdjacentEdges(const std::string& vertexInfo) const {
     std::vector<Edge*> adjacentEdges;
     for (auto v : vertexSet) {
         if (v->getInfo() == vertexInfo) {
             adjacentEdges = v->getAdj();
+            for (auto e : v->path) {
+                if (e->undirected) {
+                    adjacentEdges.push_back(e);
+                }
+            }
             break;
         }
     }
     return adjacentEdges;
 }
 
-bool Vertex::isVisited() const {
+template <typename F>
+unsigned long BasicGraph<F>::getVersion() const {
+    return version;
+}
+
+template <typename F>
+const SlackTally<F>& BasicGraph<F>::getSlackTally() const {
+    SlackTally<F>& t = *tally;
+    if (t.pipes > 0 && t.atMax == 0) {
+        // The pipes that had the largest slack all lost it since the last look
+        bool first = true;
+        for (auto v : vertexSet) {
+            for (auto e : v->adj) {
+                if (e->tally != tally.get()) continue;
+                F slack = e->capacity - e->getCarried();
+                if (first || t.max < slack) {
+                    t.max = slack;
+                    t.atMax = 1;
+                    first = false;
+                }
+                else if (slack == t.max) {
+                    t.atMax++;
+                }
+            }
+        }
+    }
+    return t;
+}
+
+template <typename F>
+void BasicGraph<F>::setVersion(unsigned long v) {
+    version = v;
+}
+
+template <typename F>
+vector<pair<int, F>> BasicGraph<F>::getModifiedEdges() const {
+    vector<pair<int, F>> modified;
+    int i = 0;
+    for (auto v : vertexSet) {
+        for (auto e : v->adj) {
+            if (e->capacity != e->nominal) {
+                modified.emplace_back(i, e->capacity);
+            }
+            i++;
+        }
+    }
+    return modified;
+}
+
+template <typename F>
+vector<F> BasicGraph<F>::getEdgeFlows() const {
+    vector<F> flows;
+    for (auto v : vertexSet) {
+        for (auto e : v->adj) {
+            flows.push_back(e->flow);
+        }
+    }
+    return flows;
+}
+
+template <typename F>
+void BasicGraph<F>::setEdgeFlows(const vector<F>& flows) {
+    size_t i = 0;
+    for (auto v : vertexSet) {
+        for (auto e : v->adj) {
+            e->setFlow(flows[i++]);
+        }
+    }
+}
+
+template <typename F>
+bool BasicVertex<F>::isVisited() const {
     return visited;
 }
 
-void Vertex::setVisited(bool v) {
+template <typename F>
+void BasicVertex<F>::setVisited(bool v) {
     visited = v;
 }
 
-std::vector<Edge*> Vertex::getAdj() const {
+template <typename F>
+const vector<BasicEdge<F>*>& BasicVertex<F>::getAdj() const {
     return adj;
 }
 
-vector<Edge *> Vertex::getPath() const {
+template <typename F>
+const vector<BasicEdge<F>*>& BasicVertex<F>::getPath() const {
     return path;
 }
 
-bool Graph::addVertex(const std::string& in, VertexType t, int id) {
+template <typename F>
+F BasicVertex<F>::getInflow() const {
+    F inflow = F();
+    for (auto e : path) {
+        if (e->flow > F()) inflow += e->flow;
+    }
+    for (auto e : adj) {
+        if (e->undirected && e->flow < F()) inflow -= e->flow;
+    }
+    return inflow;
+}
+
+template <typename F>
+void BasicVertex<F>::setLimit(F l) {
+    if (!limited && limitedCount != nullptr) (*limitedCount)++;
+    limited = true;
+    limit = l;
+}
+
+template <typename F>
+void BasicVertex<F>::removeLimit() {
+    if (limited && limitedCount != nullptr) (*limitedCount)--;
+    limited = false;
+}
+
+template <typename F>
+bool BasicVertex<F>::isLimited() const {
+    return limited;
+}
+
+template <typename F>
+F BasicVertex<F>::getLimit() const {
+    return limit;
+}
+
+template <typename F>
+bool BasicGraph<F>::addVertex(const std::string& in, VertexType t, int id) {
     if (findVertex(in) != nullptr)
         return false;
     vertexSet.push_back(new Vertex(in, id, t));
+    vertexSet.back()->limitedCount = limitedVertices.get();
+    version = ++nextVersion;
     return true;
 }
 
-Edge* Graph::findEdge(const std::string& source, const std::string& dest) {
-    // Iterate over all vertices
-    for (auto& vertex : vertexSet) {
-        // Iterate over adjacent edges of each vertex
-        for (auto& edge : vertex->getAdj()) {
-            // Check if the edge connects source and dest vertices
-            if (vertex->getInfo() == source && edge->getDest()->getInfo() == dest) {
-                return edge;
-            }
-                // If the edge is bidirectional, check the reverse direction
-            else if (vertex->getInfo() == dest && edge->getDest()->getInfo() == source) {
-                return edge;
-            }
+template <typename F>
+BasicEdge<F>* BasicGraph<F>::findEdge(const std::string& source, const std::string& dest) const {
+    // A directed edge only matches in its own direction, an undirected one in either
+    Vertex* v = findVertex(source);
+    if (v == nullptr) {
+        return nullptr;
+    }
+    for (auto edge : v->adj) {
+        if (edge->dest->info == dest) {
+            return edge;
+        }
+    }
+    for (auto edge : v->path) {
+        if (edge->undirected && edge->src->info == dest) {
+            return edge;
         }
     }
     // Edge not found
@@ -124,28 +384,37 @@ Edge* Graph::findEdge(const std::string& source, const std::string& dest) {
 }
 
 
-bool Graph::addEdge(const std::string& source, const std::string& dest, int direction, int capacity) {
+template <typename F>
+bool BasicGraph<F>::addEdge(const std::string& source, const std::string& dest, int direction, F capacity) {
     auto v1 = findVertex(source);
     auto v2 = findVertex(dest);
     if (v1 == nullptr || v2 == nullptr)
         return false;
+    Edge* edge = nullptr;
     if (direction == 1) {
-        v1->addEdge(v1, v2, capacity);
+        edge = v1->addEdge(v1, v2, capacity, false);
     }
     else if (direction==0) {
-        v1->addEdge(v1, v2, capacity);
-        v2->addEdge(v2, v1, capacity);
+        edge = v1->addEdge(v1, v2, capacity, true);
+    }
+    if (edge != nullptr && !isSuper(v1) && !isSuper(v2)) {
+        edge->tally = tally.get();
+        tally->add(edge->capacity - edge->getCarried());
     }
+    version = ++nextVersion;
     return true;
 }
 
-void Vertex::addEdge(Vertex* src, Vertex* dest, int capacity) {
-    Edge* edge = new Edge(src, dest, capacity);
+template <typename F>
+BasicEdge<F>* BasicVertex<F>::addEdge(Vertex* src, Vertex* dest, F capacity, bool undirected) {
+    Edge* edge = new Edge(src, dest, capacity, undirected);
     adj.push_back(edge);
     dest->path.push_back(edge);
+    return edge;
 }
 
-bool Vertex::removeEdgeTo(Vertex* d) {
+template <typename F>
+bool BasicVertex<F>::removeEdgeTo(Vertex* d) {
     for (auto it = adj.begin(); it != adj.end(); it++)
         if ((*it)->dest == d) {
             adj.erase(it);
@@ -156,32 +425,44 @@ bool Vertex::removeEdgeTo(Vertex* d) {
 
 
 
-bool Graph::removeVertex(const std::string& in) {
+template <typename F>
+bool BasicGraph<F>::removeVertex(const std::string& in) {
     for (auto it = vertexSet.begin(); it != vertexSet.end(); it++){
         //cout << "ccc";
         if ((*it)->info == in) {
             //cout << "ddd";
             Vertex * v = *it;
-            auto e = v->adj.begin();
-            while(e != v->adj.end()){
-                Edge *edge = *e;
-                e = v->adj.erase(e);
-                auto it2 = edge->dest->path.begin();
-                while(it2 != edge->dest->path.end()){
-                    it2 = edge->dest->path.erase(it2);
-                }
+            // Unlink its edges from the other ends only, which keep their other edges
+            for (Edge *edge : v->adj) {
+                auto& path = edge->dest->path;
+                path.erase(std::remove(path.begin(), path.end(), edge), path.end());
             }
-            for (auto u : vertexSet){
-                u->removeEdgeTo(v);
+            for (Edge *edge : v->path) {
+                auto& adj = edge->src->adj;
+                adj.erase(std::remove(adj.begin(), adj.end(), edge), adj.end());
             }
+            for (auto edges : {&v->adj, &v->path}) {
+                for (Edge *edge : *edges) {
+                    if (edge->tally != nullptr) edge->tally->remove(edge->capacity - edge->getCarried());
+                    edge->tally = nullptr;
+                    // The other end no longer receives what the edge carried
+                    edge->countThrough(false);
+                }
+            }
+            v->removeLimit();
+            v->limitedCount = nullptr;
+            v->adj.clear();
+            v->path.clear();
             vertexSet.erase(it);
+            version = ++nextVersion;
             return true;
         }
     }
     return false;
 }
 
-void Graph::dfsVisit(Vertex* v, std::vector<std::string>& res) const {
+template <typename F>
+void BasicGraph<F>::dfsVisit(Vertex* v, std::vector<std::string>& res) const {
     v->visited = true;
     res.push_back(v->info);
     for (auto& e : v->adj) {
@@ -191,22 +472,31 @@ void Graph::dfsVisit(Vertex* v, std::vector<std::string>& res) const {
     }
 }
 
-bool Graph::bfs(Vertex* src, Vertex* snk) {
-    queue<Vertex *> q;
+template <typename F>
+bool BasicGraph<F>::bfs(Vertex* src, Vertex* snk) {
+    STATS_PHASE(BFS);
+    sided = *limitedVertices > 0;
+    if (sided) {
+        return sidedBfs(src, snk);
+    }
 
-    for (auto it : this->getVertexSet()){
+    queue<Vertex *> q;
+    for (auto it : vertexSet){
         it->setVisited(false);
     }
 
     src->setVisited(true);
     q.push(src);
+    [[maybe_unused]] uint64_t visited = 0, scanned = 0;
 
     while (!q.empty() && !snk->isVisited()){
         Vertex* u = q.front();
         q.pop();
+        visited++;
+        scanned += u->adj.size() + u->path.size();
         for (auto edge: u->getAdj()){
             //cout << endl << "Residual : " << edge->getDest()->info<< ' ' << edge->capacity - edge->flow << endl;
-            if (edge->capacity - edge->flow > 0 && !edge->getDest()->isVisited()){
+            if (FlowTraits<F>::positive(edge->getResidual(u)) && !edge->getDest()->isVisited()){
                 Vertex* v = edge->getDest();
                 v->setVisited(true);
                 v->setPrev(edge);
@@ -217,7 +507,7 @@ bool Graph::bfs(Vertex* src, Vertex* snk) {
         for(auto edge: u->getPath()){
             //cout << endl << "Residual : " << edge->src->info<< ' ' << edge->capacity - edge->flow << endl;
             Vertex* v = edge->src;
-            if(edge->flow > 0 && !v->isVisited()){
+            if(FlowTraits<F>::positive(edge->getResidual(u)) && !v->isVisited()){
                 v->setVisited(true);
                 v->setPrev(edge);
                 q.push(v);
@@ -225,10 +515,136 @@ bool Graph::bfs(Vertex* src, Vertex* snk) {
             }
         }
     }
+    STATS_ADD(bfsPasses, 1);
+    STATS_ADD(verticesVisited, visited);
+    STATS_ADD(edgesScanned, scanned);
     return snk->isVisited();
 }
 
-Graph Graph::buildGraph(vector<Reservoir> reservoirs, vector<Station> stations, vector<Pipe> pipes, vector<City> cities){
+namespace {
+
+// The two kinds of residual capacity an edge offers from one of its ends to the other, in the split
+// graph sidedBfs searches: sending more flow that way, from the out side of one end to the in side of
+// the other, and cancelling flow that comes the other way, from the in side to the out side. Forward
+// is whether the way is from the edge's src to its dest
+
+template <typename F>
+F extension(const BasicEdge<F>* e, bool forward) {
+    F flow = e->getFlow();
+    if (forward) {
+        return e->getCapacity() - (flow > F() ? flow : F());
+    }
+    return e->isUndirected() ? e->getCapacity() - (flow < F() ? F() - flow : F()) : F();
+}
+
+template <typename F>
+F cancellation(const BasicEdge<F>* e, bool forward) {
+    F flow = e->getFlow();
+    if (forward) {
+        return flow < F() ? F() - flow : F();
+    }
+    return flow > F() ? flow : F();
+}
+
+}
+
+template <typename F>
+bool BasicGraph<F>::sidedBfs(Vertex* src, Vertex* snk) {
+    frontier.clear();
+    size_t head = 0;
+
+    for (auto v : vertexSet) {
+        v->visited = v->visitedOut = false;
+    }
+    auto reach = [&](Vertex* v, bool out, Edge* via) {
+        if (!v->limited) {
+            if (v->visited) return;
+            v->visited = v->visitedOut = true;
+            v->prev = out ? nullptr : via;
+            v->prevOut = out ? via : nullptr;
+        }
+        else {
+            bool& seen = out ? v->visitedOut : v->visited;
+            if (seen) return;
+            seen = true;
+            (out ? v->prevOut : v->prev) = via;
+        }
+        frontier.emplace_back(v, out);
+    };
+    reach(src, false, nullptr);
+    [[maybe_unused]] uint64_t visited = 0, scanned = 0;
+
+    while (head < frontier.size() && !snk->visited) {
+        Vertex* u = frontier[head].first;
+        bool out = frontier[head].second;
+        head++;
+        visited++;
+        scanned += u->adj.size() + u->path.size();
+        bool whole = !u->limited;
+        if (!whole) {
+            // Across the vertex: through its limit, or back by passing less on
+            if (!out && FlowTraits<F>::positive(u->limit - u->through)) reach(u, true, nullptr);
+            if (out && FlowTraits<F>::positive(u->through)) reach(u, false, nullptr);
+        }
+        auto cross = [&](Edge* e, Vertex* w, bool forward) {
+            if (whole && !w->limited) {
+                if (FlowTraits<F>::positive(e->getResidual(u))) reach(w, false, e);
+                return;
+            }
+            if ((whole || out) && FlowTraits<F>::positive(extension(e, forward))) reach(w, false, e);
+            if ((whole || !out) && FlowTraits<F>::positive(cancellation(e, forward))) reach(w, true, e);
+        };
+        for (auto e : u->adj) cross(e, e->dest, true);
+        for (auto e : u->path) cross(e, e->src, false);
+    }
+    STATS_ADD(bfsPasses, 1);
+    STATS_ADD(verticesVisited, visited);
+    STATS_ADD(edgesScanned, scanned);
+    return snk->visited;
+}
+
+template <typename F>
+F BasicGraph<F>::pushSided(Vertex* src, Vertex* snk) {
+    // Walk back from the sink, side by side, collecting the edges and the end flow leaves each by
+    vector<pair<Edge*, Vertex*>> steps;
+    F flow = FlowTraits<F>::infinity();
+    Vertex* v = snk;
+    bool out = false;
+    while (v != src) {
+        Edge* e = out ? v->prevOut : v->prev;
+        if (e == nullptr) {
+            if (v->limited) {
+                flow = std::min(flow, out ? v->limit - v->through : v->through);
+            }
+            out = !out;
+            continue;
+        }
+        Vertex* u = e->src == v ? e->dest : e->src;
+        if (!v->limited && !u->limited) {
+            flow = std::min(flow, e->getResidual(u));
+            out = false;
+        }
+        else if (!out) {
+            flow = std::min(flow, extension(e, u == e->src));
+            out = true;
+        }
+        else {
+            flow = std::min(flow, cancellation(e, u == e->src));
+            out = false;
+        }
+        steps.emplace_back(e, u);
+        v = u;
+    }
+    for (auto& step : steps) {
+        Edge* e = step.first;
+        if (step.second == e->src) e->setFlow(e->flow + flow);
+        else e->setFlow(e->flow - flow);
+    }
+    return flow;
+}
+
+template <typename F>
+BasicGraph<F> BasicGraph<F>::buildGraph(vector<Reservoir> reservoirs, vector<Station> stations, vector<Pipe> pipes, vector<City> cities){
     Graph g;
     for (auto r:reservoirs){
         g.addVertex(r.getCode(), VertexType::RESERVOIR, r.getId());
@@ -236,6 +652,9 @@ Graph Graph::buildGraph(vector<Reservoir> reservoirs, vector<Station> stations,
 
     for(auto s: stations){
         g.addVertex(s.getCode(), VertexType::STATION, s.getId());
+        if (s.isLimited()) {
+            g.findVertex(s.getCode())->setLimit(FlowTraits<F>::fromQuantity(s.getCapacity()));
+        }
     }
 
     for(auto c: cities){
@@ -243,17 +662,18 @@ Graph Graph::buildGraph(vector<Reservoir> reservoirs, vector<Station> stations,
     }
 
     for(auto p: pipes){
-        g.addEdge(p.getPointA(), p.getPointB(), p.getDirection(), p.getCapacity());
+        g.addEdge(p.getPointA(), p.getPointB(), p.getDirection(), FlowTraits<F>::fromQuantity(p.getCapacity()));
     }
 
     return g;
 }
 
-void Graph::updateFlow(Vertex *src, Vertex *snk, int flow) {
+template <typename F>
+void BasicGraph<F>::updateFlow(Vertex *src, Vertex *snk, F flow) {
     //cout << endl << "Flow : " << flow << endl;
     for (auto v = snk; v != src;) {
         auto e = v->getPrev();
-        int f = e->getFlow();
+        F f = e->getFlow();
         //cout <<"f : " << f << ' ';
         if (e->getDest()->info == v->info) {
             e->setFlow(f + flow);
@@ -266,42 +686,153 @@ void Graph::updateFlow(Vertex *src, Vertex *snk, int flow) {
     }
 }
 
-void Graph::edmondsKarp(const std::string &source, const std::string &sink) {
-    for (auto it : this->getVertexSet()){
-        for (auto it2 : it->getAdj()){
-            it2->setFlow(0);
+template <typename F>
+void BasicGraph<F>::edmondsKarp(const std::string &source, const std::string &sink) {
+    {
+        STATS_PHASE(RESET_FLOW);
+        for (auto it : this->getVertexSet()){
+            for (auto it2 : it->getAdj()){
+                it2->setFlow(F());
+            }
         }
     }
     Vertex* src = findVertex(source);
     Vertex* snk = findVertex(sink);
 
+    augment(src, snk);
+}
+
+template <typename F>
+void BasicGraph<F>::augment(Vertex* src, Vertex* snk) {
+    STATS_PHASE(AUGMENT);
+    [[maybe_unused]] uint64_t paths = 0, pushed = 0;
     while(bfs(src, snk)){
+        if (sided) {
+            F flow = pushSided(src, snk);
+            paths++;
+            pushed += (uint64_t) FlowTraits<F>::toDouble(flow);
+            continue;
+        }
 
-        int flow = INT_MAX;
+        F flow = FlowTraits<F>::infinity();
 
         for (auto it = snk; it!= src;){
             Edge* edge = it->getPrev();
             if(edge->getDest()->info == it->info){
                 it = edge->src;
-                flow = std::min(flow, edge->getCapacity() - edge->getFlow());
             }
             else {
                 it = edge->getDest();
-                flow = std::min(flow, edge->getFlow());
             }
+            flow = std::min(flow, edge->getResidual(it));
         }
         updateFlow(src, snk, flow);
+        paths++;
+        pushed += (uint64_t) FlowTraits<F>::toDouble(flow);
     }
+    STATS_ADD(solves, 1);
+    STATS_ADD(augmentingPaths, paths);
+    STATS_ADD(flowPushed, pushed);
+    STATS_MAX(maxPathsPerSolve, paths);
 }
 
-void Graph::fordFulkerson(Graph &g, const std::string &source, const std::string &sink) {
+template <typename F>
+BasicVertex<F>* BasicGraph<F>::flowPath(Vertex* from, Vertex* to, Vertex* alt, Edge* skip, bool forward) {
+    queue<Vertex *> q;
+
+    for (auto v : vertexSet){
+        v->visited = false;
+    }
+
+    from->visited = true;
+    q.push(from);
+    STATS_ADD(bfsPasses, 1);
+
+    // Flow runs along an edge from src to dest, or back from dest to src when it is negative
+    auto follow = [&](Edge* edge, Vertex* v, bool carries) {
+        if (edge != skip && carries && !v->visited){
+            v->visited = true;
+            v->prev = edge;
+            q.push(v);
+        }
+    };
+    while (!q.empty()){
+        Vertex* u = q.front();
+        q.pop();
+        STATS_ADD(verticesVisited, 1);
+        if (u == to || u == alt) {
+            return u;
+        }
+        STATS_ADD(edgesScanned, u->adj.size() + u->path.size());
+        for (auto edge: u->adj){
+            bool carries = forward ? FlowTraits<F>::positive(edge->flow)
+                                   : edge->undirected && FlowTraits<F>::positive(F() - edge->flow);
+            follow(edge, edge->dest, carries);
+        }
+        for (auto edge: u->path){
+            bool carries = forward ? edge->undirected && FlowTraits<F>::positive(F() - edge->flow)
+                                   : FlowTraits<F>::positive(edge->flow);
+            follow(edge, edge->src, carries);
+        }
+    }
+    return nullptr;
+}
+
+template <typename F>
+void BasicGraph<F>::cancelFlow(Edge* e, Vertex* src, Vertex* snk, F keep) {
+    STATS_PHASE(CANCEL_FLOW);
+    auto other = [](Edge* edge, Vertex* v) { return edge->src == v ? edge->dest : edge->src; };
+    while (FlowTraits<F>::positive(e->getCarried() - keep)) {
+        // The ends of e in the direction its flow runs
+        Vertex* head = e->flow > F() ? e->dest : e->src;
+        Vertex* tail = other(e, head);
+        // Conservation guarantees the flow entering head leaves towards the
+        // sink or comes back around to tail, and symmetrically for tail.
+        vector<Edge*> route;
+        Vertex* end = flowPath(head, snk, tail, e, true);
+        if (end == nullptr) {
+            return; // the flow was not valid to begin with
+        }
+        for (Vertex* v = end; v != head; v = other(v->prev, v)) {
+            route.push_back(v->prev);
+        }
+        if (end != tail) {
+            // Not a cycle, so the flow also has to be traced back to the source
+            Vertex* start = flowPath(tail, src, head, e, false);
+            if (start == nullptr) {
+                return;
+            }
+            if (start == head) {
+                route.clear();
+            }
+            for (Vertex* v = start; v != tail; v = other(v->prev, v)) {
+                route.push_back(v->prev);
+            }
+        }
+
+        F amount = e->getCarried() - keep;
+        for (auto edge : route) {
+            amount = std::min(amount, edge->getCarried());
+        }
+        // Every edge of the route carries flow its way, so each loses amount of it
+        for (auto edge : route) {
+            if (edge->flow > F()) edge->setFlow(edge->flow - amount);
+            else edge->setFlow(edge->flow + amount);
+        }
+        if (e->flow > F()) e->setFlow(e->flow - amount);
+        else e->setFlow(e->flow + amount);
+    }
+}
+
+template <typename F>
+void BasicGraph<F>::fordFulkerson(Graph &g, const std::string &source, const std::string &sink) {
     for (Vertex* v : g.getVertexSet()) {
         for (Edge* e : v->getAdj()) {
-            e->setFlow(0);
+            e->setFlow(F());
         }
     }
 
-    int maxFlow = 0;
+    F maxFlow = F();
 
     // Repeat until no augmenting path exists
     while (true) {
@@ -312,9 +843,13 @@ void Graph::fordFulkerson(Graph &g, const std::string &source, const std::string
         }
 
         // Determine the maximum flow that can be pushed through this path
-        int minCapacity = std::numeric_limits<int>::max();
+        F minCapacity = FlowTraits<F>::infinity();
         for (Edge* edge : path) {
             minCapacity = std::min(minCapacity, edge->getCapacity() - edge->getFlow());
+            Vertex* next = edge->getDest();
+            if (next->limited) {
+                minCapacity = std::min(minCapacity, next->limit - next->getInflow());
+            }
         }
 
         // Augment flow along the path
@@ -328,7 +863,8 @@ void Graph::fordFulkerson(Graph &g, const std::string &source, const std::string
 
 }
 
-vector<Edge *> Graph::findAugmentingPath(Graph &g, const std::string &source, const std::string &sink) {
+template <typename F>
+vector<BasicEdge<F>*> BasicGraph<F>::findAugmentingPath(Graph &g, const std::string &source, const std::string &sink) {
     vector<Edge*> path;
     map<Vertex*, Edge*> parent; // Map to store parent edges for each vertex
     queue<Vertex*> q;
@@ -356,7 +892,8 @@ vector<Edge *> Graph::findAugmentingPath(Graph &g, const std::string &source, co
         for (Edge* edge : current->getAdj()) {
             Vertex* neighbor = edge->getDest();
             // Check if the neighbor has not been visited and there is residual capacity
-            if (!parent.count(neighbor) && edge->getCapacity() > edge->getFlow()) {
+            bool spare = !neighbor->limited || FlowTraits<F>::positive(neighbor->limit - neighbor->getInflow());
+            if (!parent.count(neighbor) && spare && FlowTraits<F>::positive(edge->getCapacity() - edge->getFlow())) {
                 parent[neighbor] = edge;
                 q.push(neighbor);
             }
@@ -366,34 +903,20 @@ vector<Edge *> Graph::findAugmentingPath(Graph &g, const std::string &source, co
     return path;
 }
 
-bool Graph::addFlow(int f, Vertex *vertex) {
-    if(!vertex->isType(VertexType::CITY)){return true;}
-        vertex->setVisited(true);
-        for(auto edge: vertex->getAdj()){
-            if(!edge->getDest()->isVisited()){
-                int capacity = (int) edge->getCapacity();
-                int flow = (int) edge->getFlow();
-                int remaining = capacity - flow;
-                int adjacentFlow = 0;
-                for(auto it1: vertex->getAdj()){adjacentFlow += it1->getFlow();}
-                cout << "a";
-                if (adjacentFlow >= f && remaining >= f){
-                    cout << "b";
-                    int ff = min(f, remaining);
-                    edge->setFlow(flow + ff);
-
-                    Vertex * newVertex = edge->getDest();
-                    if(addFlow(ff, newVertex)){
-                        cout << "c";
-                        return true;
-                    }
-                    cout << "d";
-                    edge->setFlow(flow - ff);
-
-                }
-
-            }
-        }
-
-    return false;
-}
+// Every capacity type the engine is compiled for, see BasicGraph
+template class SlackTally<int>;
+template class BasicVertex<int>;
+template class BasicEdge<int>;
+template class BasicGraph<int>;
+template class SlackTally<int64_t>;
+template class BasicVertex<int64_t>;
+template class BasicEdge<int64_t>;
+template class BasicGraph<int64_t>;
+template class SlackTally<double>;
+template class BasicVertex<double>;
+template class BasicEdge<double>;
+template class BasicGraph<double>;
+template class SlackTally<Milli>;
+template class BasicVertex<Milli>;
+template class BasicEdge<Milli>;
+template class BasicGraph<Milli>;
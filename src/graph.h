@@ -1,3 +1,6 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_GRAPH_H
+#define WATER_SUPPLY_MANAGEMENT_GRAPH_H
+
 #include <cstddef>
 #include <iostream>
 #include <unordered_map>
@@ -8,18 +11,22 @@
 #include <list>
 #include <string>
 #include <limits>
+#include <climits>
 #include <queue>
 #include <map>
+#include <memory>
 #include "Reservoir.h"
 #include "City.h"
 #include "Pipe.h"
 #include "Station.h"
+#include "flowtype.h"
 
 using namespace std;
 
-class Edge;
-class Graph;
-class Vertex;
+template <typename F> class BasicEdge;
+template <typename F> class BasicGraph;
+template <typename F> class BasicVertex;
+template <typename F> class SlackTally;
 
 enum class VertexType {
     STATION,
@@ -27,7 +34,64 @@ enum class VertexType {
     CITY
 };
 
-class Vertex {
+/**
+ * @brief Running totals of the spare capacity (capacity - carried flow) of a graph's pipes
+ *
+ * Kept by the edges themselves: every change of an edge's flow or capacity
+ * updates the totals in constant time, so reading them after a solve costs
+ * nothing however large the network is. Edges to and from the super source
+ * "S" and sink "Si" are not pipes and are left out, as in measurePipes.
+ *
+ * The sums are long doubles, exact for the integer capacity types while they
+ * stay below 2^64. The maximum is known while some pipe still has
+ * it; when the last one loses it, BasicGraph::getSlackTally looks it up again.
+ */
+template <typename F>
+class SlackTally {
+    size_t pipes = 0;
+    size_t saturated = 0;   // pipes with no spare capacity, closed ones included
+    long double sum = 0;
+    long double squares = 0;
+    F max = F();            // at least the largest slack, and equal to it while atMax > 0
+    size_t atMax = 0;       // pipes whose slack is max
+
+    void add(F slack);
+    void remove(F slack);
+public:
+    size_t getPipes() const;
+    size_t getSaturated() const;
+    /**
+     * @brief Get the sum of the pipes' slack
+     *
+     * @return long double
+     */
+    long double getSum() const;
+    /**
+     * @brief Get the sum of the squares of the pipes' slack
+     *
+     * @return long double
+     */
+    long double getSumOfSquares() const;
+    double getMean() const;
+    /**
+     * @brief Get the sample variance of the pipes' slack
+     *
+     * @return double
+     */
+    double getVariance() const;
+    F getMax() const;
+    friend class BasicEdge<F>;
+    friend class BasicGraph<F>;
+};
+
+/**
+ * @brief A reservoir, station or city of a network whose capacities are of type F
+ */
+template <typename F>
+class BasicVertex {
+    using Edge = BasicEdge<F>;
+    using Vertex = BasicVertex<F>;
+
     int id;
     VertexType type;
     std::string info;
@@ -35,14 +99,21 @@ class Vertex {
     vector<Edge *> path;
     bool visited;
     Edge* prev;
+    bool limited = false;
+    F limit;            // the most a limited vertex passes on
+    F through = F();    // the water entering it through its pipes, kept up to date by BasicEdge::assign
+    int* limitedCount = nullptr;    // the limited vertices of its graph, see BasicGraph::limitedVertices
+    bool visitedOut;    // the out side of the vertex, see BasicGraph::sidedBfs
+    Edge* prevOut;
     /**
      * @brief Add an edge to the vertex
      *
      * @param src
      * @param dest
      * @param capacity
+     * @param undirected Whether flow may also go from dest to src
      */
-    void addEdge(Vertex *src, Vertex *dest, int capacity);
+    Edge* addEdge(Vertex *src, Vertex *dest, F capacity, bool undirected);
     /**
      * @brief Remove an edge from the vertex
      *
@@ -52,7 +123,7 @@ class Vertex {
      */
     bool removeEdgeTo(Vertex *d);
 public:
-    Vertex();
+    BasicVertex();
     /**
      * @brief Construct a new Vertex object
      *
@@ -60,7 +131,7 @@ public:
      * @param i
      * @param t
      */
-    Vertex(const std::string& in, int i, VertexType t);
+    BasicVertex(const std::string& in, int i, VertexType t);
     std::string getInfo() const;
     void setInfo(const std::string& in);
     /**
@@ -91,43 +162,149 @@ public:
     void setVisited(bool v);
     Edge* getPrev() const;
     void setPrev(Edge* prev);
-    vector<Edge*> getPath() const;
-    vector<Edge*> getAdj() const;
-    friend class Graph;
+    const vector<Edge*>& getPath() const;
+    const vector<Edge*>& getAdj() const;
+    /**
+     * @brief Get the water entering the vertex through its pipes
+     *
+     * The flow of its incoming edges, plus what its undirected edges carry
+     * towards it. Flow leaving the vertex is not subtracted.
+     *
+     * @return F
+     */
+    F getInflow() const;
+    /**
+     * @brief Limit the flow passing through the vertex, as a pumping station's capacity does
+     *
+     * @param l
+     */
+    void setLimit(F l);
+    void removeLimit();
+    bool isLimited() const;
+    F getLimit() const;
+    friend class BasicGraph<F>;
+    friend class BasicEdge<F>;
 };
 
-class Edge {
+/**
+ * @brief A pipe carrying flow of type F
+ *
+ * A bidirectional pipe is a single undirected edge: its capacity bounds the
+ * flow in either direction, and a negative flow runs from dest to src. The
+ * edge is in the adjacency of src and the path of dest, like a directed one.
+ */
+template <typename F>
+class BasicEdge {
+    using Vertex = BasicVertex<F>;
+
     Vertex * src;
     Vertex * dest;
-    int flow;
-    int capacity;
+    F flow;
+    F capacity;
+    F nominal; // capacity the edge was built with
+    bool undirected = false;
+    SlackTally<F>* tally = nullptr; // of the graph whose pipes the edge counts among
+    /**
+     * @brief Change the flow and capacity, keeping the tally and the through of the ends up to date
+     */
+    void assign(F f, F c);
+    /**
+     * @brief Add the flow to, or take it from, the through of the end it enters
+     */
+    void countThrough(bool add);
 public:
-    Edge(Vertex *d);
-    Edge(Vertex *s, Vertex *d, int ca);
+    BasicEdge(Vertex *d);
+    BasicEdge(Vertex *s, Vertex *d, F ca, bool undirected = false);
     Vertex *getDest() const;
     Vertex *getSource() const;
     void setDest(Vertex *dest);
-    int getFlow() const;
-    int getCapacity() const;
-    void setFlow(int f);
-    void setCapacity(int c);
-    friend class Graph;
-    friend class Vertex;
+    F getFlow() const;
+    F getCapacity() const;
+    void setFlow(F f);
+    void setCapacity(F c);
+    bool isUndirected() const;
+    /**
+     * @brief Get how much more flow can leave from, one of the edge's ends, through the edge
+     *
+     * @param from
+     * @return F
+     */
+    F getResidual(const Vertex* from) const;
+    /**
+     * @brief Get the flow the edge carries, whichever way it runs
+     *
+     * @return F
+     */
+    F getCarried() const;
+    friend class BasicGraph<F>;
+    friend class BasicVertex<F>;
 };
 
-class Graph {
+/**
+ * @brief A water supply network and the max-flow engine, with capacities and flows of type F
+ *
+ * F is int for the analyses, the fastest and most compact choice for networks
+ * the size of the dataset. The engine is also compiled for int64_t (exact
+ * totals on national-scale networks), double (fractional demands, residuals
+ * below FlowTraits<double>::EPSILON count as zero) and Milli (fixed point,
+ * fractional demands with exact sums); see FlowTraits.
+ */
+template <typename F>
+class BasicGraph {
+    using Vertex = BasicVertex<F>;
+    using Edge = BasicEdge<F>;
+    using Graph = BasicGraph<F>;
+
     vector<Vertex*> vertexSet;
     map<string, vector<Edge>> allEdges;
+    unsigned long version = 0;
+    shared_ptr<SlackTally<F>> tally = make_shared<SlackTally<F>>();  // shared by copies, like the edges
+    shared_ptr<int> limitedVertices = make_shared<int>(0);           // counted by Vertex::setLimit, shared alike
+    vector<pair<Vertex*, bool>> frontier;  // sidedBfs's queue, reused between searches
+    /**
+     * @brief Breadth-first search over edges that carry flow.
+     *
+     * Follows edges the way their flow runs when forward is true and against
+     * it otherwise, ignoring skip. Vertex::prev holds the edge each vertex was reached by.
+     *
+     * @return The first of to or alt that is reached, nullptr if neither is.
+     */
+    Vertex* flowPath(Vertex* from, Vertex* to, Vertex* alt, Edge* skip, bool forward);
+    /**
+     * @brief Breadth-first search for an augmenting path that respects vertex limits
+     *
+     * Searches as if every limited vertex were split into an in side, where
+     * flow arrives, and an out side, where it leaves, joined by an edge of the
+     * vertex's limit; without building the split graph. An unlimited vertex's
+     * sides are one. Vertex::prev and Vertex::prevOut hold the edge each side
+     * was reached by, nullptr when it was reached from the other side.
+     */
+    bool sidedBfs(Vertex* src, Vertex* snk);
+    /**
+     * @brief Push the most flow the path found by sidedBfs allows
+     *
+     * @return F The flow pushed
+     */
+    F pushSided(Vertex* src, Vertex* snk);
+    bool sided = false; // whether the last bfs searched with sidedBfs
 public:
     /**
      * @brief Construct a new Graph object
      *
      */
-    Graph() = default;
+    BasicGraph() = default;
 
     Vertex *findVertex(const std::string &in) const;
 
-    Edge* findEdge(const std::string& source, const std::string& dest);
+    /**
+     * @brief Find the edge flow can take from one vertex to another
+     *
+     * @param source
+     * @param dest
+     * @return Edge* The directed edge from source to dest or the undirected edge
+     * between them, nullptr if there is neither
+     */
+    Edge* findEdge(const std::string& source, const std::string& dest) const;
 
     /**
      * @brief Add a vertex to the graph
@@ -158,7 +335,7 @@ public:
      * @return true
      * @return false
      */
-    bool addEdge(const std::string &source, const std::string &dest, int direction, int capacity);
+    bool addEdge(const std::string &source, const std::string &dest, int direction, F capacity);
 
     bool removeEdge(const std::string &source, const std::string &dest);
     /**
@@ -168,16 +345,64 @@ public:
      */
     vector<Vertex*> getVertexSet() const;
     /**
-     * @brief Get the Adjacent Edges object
+     * @brief Get the edges flow can leave a vertex by
+     *
+     * Its outgoing edges, then the undirected edges that end at it. Closing
+     * them takes the vertex out of service.
      *
      * @param vertexInfo
      * @return vector<Edge*>
      */
     std::vector<Edge*> getAdjacentEdges(const std::string& vertexInfo) const;
+    /**
+     * @brief Get the version of the graph's structure
+     *
+     * The version changes whenever a vertex or an edge is added or removed, and
+     * no two graphs built separately share one. Copies of a graph share its
+     * vertices and edges, and so its version.
+     *
+     * @return unsigned long
+     */
+    unsigned long getVersion() const;
+    /**
+     * @brief Set the version, for changes that put the graph back as it was
+     *
+     * @param v A version the graph had before
+     */
+    void setVersion(unsigned long v);
+    /**
+     * @brief Get the running slack totals of the graph's pipes
+     *
+     * Up to date after any change of flows or capacities, without going over
+     * the edges, see SlackTally.
+     *
+     * @return const SlackTally<F>&
+     */
+    const SlackTally<F>& getSlackTally() const;
+    /**
+     * @brief Get the edges whose capacity differs from the one they were built with
+     *
+     * @return vector<pair<int, F>> Index of each edge, in getEdgeFlows order, and its current capacity
+     */
+    vector<pair<int, F>> getModifiedEdges() const;
+    /**
+     * @brief Get the flow of every edge, vertex by vertex in adjacency order
+     *
+     * @return vector<F>
+     */
+    vector<F> getEdgeFlows() const;
+    /**
+     * @brief Set the flow of every edge from a getEdgeFlows result
+     *
+     * @param flows
+     */
+    void setEdgeFlows(const vector<F>& flows);
     void dfsVisit(Vertex *v, vector<std::string>& res) const;
     /**
      * @brief Perform a breadth-first search (BFS) traversal from a source vertex to a sink vertex.
      *
+     * Over the residual network, and through sidedBfs when some vertex is limited.
+     *
      * @param src Pointer to the source vertex.
      * @param snk Pointer to the sink vertex.
      * @return true If there is a path from the source to the sink vertex.
@@ -195,7 +420,7 @@ public:
      * @param snk Pointer to the sink vertex of the augmenting path.
      * @param flow The amount of flow augmentation to be added to the edges in the path.
      */
-    void updateFlow(Vertex* src, Vertex* snk, int flow);
+    void updateFlow(Vertex* src, Vertex* snk, F flow);
     /**
      * @brief Implement the Edmonds-Karp algorithm to find the maximum flow in the graph.
      *
@@ -207,7 +432,29 @@ public:
      * @param sink The info attribute of the sink vertex.
      */
     void edmondsKarp(const std::string &source, const std::string &sink);
-    bool addFlow(int flow, Vertex * vertex);
+    /**
+     * @brief Augment the current flow until no augmenting path is left.
+     *
+     * Unlike edmondsKarp the flow is not reset first, so a solve can be
+     * warm-started from an earlier solution.
+     *
+     * @param src Pointer to the source vertex.
+     * @param snk Pointer to the sink vertex.
+     */
+    void augment(Vertex* src, Vertex* snk);
+    /**
+     * @brief Remove all the flow from an edge while keeping the flow valid.
+     *
+     * The edge's flow is taken off flow-carrying paths back to the source and
+     * on to the sink (or off a cycle through the edge), so conservation holds
+     * everywhere afterwards and augment can resume from there.
+     *
+     * @param e The edge to empty.
+     * @param src Pointer to the source vertex.
+     * @param snk Pointer to the sink vertex.
+     * @param keep Flow to leave on the edge, for a capacity that shrinks rather than closes.
+     */
+    void cancelFlow(Edge* e, Vertex* src, Vertex* snk, F keep = F());
     /**
      * @brief Implement the Ford-Fulkerson algorithm to find the maximum flow in the graph.
      *
@@ -250,4 +497,28 @@ public:
      */
     Graph buildGraph(vector<Reservoir> reservoirs, vector<Station> stations, vector<Pipe> pipes, vector<City> cities);
 
-};
\ No newline at end of file
+};
+
+// The instantiations compiled in graph.cpp
+extern template class SlackTally<int>;
+extern template class BasicVertex<int>;
+extern template class BasicEdge<int>;
+extern template class BasicGraph<int>;
+extern template class SlackTally<int64_t>;
+extern template class BasicVertex<int64_t>;
+extern template class BasicEdge<int64_t>;
+extern template class BasicGraph<int64_t>;
+extern template class SlackTally<double>;
+extern template class BasicVertex<double>;
+extern template class BasicEdge<double>;
+extern template class BasicGraph<double>;
+extern template class SlackTally<Milli>;
+extern template class BasicVertex<Milli>;
+extern template class BasicEdge<Milli>;
+extern template class BasicGraph<Milli>;
+
+using Vertex = BasicVertex<int>;
+using Edge = BasicEdge<int>;
+using Graph = BasicGraph<int>;
+
+#endif //WATER_SUPPLY_MANAGEMENT_GRAPH_H
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "jobs.h"
+#include "json.h"
+
+namespace {
+
+struct CommandInfo {
+    const char* name;
+    size_t minArgs;
+    size_t maxArgs;
+};
+
+const CommandInfo commands[] = {
+    {"max-flow", 0, 1},
+    {"cities-in-need", 0, 0},
+    {"reservoir", 1, 1},
+    {"station", 1, 1},
+    {"stations", 0, 0},
+    {"pipe", 2, 2},
+    {"city-pipes", 1, 1},
+    {"balance", 0, 0},
+    {"demand-sweep", 0, 0},
+    {"deliverable", 0, 0},
+    {"supply", 0, 0},
+};
+
+void writeStats(std::ostringstream& out, const StreamingStats& s) {
+    out << "\"count\":" << s.getCount() << ",\"average\":" << s.getMean() << ",\"variance\":" << s.getVariance()
+        << ",\"min\":" << s.getMin() << ",\"max\":" << s.getMax() << ",\"p50\":" << s.quantile(0.5)
+        << ",\"p90\":" << s.quantile(0.9) << ",\"p99\":" << s.quantile(0.99);
+}
+
+void writeMetrics(std::ostringstream& out, const PipeMetrics& metrics) {
+    out << "{";
+    writeStats(out, metrics.all);
+    out << ",\"classes\":{";
+    for (size_t c = 0; c < PIPE_CLASSES; c++) {
+        out << (c ? "," : "") << "\"" << pipeClassName((PipeClass) c) << "\":{";
+        writeStats(out, metrics.byClass[c]);
+        out << "}";
+    }
+    out << "}}";
+}
+
+void writeAffected(std::ostringstream& out, const vector<Actions::AffectedCity>& affected, const CodeDictionary& cityCodes) {
+    out << "[";
+    for (size_t i = 0; i < affected.size(); i++) {
+        if (i) out << ",";
+        out << "{\"city\":" << jsonString(cityCodes.code(affected[i].city)) << ",\"deficit\":" << affected[i].deficit << "}";
+    }
+    out << "]";
+}
+
+}
+
+bool parseJob(const std::string& text, Job& job, std::string& error) {
+    job.text = text;
+    job.command.clear();
+    job.args.clear();
+
+    std::istringstream iss(text);
+    std::string command, word;
+    if (!(iss >> command) || command[0] == '#')
+        return true;
+    while (iss >> word)
+        job.args.push_back(word);
+
+    for (const auto& info : commands) {
+        if (command != info.name)
+            continue;
+        if (job.args.size() < info.minArgs || job.args.size() > info.maxArgs) {
+            error = "wrong number of arguments for " + command;
+            return false;
+        }
+        job.command = command;
+        return true;
+    }
+    error = "unknown command " + command;
+    return false;
+}
+
+std::string runJob(const Job& job, Graph& g, Actions& a, std::string& error) {
+    std::ostringstream out;
+    const auto& args = job.args;
+    const CodeDictionary& cityCodes = a.getCityCodes();
+
+    if (job.command == "max-flow" && args.size() == 1) {
+        if (g.findVertex(args[0]) == nullptr || !g.findVertex(args[0])->isType(VertexType::CITY)) {
+            error = "city " + args[0] + " not found";
+            return "";
+        }
+        out << "{\"city\":" << jsonString(args[0]) << ",\"flow\":" << a.maxFlowSpecificCity(g, args[0]) << "}";
+    }
+    else if (job.command == "max-flow") {
+        out << "{\"flows\":{";
+        bool first = true;
+        vector<int> flows = a.maxFlowAllCities(g);
+        for (int city : cityCodes.inCodeOrder()) {
+            out << (first ? "" : ",") << jsonString(cityCodes.code(city)) << ":" << flows[city];
+            first = false;
+        }
+        out << "}}";
+    }
+    else if (job.command == "cities-in-need") {
+        out << "{\"cities\":[";
+        bool first = true;
+        vector<int> deficits = a.citiesInNeed(g);
+        for (int city : cityCodes.inCodeOrder()) {
+            if (deficits[city] <= 0) continue;
+            out << (first ? "" : ",") << "{\"city\":" << jsonString(cityCodes.code(city)) << ",\"deficit\":" << deficits[city] << "}";
+            first = false;
+        }
+        out << "]}";
+    }
+    else if (job.command == "reservoir") {
+        vector<Actions::ReservoirImpact> impacts;
+        if (!a.analyseReservoirs(g, args[0], impacts)) {
+            error = "reservoir " + args[0] + " not found";
+            return "";
+        }
+        out << "{\"reservoir\":" << jsonString(args[0]) << ",\"affected\":[";
+        for (size_t i = 0; i < impacts.size(); i++) {
+            out << (i ? "," : "") << "{\"city\":" << jsonString(cityCodes.code(impacts[i].city)) << ",\"old_flow\":" << impacts[i].oldFlow
+                << ",\"new_flow\":" << impacts[i].newFlow << ",\"deficit\":" << impacts[i].deficit << "}";
+        }
+        out << "]}";
+    }
+    else if (job.command == "station") {
+        vector<Actions::AffectedCity> affected;
+        if (!a.analyzePumpingStation(g, args[0], affected)) {
+            error = "pumping station " + args[0] + " not found";
+            return "";
+        }
+        out << "{\"station\":" << jsonString(args[0]) << ",\"affected\":";
+        writeAffected(out, affected, cityCodes);
+        out << "}";
+    }
+    else if (job.command == "stations") {
+        Actions::StationAnalysis analysis = a.analyzePumpingStations(g);
+        const CodeDictionary& stationCodes = a.getStationCodes();
+        out << "{\"removable\":[";
+        for (size_t i = 0; i < analysis.removable.size(); i++)
+            out << (i ? "," : "") << jsonString(stationCodes.code(analysis.removable[i]));
+        out << "],\"affected\":{";
+        bool first = true;
+        for (int station : stationCodes.inCodeOrder()) {
+            out << (first ? "" : ",") << jsonString(stationCodes.code(station)) << ":";
+            writeAffected(out, analysis.affectedCities[station], cityCodes);
+            first = false;
+        }
+        out << "}}";
+    }
+    else if (job.command == "pipe") {
+        vector<float> deficits;
+        if (!a.crucialPipelines(g, args[0], args[1], deficits)) {
+            error = "pipe " + args[0] + " - " + args[1] + " not found";
+            return "";
+        }
+        out << "{\"source\":" << jsonString(args[0]) << ",\"dest\":" << jsonString(args[1]) << ",\"affected\":[";
+        bool first = true;
+        for (int city : cityCodes.inCodeOrder()) {
+            if (deficits[city] <= 0) continue;
+            out << (first ? "" : ",") << "{\"city\":" << jsonString(cityCodes.code(city)) << ",\"deficit\":" << deficits[city] << "}";
+            first = false;
+        }
+        out << "]}";
+    }
+    else if (job.command == "city-pipes") {
+        vector<Pipe> crucial;
+        if (!a.crucialPipelines(g, args[0], crucial)) {
+            error = "city " + args[0] + " not found";
+            return "";
+        }
+        out << "{\"city\":" << jsonString(args[0]) << ",\"crucial\":[";
+        for (size_t i = 0; i < crucial.size(); i++)
+            out << (i ? "," : "") << "{\"source\":" << jsonString(crucial[i].getPointA())
+                << ",\"dest\":" << jsonString(crucial[i].getPointB()) << "}";
+        out << "]}";
+    }
+    else if (job.command == "balance") {
+        Actions::BalanceMetrics metrics = a.balanceAndCalculateMetrics(g);
+        out << "{\"initial\":";
+        writeMetrics(out, metrics.initial);
+        out << ",\"balanced\":";
+        writeMetrics(out, metrics.balanced);
+        out << "}";
+    }
+    else if (job.command == "demand-sweep") {
+        DemandSweep sweep = a.demandSweep(g);
+        out << "{\"total_demand\":" << sweep.totalDemand << ",\"breakpoints\":[";
+        for (size_t i = 0; i < sweep.breakpoints.size(); i++) {
+            out << (i ? "," : "") << "{\"scale\":" << sweep.breakpoints[i].scale << ",\"flow\":" << sweep.breakpoints[i].flow << "}";
+        }
+        out << "],\"cities\":[";
+        bool first = true;
+        for (int city : cityCodes.inCodeOrder()) {
+            out << (first ? "" : ",") << "{\"city\":" << jsonString(cityCodes.code(city)) << ",\"deficit_from\":";
+            if (std::isinf(sweep.deficitFrom[city])) out << "null";
+            else out << sweep.deficitFrom[city];
+            out << "}";
+            first = false;
+        }
+        out << "],\"solves\":" << sweep.solves << "}";
+    }
+    else if (job.command == "deliverable") {
+        // Jobs already run in parallel, one worker each
+        vector<int> shares = a.maxFlowAllCities(g);
+        vector<long long> alone = a.maxFlowEachCityAlone(g, 1);
+        out << "{\"cities\":[";
+        bool first = true;
+        for (int city : cityCodes.inCodeOrder()) {
+            out << (first ? "" : ",") << "{\"city\":" << jsonString(cityCodes.code(city)) << ",\"share\":" << shares[city]
+                << ",\"alone\":" << alone[city] << "}";
+            first = false;
+        }
+        out << "]}";
+    }
+    else if (job.command == "supply") {
+        SupplyMatrix supply = a.supplySources(g);
+        const CodeDictionary& reservoirCodes = a.getReservoirCodes();
+        vector<int> rank(reservoirCodes.inCodeOrder().size());
+        for (size_t i = 0; i < rank.size(); i++) rank[reservoirCodes.inCodeOrder()[i]] = (int) i;
+        out << "{\"cities\":[";
+        bool first = true;
+        for (int city : cityCodes.inCodeOrder()) {
+            vector<SupplySource> sources = supply.cities[city];
+            std::sort(sources.begin(), sources.end(), [&](const SupplySource& x, const SupplySource& y) { return rank[x.reservoir] < rank[y.reservoir]; });
+            out << (first ? "" : ",") << "{\"city\":" << jsonString(cityCodes.code(city)) << ",\"sources\":[";
+            for (size_t i = 0; i < sources.size(); i++) {
+                out << (i ? "," : "") << "{\"reservoir\":" << jsonString(reservoirCodes.code(sources[i].reservoir))
+                    << ",\"flow\":" << sources[i].flow << "}";
+            }
+            out << "]}";
+            first = false;
+        }
+        out << "],\"reservoirs\":[";
+        first = true;
+        for (int reservoir : reservoirCodes.inCodeOrder()) {
+            out << (first ? "" : ",") << "{\"reservoir\":" << jsonString(reservoirCodes.code(reservoir))
+                << ",\"delivered\":" << supply.delivered[reservoir] << "}";
+            first = false;
+        }
+        out << "],\"cycles_cancelled\":" << supply.cyclesCancelled << "}";
+    }
+    else {
+        error = "unknown command " + job.command;
+        return "";
+    }
+    return out.str();
+}
@@ -0,0 +1,60 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_JOBS_H
+#define WATER_SUPPLY_MANAGEMENT_JOBS_H
+
+#include <string>
+#include <vector>
+#include "Actions.h"
+
+/**
+ * @brief One analysis requested by a job file line
+ *
+ * Job lines are a command followed by its arguments, separated by spaces:
+ *
+ *     max-flow [city]         maximum flow reaching one city, or every city
+ *     cities-in-need          cities whose demand is not met
+ *     reservoir <code>        impact of taking a reservoir out of commission
+ *     station <code>          impact of taking a pumping station out of service
+ *     stations                every pumping station, one at a time
+ *     pipe <from> <to>        impact of a pipe rupture
+ *     city-pipes <city>       pipes whose rupture affects a city
+ *     balance                 pipe metrics before and after balancing
+ *     demand-sweep            maximum flow and deficits as every demand is scaled by the same factor
+ *     deliverable             each city's share of the maximum flow, and the most it could get alone
+ *     supply                  the reservoirs each city's water comes from in the maximum flow
+ *
+ * Empty lines and lines starting with # are ignored.
+ */
+struct Job {
+    int line = 0;
+    std::string text;
+    std::string command;
+    std::vector<std::string> args;
+};
+
+/**
+ * @brief Parse one job line
+ *
+ * Blank and comment lines parse successfully and leave the command empty.
+ *
+ * @param text
+ * @param job
+ * @param error Set when the line is not a valid job
+ * @return true
+ * @return false If the line is not a valid job
+ */
+bool parseJob(const std::string& text, Job& job, std::string& error);
+/**
+ * @brief Run a job and describe its result as a JSON object
+ *
+ * The graph is left as it was found, so jobs can run one after the other on
+ * the same graph.
+ *
+ * @param job
+ * @param g
+ * @param a
+ * @param error Set when the job refers to something that does not exist
+ * @return std::string The JSON result, empty if the job failed
+ */
+std::string runJob(const Job& job, Graph& g, Actions& a, std::string& error);
+
+#endif //WATER_SUPPLY_MANAGEMENT_JOBS_H
@@ -0,0 +1,14 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_JSON_H
+#define WATER_SUPPLY_MANAGEMENT_JSON_H
+
+#include <string>
+
+/**
+ * @brief Quote and escape a string for JSON
+ *
+ * @param s
+ * @return std::string
+ */
+std::string jsonString(const std::string& s);
+
+#endif //WATER_SUPPLY_MANAGEMENT_JSON_H
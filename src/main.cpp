@@ -3,25 +3,235 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <thread>
 #include "parse.h"
 #include "Pipe.h"
 #include "menu.h"
+#include "batch.h"
+#include "server.h"
+#include "simulation.h"
+#include "reliability.h"
 #include "Actions.h"
+#include "contingency.h"
+#include "stats.h"
+#include "perfcounters.h"
+#include "trace.h"
 
-int main() {
+namespace {
 
-    std::vector<Reservoir> reservoirs = parseReservoirs();
-    std::vector<Station> stations = parseStations();
-    std::vector<Pipe> pipes = parsePipes();
-    std::vector<City> cities = parseCities();
+void usage() {
+    std::cout << "Usage: Water_Supply_Management [options]\n"
+              << "  --data <dir>        dataset folder (default ../Dataset)\n"
+              << "  --batch <file>      run the jobs in <file> instead of the interactive menu\n"
+              << "  --output <file>     where --batch writes its JSON lines (default results.jsonl)\n"
+              << "                      or --simulate its hourly deficits (default simulation.csv)\n"
+              << "                      or --reliability its expected deficits (default reliability.csv)\n"
+              << "  --serve <socket>    answer queries on a Unix domain socket instead of the interactive menu\n"
+              << "  --simulate <files>  simulate the network hour by hour under comma-separated profile files\n"
+              << "  --hours <n>         hours for --simulate (default 8760, a year)\n"
+              << "  --reliability <p,s,r>  estimate deficits when each pipe, station and reservoir fails with\n"
+              << "                      probability p, s and r\n"
+              << "  --samples <n>       most failure scenarios for --reliability (default 100000)\n"
+              << "  --target <f>        relative 95% error at which --reliability stops (default 0.01)\n"
+              << "  --seed <n>          random seed for --reliability (default 1)\n"
+              << "  --threads <n>       worker threads for --batch and solvers for --serve (default: one per core)\n"
+              << "  --stats             report the work done by the flow engines on exit\n"
+              << "  --counters          add CPU hardware counters to --stats, where perf events are available\n"
+              << "  --trace <file>      write a timeline of the run as Chrome trace-event JSON (open in Perfetto)\n"
+              << "  --record <file>     save the answers given to the menu, with the time each step took\n"
+              << "  --replay <file>     answer the menu from a recorded session and compare each step's time\n";
+}
+
+/**
+ * @brief Map the dataset's contingency matrix, computing and saving it first if it is missing or out of date
+ */
+void prepareContingency(const std::string& dataset, Graph& graph, Actions& a, ContingencyMatrix& contingency,
+                        const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+                        const std::vector<Pipe>& pipes, const std::vector<City>& cities) {
+    uint64_t hash;
+    std::string error;
+    if (!ContingencyMatrix::hashDataset(dataset, hash, error)) {
+        std::cerr << error << "\n";
+        return;
+    }
+    std::string path = dataset + "/contingency.bin";
+    size_t components = reservoirs.size() + stations.size() + pipes.size();
+    if (!contingency.load(path, hash, cities.size(), components)) {
+        std::cerr << "Computing the impact of every outage, this is only done once per dataset...\n";
+        contingency.build(graph, a, reservoirs, stations, pipes, cities, hash);
+        if (!contingency.save(path, error)) {
+            std::cerr << error << ", it will be computed again next time\n";
+        }
+    }
+    a.useContingency(&contingency);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string dataset = "../Dataset";
+    std::string jobFile;
+    std::string socketPath;
+    std::string outputFile;
+    std::vector<std::string> profileFiles;
+    int hours = 8760;
+    bool reliability = false;
+    ReliabilityOptions reliabilityOptions;
+    std::string traceFile;
+    std::string recordFile;
+    std::string replayFile;
+    int threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    bool stats = false;
+    bool counters = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        if (arg == "--stats") {
+            stats = true;
+            continue;
+        }
+        if (arg == "--counters") {
+            stats = counters = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--data") dataset = value;
+        else if (arg == "--batch") jobFile = value;
+        else if (arg == "--output") outputFile = value;
+        else if (arg == "--serve") socketPath = value;
+        else if (arg == "--simulate") {
+            std::istringstream files(value);
+            std::string file;
+            while (getline(files, file, ',')) {
+                if (!file.empty()) profileFiles.push_back(file);
+            }
+        }
+        else if (arg == "--hours") hours = std::max(0, atoi(value.c_str()));
+        else if (arg == "--reliability") {
+            char comma1 = 0, comma2 = 0;
+            std::istringstream rates(value);
+            ReliabilityOptions& r = reliabilityOptions;
+            if (!(rates >> r.pipeFailure >> comma1 >> r.stationFailure >> comma2 >> r.reservoirFailure)
+                || comma1 != ',' || comma2 != ',') {
+                std::cerr << "--reliability needs three probabilities: pipe,station,reservoir\n";
+                return 1;
+            }
+            reliability = true;
+        }
+        else if (arg == "--samples") reliabilityOptions.maxSamples = std::max(1L, atol(value.c_str()));
+        else if (arg == "--target") reliabilityOptions.targetError = atof(value.c_str());
+        else if (arg == "--seed") reliabilityOptions.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads") threads = std::max(1, atoi(value.c_str()));
+        else if (arg == "--trace") traceFile = value;
+        else if (arg == "--record") recordFile = value;
+        else if (arg == "--replay") replayFile = value;
+        else {
+            std::cerr << "Unknown option " << arg << "\n";
+            usage();
+            return 1;
+        }
+    }
+
+    if (counters) {
+        std::string error;
+        if (!HardwareCounters::enable(error)) {
+            std::cerr << "Hardware counters unavailable, reporting without them: " << error << "\n";
+        }
+    }
+    if (!traceFile.empty()) {
+        Trace::start();
+        Trace::nameThread("main");
+    }
+    // The reports asked for on the command line, once the work is done
+    auto report = [&]() {
+        if (stats) std::cerr << Stats::report(Stats::total());
+        std::string error;
+        if (!traceFile.empty() && !Trace::write(traceFile, error)) std::cerr << error << "\n";
+    };
+
+    std::vector<Reservoir> reservoirs;
+    std::vector<Station> stations;
+    std::vector<Pipe> pipes;
+    std::vector<City> cities;
+    {
+        Trace::Scope scope("load dataset", dataset);
+        std::string error;
+        if (!parseDataset(dataset, reservoirs, stations, pipes, cities, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+    }
+
+    if (!jobFile.empty()) {
+        if (outputFile.empty()) outputFile = "results.jsonl";
+        int failed = runBatch(jobFile, outputFile, threads, reservoirs, stations, pipes, cities);
+        if (failed > 0) {
+            std::cerr << failed << " job(s) failed, see " << outputFile << "\n";
+        }
+        report();
+        return failed == 0 ? 0 : 1;
+    }
+
+    if (!profileFiles.empty()) {
+        int status = runSimulation(profileFiles, hours, outputFile.empty() ? "simulation.csv" : outputFile,
+                                   reservoirs, stations, pipes, cities);
+        report();
+        return status;
+    }
+
+    if (reliability) {
+        reliabilityOptions.threads = threads;
+        reliabilityOptions.minSamples = std::min(reliabilityOptions.minSamples, reliabilityOptions.maxSamples);
+        int status = runReliability(reliabilityOptions, outputFile.empty() ? "reliability.csv" : outputFile,
+                                    reservoirs, stations, pipes, cities);
+        report();
+        return status;
+    }
+
+    if (!socketPath.empty()) {
+        int status = runServer(socketPath, threads, reservoirs, stations, pipes, cities);
+        report();
+        return status;
+    }
 
     Actions a(reservoirs, stations, cities, pipes);
 
     Graph g, graph;
 
-    graph = g.buildGraph(reservoirs, stations, pipes, cities);
+    {
+        Trace::Scope scope("build graph");
+        graph = g.buildGraph(reservoirs, stations, pipes, cities);
+    }
+
+    ContingencyMatrix contingency;
+    {
+        Trace::Scope scope("contingency matrix");
+        prepareContingency(dataset, graph, a, contingency, reservoirs, stations, pipes, cities);
+    }
+
+    MenuInput input(std::cin);
+    std::string error;
+    if ((!recordFile.empty() && !input.record(recordFile, error))
+        || (!replayFile.empty() && !input.replay(replayFile, error))) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    menu(graph, a, cities, input);
+    input.finish();
+    if (!replayFile.empty()) {
+        std::cerr << "Replay of " << replayFile << "\n" << input.replayReport();
+    }
 
-    menu(graph,a);
+    report();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,30 @@
 #include <iostream>
 #include "Actions.h"
+#include "menuinput.h"
 
-void menu(Graph& graph, Actions& actions){
-    std::vector<City> cities = parseCities();
+namespace {
+
+/**
+ * @brief Print the quantiles of capacity - flow and the breakdown by pipe class
+ */
+void printPipeDetails(const PipeMetrics& metrics) {
+    const char* const labels[PIPE_CLASSES] = {"Reservoir outlets", "Trunk pipes", "City feeders"};
+    std::cout << "Its median, 90th and 99th percentiles: " << metrics.all.quantile(0.5) << ", "
+              << metrics.all.quantile(0.9) << ", " << metrics.all.quantile(0.99) << std::endl;
+    for (size_t c = 0; c < PIPE_CLASSES; c++) {
+        const StreamingStats& s = metrics.byClass[c];
+        std::cout << "  " << labels[c] << " (" << s.getCount() << "): average " << s.getMean() << ", variance "
+                  << s.getVariance() << ", maximum " << s.getMax() << ", median " << s.quantile(0.5) << std::endl;
+    }
+}
+
+}
+
+void menu(Graph& graph, Actions& actions, const std::vector<City>& cities, MenuInput& input){
     std::map<std::string, std::string> cityNameMap = createCityNameMap(cities);
-    map<string, int> citiesInNeed;
+    const CodeDictionary& cityCodes = actions.getCityCodes();
+    const CodeDictionary& stationCodes = actions.getStationCodes();
+    vector<int> citiesInNeed;
     int choice;
     do {
         std::cout << "-------------------------------------------------------\n";
@@ -18,44 +38,69 @@ void menu(Graph& graph, Actions& actions){
         std::cout << "6. Determine which pipelines, if ruptured, would make it impossible to deliver the desired amount of water to a given city\n";
         std::cout << "7. Exit\n";
         std::cout << "Enter your choice: ";
-        std::cin >> choice;
-
-        Graph g;
+        input >> choice;
+        if (input.isExhausted()) {
+            return;
+        }
 
         switch(choice) {
             case 1:
                 std::cout << "1. See the maximum amount of water that can reach a specific city\n";
                 std::cout << "2. See the maximum amount of water that can reach each city\n";
+                std::cout << "3. See the most water that could reach each city if no other city drew any\n";
                 int subChoice;
-                std::cin >> subChoice;
-                std::cin.ignore();  // Ignore the newline character left in the input buffer by std::cin
+                input >> subChoice;
                 if(subChoice == 1) {
                     std::string cityCode;
                     std::cout << "Enter the city code: ";
-                    std::cin >> cityCode;
+                    input >> cityCode;
 
+                    int city = cityCodes.find(cityCode);
+                    if (city < 0) {
+                        std::cout << "City not found.\n";
+                        break;
+                    }
                     std::string cityName = cityNameMap[cityCode];
 
                     int maxFlow = actions.maxFlowSpecificCity(graph, cityCode);
+                    long long alone = actions.maxFlowCityAlone(graph, cityCode);
 
-                    std::cout << "The maximum amount of water that can reach " << cityName << " is " << maxFlow << " m^3/s" << std::endl;
+                    // The city's share depends on how the other cities are served, the flow it could get alone does not
+                    std::cout << "In a maximum flow to every city, " << cityName << " receives " << maxFlow << " m^3/s" << std::endl;
+                    std::cout << "With no other city drawing water, up to " << alone << " m^3/s could reach it" << std::endl;
+                    if (maxFlow > 0) {
+                        SupplyMatrix supply = actions.supplySources(graph);
+                        std::cout << "The water it receives comes from:" << std::endl;
+                        for (const SupplySource& source : supply.cities[city]) {
+                            std::cout << "  " << actions.getReservoirCodes().code(source.reservoir) << ' ' << source.flow << " m^3/s" << std::endl;
+                        }
+                    }
                 } else if(subChoice == 2) {
-                    map<string, int> cityFlow = actions.maxFlowAllCities(graph);
+                    vector<int> cityFlow = actions.maxFlowAllCities(graph);
 
-                    for(auto it : cityFlow){
+                    for(int city : cityCodes.inCodeOrder()){
                         // Get the city name from the city code
-                        std::string cityName = cityNameMap[it.first]; // Retrieve city name from the map
+                        const std::string& cityCode = cityCodes.code(city);
+                        std::string cityName = cityNameMap[cityCode]; // Retrieve city name from the map
+
+                        std::cout << cityCode << '-' << cityName << ' ' << cityFlow[city] << " m^3/s" << std::endl;
+                    }
+                } else if(subChoice == 3) {
+                    vector<long long> alone = actions.maxFlowEachCityAlone(graph);
 
-                        std::cout << it.first << '-' << cityName << ' ' << it.second << " m^3/s" << std::endl;
+                    for(int city : cityCodes.inCodeOrder()){
+                        const std::string& cityCode = cityCodes.code(city);
+                        std::cout << cityCode << '-' << cityNameMap[cityCode] << ' ' << alone[city] << " m^3/s" << std::endl;
                     }
                 } else {
-                    std::cout << "Invalid choice. Please enter 1 or 2.\n";
+                    std::cout << "Invalid choice. Please enter 1, 2 or 3.\n";
                 }
                 break;
             case 2:
                 citiesInNeed = actions.citiesInNeed(graph);
-                for(auto it : cities){
-                    float deficit = (float) citiesInNeed[it.getCode()];
+                for(size_t i = 0; i < cities.size(); i++){
+                    const City& it = cities[i];
+                    float deficit = (float) citiesInNeed[i];
                     if(deficit > 0) {
                         cout << it.getCode() << "-" << it.getName() << endl;
                         cout << "Demand: " << it.getDemand() << endl;
@@ -66,49 +111,131 @@ void menu(Graph& graph, Actions& actions){
                 }
                 break;
             case 3:{
-                actions.balanceAndCalculateMetrics(graph);
+                Actions::BalanceMetrics metrics = actions.balanceAndCalculateMetrics(graph);
+
+                cout << "Initially the average of the difference between capacity and flow of each pipe was: " << metrics.initial.all.getMean() << endl; //orig_average
+                cout << "The variance of the difference between capacity and flow of each pipe was: " << metrics.initial.all.getVariance()  << endl; //orig_variance
+                cout << "And the maximum difference between capacity and flow of each pipe was: " << metrics.initial.all.getMax()  << endl; //orig_max_diff
+                printPipeDetails(metrics.initial);
+                cout << endl;
+
+                cout << "After using the balancing algorithm the average of the difference between capacity and flow of each pipe is: " << metrics.balanced.all.getMean() << endl;
+                cout << "The variance of the difference between capacity and flow of each pipe is: " << metrics.balanced.all.getVariance() << endl;
+                cout << "And the maximum difference between capacity and flow of each pipe is: " << metrics.balanced.all.getMax() << endl;
+                printPipeDetails(metrics.balanced);
                 break;
             }
-            case 4:
-                actions.analyseReservoirs(graph);
-                graph = g.buildGraph(parseReservoirs(),parseStations(),parsePipes(),parseCities());
+            case 4: {
+                string reservoirCode;
+                cout << "Enter the code of the reservoir you want to analyse: ";
+                input >> reservoirCode;
+
+                vector<Actions::ReservoirImpact> impacts;
+                if (!actions.analyseReservoirs(graph, reservoirCode, impacts)) {
+                    cout << "Reservoir with code " << reservoirCode << " not found." << endl;
+                    break;
+                }
+
+                // Display the impact on delivery capacity for each city
+                cout << "Impact of removing reservoir " << reservoirCode << " on delivery capacity:" << endl;
+                for (const auto& impact : impacts) {
+                    cout << "City " << cityCodes.code(impact.city) << ": " << "|OLD FLOW - " << impact.oldFlow << "| NEW FLOW - " << impact.newFlow << "| reduced by " << impact.oldFlow - impact.newFlow << " units. The deficit is " << impact.deficit << "." << endl;
+                }
+                if (impacts.empty()) {
+                    cout << endl << "There are no cities affected" << endl;
+                }
                 break;
-            case 5:
-                actions.analyzePumpingStations(graph);
-                graph = g.buildGraph(parseReservoirs(),parseStations(),parsePipes(),parseCities());
+            }
+            case 5: {
+                Actions::StationAnalysis analysis = actions.analyzePumpingStations(graph);
+                if (analysis.removable.empty()) {
+                    cout << "There are no pumping stations that can be temporarily taken out of service." << endl;
+                } else {
+                    cout << "There are " << analysis.removable.size() << " pumping stations that can be temporarily taken out of service: ";
+                    for (int s: analysis.removable) {cout<<stationCodes.code(s);}
+                    cout << endl;
+                }
+
+                int stationChoice;
+                cout << "Do you wish to see the cities affected by the removal of a certain pumping station?" << endl;
+                cout << "1. Yes" << endl;
+                cout << "2. No" << endl;
+                cout << "Enter your choice: ";
+                input >> stationChoice;
+
+                if (stationChoice == 1) {
+                    do {
+                        string stationCode;
+                        cout << "Enter the code of the pumping station: ";
+                        input >> stationCode;
+
+                        // Display affected cities for the specified pumping station
+                        int station = stationCodes.find(stationCode);
+                        if (station >= 0) {
+                            cout << "Pumping station " << stationCode << " affects the following cities:" << endl;
+                            for (const auto &city: analysis.affectedCities[station]) {
+                                cout << "City " << cityCodes.code(city.city) << " has a water supply deficit of " << city.deficit << endl;
+                            }
+                        } else {
+                            cout << "Invalid pumping station code." << endl;
+                        }
+
+                        // Ask the user if they want to check another pumping station
+                        cout << "Do you want to check another pumping station?\n";
+                        cout << "1. Yes\n";
+                        cout << "2. No\n";
+                        char answer;
+                        input >> answer;
+                        if (answer == '2' || input.isExhausted()) break;
+                    } while(true);
+                }
                 break;
+            }
             case 6:
                 int subChoice6;
                 std::cout << "1. View crucial pipelines for a specific city.\n";
                 std::cout << "2. View cities affected by pipeline malfunction.\n";
-                std::cin >> subChoice6;
+                input >> subChoice6;
                 if (subChoice6 == 1) {
                     std::string cityCode;
                     std::cout << "Enter the city code: ";
-                    std::cin >> cityCode;
-                    actions.crucialPipelines(graph, cityCode);
+                    input >> cityCode;
+                    vector<Pipe> crucial;
+                    if (!actions.crucialPipelines(graph, cityCode, crucial)) {
+                        std::cout << "City not found.\n";
+                    } else if (crucial.empty()) {
+                        std::cout << "There are no pipelines crucial to city " << cityCode << std::endl;
+                    } else {
+                        for (const auto& pipe : crucial) {
+                            std::cout << "Pipeline " << pipe.getPointA() << "-" << pipe.getPointB() << " is crucial for city " << cityCode << std::endl;
+                        }
+                    }
                 } else if (subChoice6 == 2) { // View affected cities
                     std::string sourceCode, destCode;
                     std::cout << "Enter the source vertex code: ";
-                    std::cin >> sourceCode;
+                    input >> sourceCode;
                     std::cout << "Enter the destination vertex code: ";
-                    std::cin >> destCode;
+                    input >> destCode;
 
-                    // Retrieve affected cities map using the source and dest codes
-                    auto affectedCitiesMap = actions.crucialPipelines(graph, sourceCode, destCode);
-
-                    // Check if the source code exists in the affected cities map
-                    if (affectedCitiesMap.find(sourceCode) != affectedCitiesMap.end() &&
-                        affectedCitiesMap[sourceCode].find(destCode) != affectedCitiesMap[sourceCode].end()) {
-                        auto affectedCities = affectedCitiesMap[sourceCode][destCode];
-                        if (!affectedCities.empty()) {
+                    // Retrieve the deficit of each city using the source and dest codes
+                    vector<float> deficits;
+                    if (actions.crucialPipelines(graph, sourceCode, destCode, deficits)) {
+                        bool affected = false;
+                        for (float deficit : deficits) {
+                            if (deficit > 0) affected = true;
+                        }
+                        if (affected) {
                             std::cout << "The removal of pipeline " << sourceCode << " - " << destCode << " affects the following cities:" << std::endl;
-                            for (const auto& pair : affectedCities) {
-                                std::cout << "City " << pair.first << " has a water supply deficit of " << pair.second << std::endl;
+                            for (int city : cityCodes.inCodeOrder()) {
+                                if (deficits[city] > 0) {
+                                    std::cout << "City " << cityCodes.code(city) << " has a water supply deficit of " << deficits[city] << std::endl;
+                                }
                             }
                         } else {
                             std::cout << "The removal of pipeline " << sourceCode << " - " << destCode << " doesn't affect any cities." << std::endl;
                         }
+                    } else {
+                        std::cout << "Pipeline " << sourceCode << " - " << destCode << " not found." << std::endl;
                     }
                 } else {
                     std::cout << "Invalid choice. Please enter 1 or 2.\n";
@@ -129,9 +256,9 @@ void menu(Graph& graph, Actions& actions){
             std::cout << "1. Yes\n";
             std::cout << "2. No\n";
             std::cout << "Enter your choice: ";
-            std::cin >> continueChoice;
+            input >> continueChoice;
 
-            if (continueChoice == 2) {
+            if (continueChoice == 2 || input.isExhausted()) {
                 std::cout << "Exiting the program.\n";
                 return; // Exit the menu loop and the function
             }
@@ -1,8 +1,17 @@
 #include "Actions.h"
+#include "menuinput.h"
 
 #ifndef WATER_SUPPLY_MANAGEMENT_MENU_H
 #define WATER_SUPPLY_MANAGEMENT_MENU_H
 
 #endif //WATER_SUPPLY_MANAGEMENT_MENU_H
 
-void menu(Graph& graph, Actions& actions);
\ No newline at end of file
+/**
+ * @brief Run the interactive menu until the user exits
+ *
+ * @param graph
+ * @param actions
+ * @param cities The cities of the loaded dataset, used to display their names
+ * @param input Where the answers come from: the console, or a recorded session
+ */
+void menu(Graph& graph, Actions& actions, const std::vector<City>& cities, MenuInput& input);
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <iomanip>
+#include "menuinput.h"
+
+MenuInput::MenuInput(std::istream& in_): in(in_), begin(std::chrono::steady_clock::now()) {}
+
+MenuInput::~MenuInput() {
+    finish();
+}
+
+double MenuInput::since(std::chrono::steady_clock::time_point t) const {
+    return std::chrono::duration<double, std::milli>(t - begin).count();
+}
+
+bool MenuInput::record(const std::string& path, std::string& error) {
+    recording.open(path, std::ios::trunc);
+    if (!recording.is_open()) {
+        error = "cannot write " + path;
+        return false;
+    }
+    recording << std::fixed << std::setprecision(3);
+    return true;
+}
+
+bool MenuInput::replay(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot read " + path;
+        return false;
+    }
+    std::string line;
+    int number = 0;
+    while (getline(file, line)) {
+        number++;
+        if (line.empty()) continue;
+        std::istringstream iss(line);
+        Step step;
+        if (!getline(iss, step.input, '\t') || step.input.empty() || !(iss >> step.at >> step.latency)) {
+            error = path + ":" + std::to_string(number) + ": expected <answer> <ms> <latency ms>";
+            return false;
+        }
+        recorded.push_back(step);
+    }
+    replaying = true;
+    return true;
+}
+
+void MenuInput::closeStep() {
+    if (!stepOpen) return;
+    stepOpen = false;
+    Step& step = steps.back();
+    step.latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepStart).count();
+    if (recording.is_open()) {
+        recording << step.input << '\t' << step.at << '\t' << step.latency << std::endl;
+    }
+}
+
+std::string MenuInput::token() {
+    closeStep();
+    std::string t;
+    if (replaying) {
+        if (next < recorded.size()) {
+            t = recorded[next++].input;
+        }
+        else {
+            exhausted = true;
+        }
+    }
+    else if (!(in >> t)) {
+        exhausted = true;
+    }
+    if (exhausted) {
+        return "";
+    }
+    stepStart = std::chrono::steady_clock::now();
+    steps.push_back({t, since(stepStart), 0});
+    stepOpen = true;
+    return t;
+}
+
+bool MenuInput::isExhausted() const {
+    return exhausted;
+}
+
+void MenuInput::finish() {
+    closeStep();
+}
+
+const std::vector<MenuInput::Step>& MenuInput::getSteps() const {
+    return steps;
+}
+
+std::string MenuInput::replayReport() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << std::setw(6) << "step" << "  " << std::left << std::setw(16) << "answer" << std::right
+        << std::setw(14) << "recorded ms" << std::setw(14) << "replayed ms" << std::setw(10) << "ratio" << "\n";
+    double recordedTotal = 0, replayedTotal = 0;
+    for (size_t i = 0; i < steps.size(); i++) {
+        double before = i < recorded.size() ? recorded[i].latency : 0;
+        recordedTotal += before;
+        replayedTotal += steps[i].latency;
+        out << std::setw(6) << i + 1 << "  " << std::left << std::setw(16) << steps[i].input << std::right
+            << std::setw(14) << before << std::setw(14) << steps[i].latency;
+        if (before > 0) {
+            out << std::setprecision(2) << std::setw(9) << steps[i].latency / before << "x" << std::setprecision(3);
+        }
+        out << "\n";
+    }
+    out << std::setw(6) << "total" << "  " << std::setw(16) << "" << std::setw(14) << recordedTotal
+        << std::setw(14) << replayedTotal;
+    if (recordedTotal > 0) {
+        out << std::setprecision(2) << std::setw(9) << replayedTotal / recordedTotal << "x";
+    }
+    out << "\n";
+    if (steps.size() < recorded.size()) {
+        out << "The menu exited after " << steps.size() << " of the " << recorded.size() << " recorded answers\n";
+    }
+    return out.str();
+}
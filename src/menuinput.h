@@ -0,0 +1,111 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_MENUINPUT_H
+#define WATER_SUPPLY_MANAGEMENT_MENUINPUT_H
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Where the interactive menu reads its answers from
+ *
+ * Answers are read one whitespace separated token at a time, like std::cin >>
+ * does. A step is one answer and the work the menu does in response, up to the
+ * moment it asks for the next answer; that time is the step's latency.
+ *
+ * A session can be recorded to a file, one step per line:
+ * "<answer>\t<ms since the session started>\t<latency ms>". Replaying such a
+ * file feeds its answers back as fast as the menu asks for them, so a replay
+ * repeats exactly the same work and only the latencies can differ.
+ */
+class MenuInput {
+public:
+    struct Step {
+        std::string input;
+        double at = 0;          // ms since the session started when the answer was given
+        double latency = 0;     // ms the menu took to respond to it
+    };
+
+private:
+    std::istream& in;
+    std::ofstream recording;
+    bool replaying = false;
+    std::vector<Step> recorded;
+    size_t next = 0;
+    bool exhausted = false;
+    std::vector<Step> steps;
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point stepStart;
+    bool stepOpen = false;
+
+    double since(std::chrono::steady_clock::time_point t) const;
+    void closeStep();
+    std::string token();
+
+public:
+    /**
+     * @brief Read the answers from a stream, usually std::cin
+     *
+     * @param in
+     */
+    explicit MenuInput(std::istream& in);
+    ~MenuInput();
+    MenuInput(const MenuInput&) = delete;
+    MenuInput& operator=(const MenuInput&) = delete;
+
+    /**
+     * @brief Also write every step to a session file
+     *
+     * @param path
+     * @param error Set when the file cannot be created
+     * @return false if the file cannot be created
+     */
+    bool record(const std::string& path, std::string& error);
+    /**
+     * @brief Read the answers from a recorded session file instead of the stream
+     *
+     * @param path
+     * @param error Set when the file cannot be read or a line is malformed
+     * @return false if the file cannot be read or a line is malformed
+     */
+    bool replay(const std::string& path, std::string& error);
+
+    /**
+     * @brief Read the next answer
+     *
+     * A value that does not parse is left as the type's value-initialised
+     * default (0 for numbers), so the menu treats it as an invalid choice.
+     */
+    template <typename T>
+    MenuInput& operator>>(T& value) {
+        std::istringstream iss(token());
+        value = T();
+        iss >> value;
+        return *this;
+    }
+
+    /**
+     * @brief Whether the input ran out, so the menu should stop asking
+     */
+    bool isExhausted() const;
+    /**
+     * @brief End the last step, once the menu has returned
+     */
+    void finish();
+    /**
+     * @brief Get the steps taken so far
+     *
+     * @return const std::vector<Step>&
+     */
+    const std::vector<Step>& getSteps() const;
+    /**
+     * @brief Compare the latency of every replayed step with the recording
+     *
+     * @return std::string A table with one row per step and the totals
+     */
+    std::string replayReport() const;
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_MENUINPUT_H
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include "parametric.h"
+#include "residual.h"
+
+namespace {
+
+/**
+ * @brief An arc of the network split at its limited stations, with capacity capacity + scale * demand
+ */
+struct Arc {
+    int from, to;
+    long long capacity;
+    long long demand;   // of the city, on its arc to the sink
+};
+
+/**
+ * @brief A cut's capacity as a function of the scale, a + scale * b
+ */
+struct Line {
+    long long a, b;
+};
+
+enum Side : char { SOURCE, SINK, UNDECIDED };
+
+class Sweep {
+    vector<Arc> arcs;
+    vector<vector<int>> incident;   // the arcs leaving or entering each node
+    vector<int> cityOf;             // the city id - 1 of each node, -1 for others
+    vector<long long> demandOf;
+    vector<Side> side;              // relative to the scales being searched
+    vector<int> local;              // number of an undecided node in the network being solved
+    DemandSweep& result;
+
+public:
+    Sweep(int nodes, DemandSweep& r): incident(nodes), cityOf(nodes, -1), demandOf(nodes, 0), side(nodes, UNDECIDED),
+                                      local(nodes, -1), result(r) {}
+
+    void addArc(int u, int v, long long capacity, long long demand) {
+        incident[u].push_back((int) arcs.size());
+        incident[v].push_back((int) arcs.size());
+        arcs.push_back({u, v, capacity, demand});
+    }
+
+    void setCity(int v, int city, long long demand) {
+        cityOf[v] = city;
+        demandOf[v] = demand;
+    }
+
+    void decide(int v, Side s) {
+        side[v] = s;
+    }
+
+    /**
+     * @brief Find the breakpoints between the scales where low and high are the minimum cuts
+     *
+     * The source side at the lower scale is that at the higher one plus the
+     * undecided nodes; the others are on the side they have at both.
+     *
+     * @param undecided
+     * @param low The cut at the lower scale
+     * @param high The cut at the higher scale
+     */
+    void search(const vector<int>& undecided, Line low, Line high) {
+        // The undecided nodes between a source and a sink that stand for the decided ones
+        const int s = 0, t = 1;
+        for (size_t i = 0; i < undecided.size(); i++) {
+            side[undecided[i]] = UNDECIDED;
+            local[undecided[i]] = (int) i + 2;
+        }
+        auto node = [&](int v) { return side[v] == SOURCE ? s : side[v] == SINK ? t : local[v]; };
+        vector<Arc> sub;
+        for (int v : undecided) {
+            for (int id : incident[v]) {
+                const Arc& arc = arcs[id];
+                // An arc between two undecided nodes is taken from the one it leaves
+                if (arc.from != v && side[arc.from] == UNDECIDED) continue;
+                int u = node(arc.from), w = node(arc.to);
+                if (u == w || u == t || w == s) continue;
+                sub.push_back({u, w, arc.capacity, arc.demand});
+            }
+        }
+
+        // The two cuts, relative to the arcs every cut between them shares
+        Line all{0, 0}, none{0, 0};
+        for (const Arc& arc : sub) {
+            if (arc.to == t) {
+                all.a += arc.capacity;
+                all.b += arc.demand;
+            }
+            if (arc.from == s) {
+                none.a += arc.capacity;
+                none.b += arc.demand;
+            }
+        }
+        if (all.b <= none.b) {
+            return;     // the same line: no city here has demand left to lose
+        }
+        // Where the lines cross, scale = p / q
+        long long p = std::max(0LL, none.a - all.a), q = all.b - none.b;
+        long long divisor = std::gcd(p, q);
+        if (divisor > 1) {
+            p /= divisor;
+            q /= divisor;
+        }
+        ArcTopology topology((int) undecided.size() + 2);
+        for (const Arc& arc : sub) topology.addArc(arc.from, arc.to, arc.capacity * q + arc.demand * p);
+        topology.index();
+        ResidualNetwork network(topology);
+        long long flow = network.maxFlow(s, t);
+        result.solves++;
+
+        double scale = (double) p / (double) q;
+        if (flow == all.a * q + all.b * p) {
+            // Both cuts are minimum here, so this is the one breakpoint between them
+            result.breakpoints.push_back({scale, (double) low.a + scale * (double) low.b});
+            for (int v : undecided) {
+                if (cityOf[v] >= 0 && demandOf[v] > 0) result.deficitFrom[cityOf[v]] = scale;
+            }
+            return;
+        }
+
+        vector<bool> inside = network.sourceSide(t);
+        Line cut{0, 0};
+        for (const Arc& arc : sub) {
+            if (inside[arc.from] && !inside[arc.to]) {
+                cut.a += arc.capacity;
+                cut.b += arc.demand;
+            }
+        }
+        Line middle{low.a + cut.a - all.a, low.b + cut.b - all.b};
+        vector<int> below, above;   // decided by the cut: on its sink side, and on its source side
+        for (int v : undecided) {
+            (inside[local[v]] ? above : below).push_back(v);
+        }
+        for (int v : above) side[v] = SOURCE;
+        search(below, low, middle);
+        for (int v : below) side[v] = SINK;
+        search(above, middle, high);
+    }
+};
+
+}
+
+double DemandSweep::flowAt(double scale) const {
+    double lastScale = 0, lastFlow = 0;
+    for (const auto& b : breakpoints) {
+        if (scale <= b.scale) {
+            if (b.scale <= lastScale) return b.flow;
+            return lastFlow + (b.flow - lastFlow) * (scale - lastScale) / (b.scale - lastScale);
+        }
+        lastScale = b.scale;
+        lastFlow = b.flow;
+    }
+    return lastFlow;    // every city falls short past the last breakpoint, the flow stays the same
+}
+
+DemandSweep sweepDemands(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities) {
+    SplitNetwork split(g, reservoirs, cities);
+    int nodes = split.getNodes(), source = split.getSource(), sink = split.getSink();
+
+    DemandSweep result;
+    result.deficitFrom.assign(cities.size(), std::numeric_limits<double>::infinity());
+    Sweep sweep(nodes, result);
+    Line low{0, 0}, high{0, 0};     // the cuts around the sink alone and the source alone
+    for (const SplitArc& arc : split.getArcs()) {
+        if (arc.kind == SplitArc::DEMAND) {
+            sweep.addArc(arc.from, arc.to, 0, arc.capacity);
+            sweep.setCity(arc.from, arc.vertex->getId() - 1, arc.capacity);
+            low.b += arc.capacity;
+            continue;
+        }
+        if (arc.kind == SplitArc::DELIVERY) high.a += arc.capacity;
+        sweep.addArc(arc.from, arc.to, arc.capacity, 0);
+    }
+    result.totalDemand = low.b;
+
+    // At scale 0 every node can be on the source side, and past the last breakpoint only the source is
+    vector<int> undecided;
+    for (int v = 0; v < nodes; v++) {
+        if (v != source && v != sink) undecided.push_back(v);
+    }
+    sweep.decide(source, SOURCE);
+    sweep.decide(sink, SINK);
+    sweep.search(undecided, low, high);
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_PARAMETRIC_H
+#define WATER_SUPPLY_MANAGEMENT_PARAMETRIC_H
+
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief A scale of the demands at which the maximum flow starts growing more slowly
+ */
+struct DemandBreakpoint {
+    double scale;   // the factor every city's demand is multiplied by
+    double flow;    // the maximum flow at that scale
+};
+
+/**
+ * @brief The maximum flow as a function of a factor applied to every city's demand
+ *
+ * The function is piecewise linear, increasing and concave: 0 at scale 0,
+ * then growing with the total demand of the cities still fully served, and
+ * flat once every city falls short.
+ */
+struct DemandSweep {
+    long long totalDemand = 0;              // (truncated) demands of all the cities, at scale 1
+    vector<DemandBreakpoint> breakpoints;   // by increasing scale
+    vector<double> deficitFrom;             // by city id, see sweepDemands; infinity for a city without demand
+    int solves = 0;                         // maximum flows computed
+
+    /**
+     * @brief The maximum flow with every demand multiplied by scale, read off the breakpoints
+     *
+     * @param scale
+     * @return double
+     */
+    double flowAt(double scale) const;
+};
+
+/**
+ * @brief Find how the maximum flow and the cities' deficits evolve as every demand is scaled by the same factor
+ *
+ * The capacity of each city's arc to the super sink is scale * demand, so the
+ * minimum cut is a concave function of the scale with at most one breakpoint
+ * per city. All of them are found in one run, the way Gallo, Grigoriadis and
+ * Tarjan compute them: solve where the lines of two known cuts cross; either
+ * the minimum there is on both lines, a breakpoint, or a cut between the two
+ * is found and each side is searched in turn. The minimum cuts are nested
+ * (the source side shrinks as the scale grows), so vertices on the source
+ * side at the larger scale are merged into the source and those on the sink
+ * side at the smaller into the sink, and every search only solves the part
+ * of the network still undecided. Scales are exact fractions and the flows
+ * 64-bit integers, so breakpoints are not missed or invented by rounding.
+ *
+ * deficitFrom is, for each city, the largest scale at which every maximum
+ * flow meets its demand in full: the breakpoint at which it leaves the source
+ * side of the minimum cut. Beyond it the reservoirs, stations or pipes that
+ * feed the city are saturated, and the network only delivers its maximum by
+ * leaving the city, or one it shares those with, short.
+ *
+ * Pipe capacities (as they are, with closed pipes at 0), station limits,
+ * reservoir deliveries and (truncated) city demands are as in Actions. The
+ * super source and sink are ignored if attached; the graph is not changed.
+ *
+ * @param g
+ * @param reservoirs Their maximum deliveries, by id
+ * @param cities Their demands, by id
+ * @return DemandSweep
+ */
+DemandSweep sweepDemands(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_PARAMETRIC_H
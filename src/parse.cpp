@@ -1,4 +1,3 @@
-#include <iostream>
 #include <vector>
 #include <fstream>
 #include <sstream>
@@ -10,12 +9,12 @@
 #include "City.h"
 #include "parse.h"
 
-std::vector<Reservoir> parseReservoirs() {
-    std::vector<Reservoir> reservoirs;
-    std::ifstream file("../Dataset/Reservoir.csv");
+bool parseReservoirs(const std::string& directory, std::vector<Reservoir>& reservoirs, std::string& error) {
+    reservoirs.clear();
+    std::ifstream file(directory + "/Reservoir.csv");
     if (!file.is_open()) {
-        std::cout << "Error: Unable to open Reservoir.csv\n";
-        return reservoirs;
+        error = "Unable to open " + directory + "/Reservoir.csv";
+        return false;
     }
     std::string line;
     std::string name,municipality,code;
@@ -34,16 +33,16 @@ std::vector<Reservoir> parseReservoirs() {
         reservoirs.emplace_back(reservoir);
 
     }
-    return reservoirs;
+    return true;
 }
 
-std::vector<Station> parseStations() {
-    std::vector<Station> stations;
-    std::ifstream file("../Dataset/Stations.csv");
+bool parseStations(const std::string& directory, std::vector<Station>& stations, std::string& error) {
+    stations.clear();
+    std::ifstream file(directory + "/Stations.csv");
 
     if (!file.is_open()) {
-        std::cout << "Error: Unable to open Station.csv\n";
-        return stations;
+        error = "Unable to open " + directory + "/Stations.csv";
+        return false;
     }
 
     std::string line;
@@ -55,21 +54,24 @@ std::vector<Station> parseStations() {
         iss >> id;
         iss.ignore();
         getline(iss,code,',');
+        // The pumping limit is an optional third column, empty for a station without one
+        int capacity;
+        if (!(iss >> capacity)) capacity = Station::UNLIMITED;
 
-        Station station(id, code);
+        Station station(id, code, capacity);
         stations.emplace_back(station);
 
     }
-    return stations;
+    return true;
 }
 
-std::vector<Pipe> parsePipes() {
-    std::vector<Pipe> pipes;
-    std::ifstream file("../Dataset/Pipes.csv");
+bool parsePipes(const std::string& directory, std::vector<Pipe>& pipes, std::string& error) {
+    pipes.clear();
+    std::ifstream file(directory + "/Pipes.csv");
 
     if (!file.is_open()) {
-        std::cout << "Error: Unable to open Pipes.csv\n";
-        return pipes;
+        error = "Unable to open " + directory + "/Pipes.csv";
+        return false;
     }
 
     std::string line;
@@ -88,16 +90,16 @@ std::vector<Pipe> parsePipes() {
         pipes.emplace_back(pipe);
 
     }
-    return pipes;
+    return true;
 }
 
-std::vector<City> parseCities() {
-    std::vector<City> cities;
-    std::ifstream file("../Dataset/Cities.csv");
+bool parseCities(const std::string& directory, std::vector<City>& cities, std::string& error) {
+    cities.clear();
+    std::ifstream file(directory + "/Cities.csv");
 
     if (!file.is_open()) {
-        std::cout << "Error: Unable to open Cities.csv\n";
-        return cities;
+        error = "Unable to open " + directory + "/Cities.csv";
+        return false;
     }
 
     std::string line;
@@ -119,7 +121,13 @@ std::vector<City> parseCities() {
         cities.emplace_back(city);
 
     }
-    return cities;
+    return true;
+}
+
+bool parseDataset(const std::string& directory, std::vector<Reservoir>& reservoirs, std::vector<Station>& stations,
+                  std::vector<Pipe>& pipes, std::vector<City>& cities, std::string& error) {
+    return parseReservoirs(directory, reservoirs, error) && parseStations(directory, stations, error) &&
+           parsePipes(directory, pipes, error) && parseCities(directory, cities, error);
 }
 
 std::map<std::string, std::string> createCityNameMap(const std::vector<City>& cities) {
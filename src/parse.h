@@ -7,30 +7,52 @@
 #include "City.h"
 #include <vector>
 #include <map>
+#include <string>
 /**
  * @brief Parse the Reservoirs from the Reservoir.csv file
  *
- * @return std::vector<Reservoir>
+ * @param directory Folder holding the dataset
+ * @param reservoirs Filled with the parsed reservoirs
+ * @param error Set to the reason when the file cannot be opened
+ * @return Whether the file was read
  */
-std::vector<Reservoir> parseReservoirs();
+bool parseReservoirs(const std::string& directory, std::vector<Reservoir>& reservoirs, std::string& error);
 /**
  * @brief Parse the Stations from the Stations.csv file
  *
- * @return std::vector<Station>
+ * @param directory Folder holding the dataset
+ * @param stations Filled with the parsed stations
+ * @param error Set to the reason when the file cannot be opened
+ * @return Whether the file was read
  */
-std::vector<Station> parseStations();
+bool parseStations(const std::string& directory, std::vector<Station>& stations, std::string& error);
 /**
  * @brief Parse the Pipes from the Pipes.csv file
  *
- * @return std::vector<Pipe>
+ * @param directory Folder holding the dataset
+ * @param pipes Filled with the parsed pipes
+ * @param error Set to the reason when the file cannot be opened
+ * @return Whether the file was read
  */
-std::vector<Pipe> parsePipes();
+bool parsePipes(const std::string& directory, std::vector<Pipe>& pipes, std::string& error);
 /**
  * @brief Parse the Cities from the Cities.csv file
  *
- * @return std::vector<City>
+ * @param directory Folder holding the dataset
+ * @param cities Filled with the parsed cities
+ * @param error Set to the reason when the file cannot be opened
+ * @return Whether the file was read
  */
-std::vector<City> parseCities();
+bool parseCities(const std::string& directory, std::vector<City>& cities, std::string& error);
+/**
+ * @brief Parse every file of a dataset, stopping at the first one that cannot be opened
+ *
+ * @param directory Folder holding the dataset
+ * @param error Set to the reason when a file cannot be opened
+ * @return Whether the whole dataset was read
+ */
+bool parseDataset(const std::string& directory, std::vector<Reservoir>& reservoirs, std::vector<Station>& stations,
+                  std::vector<Pipe>& pipes, std::vector<City>& cities, std::string& error);
 /**
  * @brief Create a map with the city name as the key and the city code as the value
  *
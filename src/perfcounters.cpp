@@ -0,0 +1,191 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const eventNames[HardwareCounters::EVENT_COUNT] = {
+    "cycles", "instructions", "cache references", "cache misses", "branches", "branch misses",
+};
+
+std::atomic<bool> enabled(false);
+std::atomic<unsigned> supported(0);
+
+#ifdef __linux__
+
+const uint64_t eventConfigs[HardwareCounters::EVENT_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int openEvent(uint64_t config, int group) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/**
+ * @brief The counter group of one thread, closed when the thread ends
+ */
+struct ThreadGroup {
+    bool opened = false;
+    int leader = -1;
+    int fds[HardwareCounters::EVENT_COUNT];
+    int slot[HardwareCounters::EVENT_COUNT];   // position of each event in a group read, -1 if not open
+    int count = 0;
+
+    /**
+     * @brief Open the events in mask, the cycle counter leading the group
+     *
+     * @return The events that could be opened
+     */
+    unsigned open(unsigned mask) {
+        opened = true;
+        unsigned result = 0;
+        for (int e = 0; e < HardwareCounters::EVENT_COUNT; e++) {
+            fds[e] = -1;
+            slot[e] = -1;
+            if ((mask & (1u << e)) == 0 || (leader < 0 && e != HardwareCounters::CYCLES)) {
+                continue;
+            }
+            int fd = openEvent(eventConfigs[e], leader);
+            if (fd < 0) {
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds[e] = fd;
+            slot[e] = count++;
+            result |= 1u << e;
+        }
+        return result;
+    }
+
+    ~ThreadGroup() {
+        for (int e = 0; e < HardwareCounters::EVENT_COUNT; e++) {
+            if (opened && fds[e] >= 0) {
+                close(fds[e]);
+            }
+        }
+    }
+};
+
+thread_local ThreadGroup threadGroup;
+
+#endif
+
+}
+
+HardwareCounters::Reading& HardwareCounters::Reading::operator+=(const Reading& other) {
+    for (int e = 0; e < EVENT_COUNT; e++) {
+        values[e] += other.values[e];
+    }
+    return *this;
+}
+
+HardwareCounters::Reading HardwareCounters::Reading::operator-(const Reading& other) const {
+    Reading r;
+    for (int e = 0; e < EVENT_COUNT; e++) {
+        r.values[e] = values[e] > other.values[e] ? values[e] - other.values[e] : 0;
+    }
+    return r;
+}
+
+HardwareCounters::Scope::Scope(Reading& total_): total(total_), counting(HardwareCounters::read(start)) {}
+
+HardwareCounters::Scope::~Scope() {
+    Reading end;
+    if (counting && HardwareCounters::read(end)) {
+        total += end - start;
+    }
+}
+
+bool HardwareCounters::enable(std::string& error) {
+#ifdef __linux__
+    if (enabled) {
+        return true;
+    }
+    if (!threadGroup.opened) {
+        unsigned mask = threadGroup.open((1u << EVENT_COUNT) - 1);
+        if (mask == 0) {
+            int code = errno;
+            error = std::string("perf_event_open failed: ") + strerror(code);
+            std::ifstream paranoid("/proc/sys/kernel/perf_event_paranoid");
+            int level;
+            if (code == ENOENT || code == EOPNOTSUPP) {
+                error += " (the CPU or hypervisor exposes no hardware counters)";
+            }
+            else if ((code == EACCES || code == EPERM) && paranoid >> level && level > 2) {
+                error += " (kernel.perf_event_paranoid is " + std::to_string(level) + ", 2 or less is needed)";
+            }
+            return false;
+        }
+        supported = mask;
+    }
+    if (threadGroup.leader < 0) {
+        error = "hardware counters are not available";
+        return false;
+    }
+    enabled = true;
+    return true;
+#else
+    error = "hardware counters need Linux perf events";
+    return false;
+#endif
+}
+
+bool HardwareCounters::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+bool HardwareCounters::isSupported(Event e) {
+    return (supported.load(std::memory_order_relaxed) & (1u << e)) != 0;
+}
+
+const char* HardwareCounters::eventName(Event e) {
+    return eventNames[e];
+}
+
+bool HardwareCounters::read(Reading& reading) {
+#ifdef __linux__
+    if (!isEnabled()) {
+        return false;
+    }
+    ThreadGroup& group = threadGroup;
+    if (!group.opened) {
+        group.open(supported);
+    }
+    if (group.leader < 0) {
+        return false;
+    }
+    uint64_t buffer[3 + EVENT_COUNT];
+    ssize_t n = ::read(group.leader, buffer, sizeof(buffer));
+    if (n < (ssize_t) (3 * sizeof(uint64_t)) || buffer[0] != (uint64_t) group.count) {
+        return false;
+    }
+    // buffer holds the number of events, the time enabled and the time running, then the values
+    double scale = buffer[2] > 0 && buffer[2] < buffer[1] ? (double) buffer[1] / (double) buffer[2] : 1;
+    for (int e = 0; e < EVENT_COUNT; e++) {
+        reading.values[e] = group.slot[e] < 0 ? 0 : (uint64_t) ((double) buffer[3 + group.slot[e]] * scale);
+    }
+    return true;
+#else
+    (void) reading;
+    return false;
+#endif
+}
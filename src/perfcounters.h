@@ -0,0 +1,75 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_PERFCOUNTERS_H
+#define WATER_SUPPLY_MANAGEMENT_PERFCOUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief CPU hardware counters (cycles, instructions, cache and branch misses) of the calling thread
+ *
+ * Uses perf_event_open on Linux, counting user space only so that the default
+ * kernel.perf_event_paranoid setting allows it. Each thread opens its own
+ * counter group the first time it reads. Where the counters are not available
+ * (other systems, containers without perf access, virtual machines without a
+ * PMU) enable fails with the reason and every read reports nothing, so callers
+ * carry on without them.
+ */
+class HardwareCounters {
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_REFERENCES,   // last level cache
+        CACHE_MISSES,
+        BRANCHES,
+        BRANCH_MISSES,
+        EVENT_COUNT
+    };
+
+    struct Reading {
+        uint64_t values[EVENT_COUNT] = {};
+
+        uint64_t operator[](Event e) const { return values[e]; }
+        Reading& operator+=(const Reading& other);
+        Reading operator-(const Reading& other) const;
+    };
+
+    /**
+     * @brief Adds the counts between its construction and destruction to a reading
+     */
+    class Scope {
+        Reading& total;
+        Reading start;
+        bool counting;
+    public:
+        explicit Scope(Reading& total);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /**
+     * @brief Open the counters on the calling thread and let every thread read them
+     *
+     * @param error Why the counters are unavailable
+     * @return false if not even the cycle counter could be opened
+     */
+    static bool enable(std::string& error);
+    static bool isEnabled();
+    /**
+     * @brief Whether an event could be opened, the others always read as 0
+     *
+     * @param e
+     */
+    static bool isSupported(Event e);
+    static const char* eventName(Event e);
+    /**
+     * @brief Read the calling thread's counters, scaled up if the kernel multiplexed them
+     *
+     * @param reading
+     * @return false if the counters are not enabled or cannot be opened on this thread
+     */
+    static bool read(Reading& reading);
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_PERFCOUNTERS_H
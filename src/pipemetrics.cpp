@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cmath>
+#include "pipemetrics.h"
+
+namespace {
+
+const int EXACT_BITS = 7;       // values below 2^EXACT_BITS have a bucket each
+const int SUB_BITS = 6;         // larger values keep their top SUB_BITS + 1 bits
+const int SUB_BUCKETS = 1 << SUB_BITS;
+const size_t BUCKETS = (1 << EXACT_BITS) + (31 - EXACT_BITS) * SUB_BUCKETS;  // enough for any int
+const int64_t SQUARES_SAFE = 1 << 27;   // a block's spread below which its sum of squares fits in 64 bits
+
+int bucketOf(int value) {
+    uint32_t v = value < 0 ? 0 : (uint32_t) value;
+    if (v < (1u << EXACT_BITS)) return (int) v;
+    int msb = 31 - __builtin_clz(v);
+    int shift = msb - SUB_BITS;
+    int top = (int) (v >> shift);
+    return (1 << EXACT_BITS) + (shift - 1) * SUB_BUCKETS + (top - SUB_BUCKETS);
+}
+
+/**
+ * @brief The middle of the values a bucket holds
+ */
+double bucketMiddle(int bucket) {
+    if (bucket < (1 << EXACT_BITS)) return bucket;
+    int shift = (bucket - (1 << EXACT_BITS)) / SUB_BUCKETS + 1;
+    int top = (bucket - (1 << EXACT_BITS)) % SUB_BUCKETS + SUB_BUCKETS;
+    double low = (double) ((int64_t) top << shift);
+    return low + (double) (((int64_t) 1 << shift) - 1) / 2;
+}
+
+PipeClass classify(const Edge* e) {
+    const Vertex* a = e->getSource();
+    const Vertex* b = e->getDest();
+    if (a->isType(VertexType::RESERVOIR) || b->isType(VertexType::RESERVOIR)) return PipeClass::OUTLET;
+    if (a->isType(VertexType::CITY) || b->isType(VertexType::CITY)) return PipeClass::FEEDER;
+    return PipeClass::TRUNK;
+}
+
+}
+
+void StreamingStats::addToMoments(uint64_t n, double blockMean, double blockM2) {
+    uint64_t total = count + n;
+    double delta = blockMean - mean;
+    mean += delta * (double) n / (double) total;
+    m2 += blockM2 + delta * delta * (double) count * (double) n / (double) total;
+    count = total;
+}
+
+void StreamingStats::add(const int* values, size_t n) {
+    for (size_t start = 0; start < n; start += BLOCK) {
+        const int* v = values + start;
+        size_t m = std::min(BLOCK, n - start);
+
+        int low = INT_MAX, high = INT_MIN;
+        for (size_t i = 0; i < m; i++) {
+            low = std::min(low, v[i]);
+            high = std::max(high, v[i]);
+        }
+        min = std::min(min, low);
+        max = std::max(max, high);
+
+        // Deviations from the block's minimum, exactly in integers when they are small enough
+        double blockMean, blockM2;
+        if ((int64_t) high - low < SQUARES_SAFE) {
+            int64_t sum = 0, squares = 0;
+            for (size_t i = 0; i < m; i++) {
+                int64_t d = (int64_t) v[i] - low;
+                sum += d;
+                squares += d * d;
+            }
+            blockMean = (double) low + (double) sum / (double) m;
+            blockM2 = (double) squares - (double) sum * (double) sum / (double) m;
+        }
+        else {
+            double sum = 0;
+            for (size_t i = 0; i < m; i++) sum += v[i];
+            blockMean = sum / (double) m;
+            blockM2 = 0;
+            for (size_t i = 0; i < m; i++) blockM2 += (v[i] - blockMean) * (v[i] - blockMean);
+        }
+        addToMoments(m, blockMean, blockM2);
+
+        if (buckets.empty()) buckets.assign(BUCKETS, 0);
+        for (size_t i = 0; i < m; i++) buckets[(size_t) bucketOf(v[i])]++;
+    }
+}
+
+void StreamingStats::add(int value) {
+    add(&value, 1);
+}
+
+void StreamingStats::merge(const StreamingStats& other) {
+    if (other.count == 0) return;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    addToMoments(other.count, other.mean, other.m2);
+    if (buckets.empty()) buckets.assign(BUCKETS, 0);
+    for (size_t b = 0; b < other.buckets.size(); b++) buckets[b] += other.buckets[b];
+}
+
+uint64_t StreamingStats::getCount() const {
+    return count;
+}
+
+double StreamingStats::getMean() const {
+    return mean;
+}
+
+double StreamingStats::getVariance() const {
+    return count < 2 ? 0 : m2 / (double) (count - 1);
+}
+
+int StreamingStats::getMin() const {
+    return count ? min : 0;
+}
+
+int StreamingStats::getMax() const {
+    return count ? max : 0;
+}
+
+double StreamingStats::quantile(double q) const {
+    if (count == 0) return 0;
+    q = std::min(1.0, std::max(0.0, q));
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(q * (double) count));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return std::min((double) max, std::max((double) min, bucketMiddle((int) b)));
+        }
+    }
+    return max;
+}
+
+const char* pipeClassName(PipeClass c) {
+    switch (c) {
+        case PipeClass::OUTLET: return "outlet";
+        case PipeClass::TRUNK: return "trunk";
+        case PipeClass::FEEDER: return "feeder";
+    }
+    return "";
+}
+
+PipeMetrics measurePipes(const Graph& g) {
+    PipeMetrics metrics;
+    const Vertex* source = g.findVertex("S");
+    const Vertex* sink = g.findVertex("Si");
+    int pending[PIPE_CLASSES][StreamingStats::BLOCK];
+    size_t filled[PIPE_CLASSES] = {};
+    for (Vertex* v : g.getVertexSet()) {
+        if (v == source || v == sink) continue;
+        for (Edge* e : v->getAdj()) {
+            if (e->getDest() == source || e->getDest() == sink) continue;
+            size_t c = (size_t) classify(e);
+            pending[c][filled[c]++] = e->getCapacity() - e->getCarried();
+            if (filled[c] == StreamingStats::BLOCK) {
+                metrics.byClass[c].add(pending[c], filled[c]);
+                filled[c] = 0;
+            }
+        }
+    }
+    for (size_t c = 0; c < PIPE_CLASSES; c++) {
+        metrics.byClass[c].add(pending[c], filled[c]);
+        metrics.all.merge(metrics.byClass[c]);
+    }
+    return metrics;
+}
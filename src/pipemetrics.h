@@ -0,0 +1,96 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_PIPEMETRICS_H
+#define WATER_SUPPLY_MANAGEMENT_PIPEMETRICS_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief Count, mean, variance, extremes and quantiles of a stream of integers, in one pass
+ *
+ * Values are taken in blocks: the sums of a block are integer reductions the
+ * compiler vectorises, and the block is folded into the running mean and sum
+ * of squared deviations with Welford's update generalised to batches (Chan et
+ * al.), which stays accurate however many values come in. Quantiles come from
+ * a log-linear histogram: values below 128 are counted exactly and larger ones
+ * in buckets 1/64 of their magnitude wide, so any quantile is within 1.6% of
+ * the true one in a few KiB, and two histograms add up bucket by bucket.
+ * Values below zero count as zero in the quantiles only.
+ */
+class StreamingStats {
+    uint64_t count = 0;
+    double mean = 0;
+    double m2 = 0;              // sum of squared deviations from the mean
+    int min = INT_MAX;
+    int max = INT_MIN;
+    vector<uint64_t> buckets;
+
+    void addToMoments(uint64_t n, double blockMean, double blockM2);
+public:
+    static constexpr size_t BLOCK = 256;
+
+    /**
+     * @brief Add values, a block of BLOCK at a time
+     */
+    void add(const int* values, size_t n);
+    void add(int value);
+    /**
+     * @brief Add the values another StreamingStats has seen, as if they had been added here
+     */
+    void merge(const StreamingStats& other);
+
+    uint64_t getCount() const;
+    double getMean() const;
+    /**
+     * @brief The sample variance (divided by count - 1), 0 for fewer than two values
+     */
+    double getVariance() const;
+    int getMin() const;
+    int getMax() const;
+    /**
+     * @brief The value below which a fraction q of the values lie, 0 when there are none
+     *
+     * @param q Between 0 and 1
+     */
+    double quantile(double q) const;
+};
+
+/**
+ * @brief What a pipe does in the network, by its ends
+ */
+enum class PipeClass {
+    OUTLET,     // leaves or reaches a reservoir
+    TRUNK,      // joins two stations
+    FEEDER,     // reaches a city, from a station
+};
+
+const size_t PIPE_CLASSES = 3;
+
+/**
+ * @brief The name of a pipe class, "outlet", "trunk" or "feeder"
+ */
+const char* pipeClassName(PipeClass c);
+
+/**
+ * @brief The spare capacity (capacity - flow) of the pipes of a network, overall and by class
+ */
+struct PipeMetrics {
+    StreamingStats all;
+    StreamingStats byClass[PIPE_CLASSES];
+};
+
+/**
+ * @brief Measure the spare capacity of every pipe in one pass over the graph
+ *
+ * Edges touching the super source "S" or super sink "Si" are not pipes and are
+ * left out. A bidirectional pipe is counted once, with the flow it carries in
+ * whichever direction. Nothing proportional to the number of pipes is stored.
+ *
+ * @param g
+ * @return PipeMetrics
+ */
+PipeMetrics measurePipes(const Graph& g);
+
+#endif //WATER_SUPPLY_MANAGEMENT_PIPEMETRICS_H
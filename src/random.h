@@ -0,0 +1,50 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_RANDOM_H
+#define WATER_SUPPLY_MANAGEMENT_RANDOM_H
+
+#include <cstdint>
+
+/**
+ * @brief SplitMix64 generator
+ *
+ * The standard distributions are implementation defined, so the generator
+ * does its own range reduction to keep results identical across compilers.
+ */
+class Random {
+    uint64_t state;
+public:
+    explicit Random(uint64_t seed): state(seed) {}
+
+    /**
+     * @brief The index-th of a family of independent streams, all from one seed
+     *
+     * Work split into numbered pieces draws from the piece's stream, so the
+     * numbers it gets do not depend on which thread runs it or in what order.
+     */
+    static Random stream(uint64_t seed, uint64_t index) {
+        Random mixer(seed ^ (index * 0xD1B54A32D192ED03ULL));
+        return Random(mixer.next());
+    }
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /// Uniform integer in [lo, hi]
+    long uniform(long lo, long hi) {
+        return lo + (long) (next() % (uint64_t) (hi - lo + 1));
+    }
+
+    /// Uniform real in [0, 1)
+    double real() {
+        return (double) (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    bool chance(double p) {
+        return real() < p;
+    }
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_RANDOM_H
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "reliability.h"
+#include "dictionary.h"
+#include "flowmodel.h"
+#include "random.h"
+#include "stats.h"
+#include "trace.h"
+
+namespace {
+
+const long BATCH = 64;      // samples a worker takes at a time
+const long ROUND = 1024;    // samples between checks of the stopping rule
+const double Z = 1.959963984540054;    // of a 95% interval
+
+/**
+ * @brief Deficits summed over the samples of a batch
+ */
+struct Tally {
+    vector<long long> deficits;     // by city id
+    vector<double> squares;
+    vector<long> shortfalls;        // samples in which the city fell short
+    long long total = 0;
+    double totalSquares = 0;
+    long solves = 0;
+
+    explicit Tally(size_t cities = 0): deficits(cities, 0), squares(cities, 0), shortfalls(cities, 0) {}
+};
+
+/**
+ * @brief A solver of its own and the edges each component's failure closes in it
+ */
+struct Worker {
+    FlowModel model;
+    vector<vector<Edge*>> edges;    // by component: reservoirs, then stations, then pipes
+    vector<Edge*> closed;
+    vector<int> flows;
+
+    Worker(const vector<Reservoir>& reservoirs, const vector<Station>& stations, const vector<Pipe>& pipes,
+           const vector<City>& cities, const vector<string>& components): model(reservoirs, stations, pipes, cities) {
+        string error;
+        edges.resize(components.size());
+        for (size_t i = 0; i < components.size(); i++) {
+            model.componentEdges(components[i], edges[i], error);
+        }
+    }
+
+    /**
+     * @brief Close the edges of the failed components in [first, first + count), each failing with probability p
+     *
+     * The gaps between failures are geometric, so only the failures are drawn.
+     */
+    void fail(Random& random, size_t first, size_t count, double p) {
+        if (p <= 0) return;
+        double logMiss = std::log1p(-std::min(p, 1.0));
+        for (size_t i = 0; i < count; i++) {
+            if (p < 1) {
+                double skip = std::floor(std::log1p(-random.real()) / logMiss);
+                if (skip >= (double) (count - i)) return;
+                i += (size_t) skip;
+            }
+            closed.insert(closed.end(), edges[first + i].begin(), edges[first + i].end());
+        }
+    }
+};
+
+/**
+ * @brief Wilson score interval of a proportion
+ */
+void wilson(long successes, long n, double& low, double& high) {
+    double p = (double) successes / (double) n;
+    double z2 = Z * Z / (double) n;
+    double centre = (p + z2 / 2) / (1 + z2);
+    double spread = Z * std::sqrt(p * (1 - p) / (double) n + z2 / (4 * (double) n)) / (1 + z2);
+    low = std::max(0.0, centre - spread);
+    high = std::min(1.0, centre + spread);
+}
+
+}
+
+ReliabilityEstimate estimateReliability(const vector<Reservoir>& reservoirs, const vector<Station>& stations,
+                                        const vector<Pipe>& pipes, const vector<City>& cities,
+                                        const ReliabilityOptions& options) {
+    vector<string> components;
+    for (const auto& r : reservoirs) components.push_back(r.getCode());
+    for (const auto& s : stations) components.push_back(s.getCode());
+    for (const auto& p : pipes) components.push_back(p.getPointA() + "-" + p.getPointB());
+    vector<int> demands;
+    for (const auto& c : cities) demands.push_back((int) c.getDemand());
+
+    // Every worker needs its own graph and baseline solve, they are built in parallel too
+    int threads = (int) std::max(1L, std::min((long) options.threads, (options.maxSamples + BATCH - 1) / BATCH));
+    vector<std::unique_ptr<Worker>> workers(threads);
+    {
+        Trace::Scope scope("reliability workers");
+        vector<std::thread> builders;
+        for (int t = 0; t < threads; t++) {
+            builders.emplace_back([&, t] {
+                workers[t] = std::make_unique<Worker>(reservoirs, stations, pipes, cities, components);
+            });
+        }
+        for (auto& b : builders) b.join();
+    }
+    const vector<int>& baseline = workers.front()->model.getBaseline();
+
+    ReliabilityEstimate estimate;
+    vector<long long> deficits(cities.size(), 0);
+    vector<long double> squares(cities.size(), 0);
+    vector<long> shortfalls(cities.size(), 0);
+    long double totalSum = 0, totalSquares = 0;
+    while (estimate.samples < options.maxSamples) {
+        long first = estimate.samples;
+        long count = std::min(ROUND, options.maxSamples - first);
+        Trace::Scope scope("reliability round", std::to_string(first) + " samples done");
+        vector<Tally> tallies((size_t) ((count + BATCH - 1) / BATCH), Tally(cities.size()));
+        std::atomic<size_t> next{0};
+        auto work = [&](Worker& w) {
+            STATS_PHASE(RELIABILITY);
+            for (size_t b = next++; b < tallies.size(); b = next++) {
+                Tally& tally = tallies[b];
+                long end = std::min(first + count, first + (long) (b + 1) * BATCH);
+                for (long sample = first + (long) b * BATCH; sample < end; sample++) {
+                    Random random = Random::stream(options.seed, (uint64_t) sample);
+                    w.closed.clear();
+                    w.fail(random, 0, reservoirs.size(), options.reservoirFailure);
+                    w.fail(random, reservoirs.size(), stations.size(), options.stationFailure);
+                    w.fail(random, reservoirs.size() + stations.size(), pipes.size(), options.pipeFailure);
+                    if (w.closed.empty()) {
+                        w.flows = baseline;
+                    }
+                    else {
+                        w.model.solve(w.closed, w.flows);
+                        tally.solves++;
+                    }
+                    long long total = 0;
+                    for (size_t i = 0; i < cities.size(); i++) {
+                        long long deficit = std::max(0, demands[i] - w.flows[i]);
+                        tally.deficits[i] += deficit;
+                        tally.squares[i] += (double) (deficit * deficit);
+                        if (deficit > 0) tally.shortfalls[i]++;
+                        total += deficit;
+                    }
+                    tally.total += total;
+                    tally.totalSquares += (double) total * (double) total;
+                }
+            }
+        };
+        vector<std::thread> pool;
+        for (int t = 1; t < threads; t++) {
+            pool.emplace_back([&, t] {
+                Trace::nameThread("reliability worker " + std::to_string(t));
+                work(*workers[t]);
+            });
+        }
+        work(*workers[0]);
+        for (auto& p : pool) p.join();
+
+        // In batch order, so that the sums are the same whichever thread did what
+        for (const Tally& tally : tallies) {
+            for (size_t i = 0; i < cities.size(); i++) {
+                deficits[i] += tally.deficits[i];
+                squares[i] += tally.squares[i];
+                shortfalls[i] += tally.shortfalls[i];
+            }
+            totalSum += tally.total;
+            totalSquares += tally.totalSquares;
+            estimate.solves += tally.solves;
+        }
+        estimate.samples += count;
+
+        long double n = estimate.samples;
+        long double mean = totalSum / n;
+        long double variance = n > 1 ? std::max((long double) 0, (totalSquares - totalSum * mean) / (n - 1)) : 0;
+        estimate.expectedDeficit = (double) mean;
+        estimate.deficitHalfWidth = (double) (Z * std::sqrt(variance / n));
+        if (estimate.samples >= options.minSamples && estimate.deficitHalfWidth <= options.targetError * estimate.expectedDeficit) {
+            estimate.converged = true;
+            break;
+        }
+    }
+
+    long double n = std::max(1L, estimate.samples);
+    estimate.cities.resize(cities.size());
+    for (size_t i = 0; i < cities.size(); i++) {
+        CityReliability& c = estimate.cities[i];
+        c.baselineDeficit = std::max(0, demands[i] - baseline[i]);
+        long double mean = deficits[i] / n;
+        long double variance = n > 1 ? std::max((long double) 0, (squares[i] - deficits[i] * mean) / (n - 1)) : 0;
+        c.expectedDeficit = (double) mean;
+        c.deficitHalfWidth = (double) (Z * std::sqrt(variance / n));
+        c.shortProbability = (double) shortfalls[i] / (double) n;
+        wilson(shortfalls[i], (long) n, c.shortLow, c.shortHigh);
+    }
+    return estimate;
+}
+
+int runReliability(const ReliabilityOptions& options, const std::string& outputFile,
+                   const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+                   const std::vector<Pipe>& pipes, const std::vector<City>& cities) {
+    std::ofstream output(outputFile);
+    if (!output.is_open()) {
+        std::cerr << "Error: Unable to open " << outputFile << "\n";
+        return 1;
+    }
+    ReliabilityEstimate estimate = estimateReliability(reservoirs, stations, pipes, cities, options);
+
+    CodeDictionary codes = CodeDictionary::of(cities);
+    output << "City,Baseline,Expected,HalfWidth,Probability,ProbabilityLow,ProbabilityHigh\n";
+    for (int id : codes.inCodeOrder()) {
+        const CityReliability& c = estimate.cities[id];
+        output << cities[id].getCode() << ',' << c.baselineDeficit << ',' << c.expectedDeficit << ','
+               << c.deficitHalfWidth << ',' << c.shortProbability << ',' << c.shortLow << ',' << c.shortHigh << '\n';
+    }
+    output.close();
+    if (output.fail()) {
+        std::cerr << "Error: Unable to write " << outputFile << "\n";
+        return 1;
+    }
+
+    std::cout << "Sampled " << estimate.samples << " failure scenarios (" << estimate.solves << " solved), written to "
+              << outputFile << "\n"
+              << "Expected total deficit " << estimate.expectedDeficit << " +- " << estimate.deficitHalfWidth << " (95%)";
+    if (!estimate.converged) std::cout << ", short of the target error after the maximum number of samples";
+    std::cout << "\n";
+    return 0;
+}
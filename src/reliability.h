@@ -0,0 +1,83 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_RELIABILITY_H
+#define WATER_SUPPLY_MANAGEMENT_RELIABILITY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief How a reliability estimate is sampled and when it stops
+ */
+struct ReliabilityOptions {
+    double pipeFailure = 0;         // probability that a pipe is out of service, each independently
+    double stationFailure = 0;
+    double reservoirFailure = 0;
+    long minSamples = 1000;
+    long maxSamples = 100000;
+    double targetError = 0.01;      // relative half-width of the 95% interval of the expected total deficit
+    uint64_t seed = 1;
+    int threads = 1;
+};
+
+/**
+ * @brief What the sampled failures cost one city
+ */
+struct CityReliability {
+    int baselineDeficit = 0;        // with every component in service
+    double expectedDeficit = 0;
+    double deficitHalfWidth = 0;    // of its 95% confidence interval
+    double shortProbability = 0;    // that the city gets less than its demand
+    double shortLow = 0, shortHigh = 0;     // 95% (Wilson) confidence interval of shortProbability
+};
+
+/**
+ * @brief Expected deficits under random failures, see estimateReliability
+ */
+struct ReliabilityEstimate {
+    long samples = 0;
+    long solves = 0;                // samples in which some component failed
+    double expectedDeficit = 0;     // over all the cities
+    double deficitHalfWidth = 0;
+    bool converged = false;         // whether targetError was reached before maxSamples
+    vector<CityReliability> cities; // by id
+};
+
+/**
+ * @brief Estimate the deficits of the cities when pipes, stations and reservoirs fail at random
+ *
+ * Every sample takes each component out of service with its class's
+ * probability, independently, and solves the network warm-started from the
+ * baseline (FlowModel); samples where nothing fails reuse the baseline.
+ * Failures are drawn by skipping geometrically between failed components, so
+ * a sample costs its failures rather than the size of the network.
+ *
+ * Samples are numbered and sample i draws from stream i of the seed, in
+ * batches that worker threads take in turn, each solving on its own
+ * FlowModel. Batch totals are combined in batch order and the stopping rule
+ * is checked at fixed sample counts, so the same options give the same
+ * estimate whatever the number of threads.
+ *
+ * Sampling stops once the variance of the expected total deficit is small
+ * enough for its 95% interval to be within targetError of it (after at least
+ * minSamples), or at maxSamples.
+ *
+ * @param options
+ * @return ReliabilityEstimate
+ */
+ReliabilityEstimate estimateReliability(const vector<Reservoir>& reservoirs, const vector<Station>& stations,
+                                        const vector<Pipe>& pipes, const vector<City>& cities,
+                                        const ReliabilityOptions& options);
+
+/**
+ * @brief Estimate reliability and write each city's expected deficit and probability of falling short as CSV
+ *
+ * @param options
+ * @param outputFile
+ * @return int 0, or 1 if the file could not be written
+ */
+int runReliability(const ReliabilityOptions& options, const std::string& outputFile,
+                   const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+                   const std::vector<Pipe>& pipes, const std::vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_RELIABILITY_H
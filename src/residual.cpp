@@ -0,0 +1,235 @@
+#include <algorithm>
+#include "residual.h"
+
+SplitNetwork::SplitNetwork(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities) {
+    for (Vertex* v : g.getVertexSet()) {
+        if (v->getInfo() != "S" && v->getInfo() != "Si") vertices.push_back(v);
+    }
+
+    // A limited station is an in node, where its pipes arrive, and an out node joined to it by its limit
+    int n = (int) vertices.size();
+    nodes = n;
+    for (int i = 0; i < n; i++) {
+        in[vertices[i]] = i;
+        out[vertices[i]] = vertices[i]->isLimited() ? nodes++ : i;
+    }
+    source = nodes++;
+    sink = nodes++;
+
+    for (int i = 0; i < n; i++) {
+        Vertex* v = vertices[i];
+        if (v->isType(VertexType::RESERVOIR)) {
+            arcs.push_back({SplitArc::DELIVERY, source, i, reservoirs[v->getId() - 1].getMaxDelivery(), v, nullptr, false});
+        }
+        if (v->isType(VertexType::CITY)) {
+            arcs.push_back({SplitArc::DEMAND, out[v], sink, (int) cities[v->getId() - 1].getDemand(), v, nullptr, false});
+        }
+        if (v->isLimited()) {
+            arcs.push_back({SplitArc::LIMIT, i, out[v], v->getLimit(), v, nullptr, false});
+        }
+        for (Edge* e : v->getAdj()) {
+            Vertex* w = e->getDest();
+            if (!in.count(w) || e->getCapacity() <= 0) continue;
+            arcs.push_back({SplitArc::PIPE, out[v], in[w], e->getCapacity(), w, e, false});
+            if (e->isUndirected()) arcs.push_back({SplitArc::PIPE, out[w], in[v], e->getCapacity(), v, e, true});
+        }
+    }
+}
+
+int SplitNetwork::getNodes() const {
+    return nodes;
+}
+
+int SplitNetwork::getSource() const {
+    return source;
+}
+
+int SplitNetwork::getSink() const {
+    return sink;
+}
+
+const vector<Vertex*>& SplitNetwork::getVertices() const {
+    return vertices;
+}
+
+const vector<SplitArc>& SplitNetwork::getArcs() const {
+    return arcs;
+}
+
+int SplitNetwork::getIn(const Vertex* v) const {
+    return in.at(v);
+}
+
+int SplitNetwork::getOut(const Vertex* v) const {
+    return out.at(v);
+}
+
+ArcTopology::ArcTopology(int n): nodes(n) {}
+
+int ArcTopology::addArc(int u, int v, long long c, long long back) {
+    from.push_back(u);
+    to.push_back(v);
+    capacity.push_back(c);
+    from.push_back(v);
+    to.push_back(u);
+    capacity.push_back(back);
+    return (int) from.size() - 2;
+}
+
+void ArcTopology::index() {
+    first.assign(nodes + 1, 0);
+    for (int u : from) first[u + 1]++;
+    for (int v = 0; v < nodes; v++) first[v + 1] += first[v];
+    order.assign(from.size(), 0);
+    vector<int> next(first.begin(), first.end() - 1);
+    for (int a = 0; a < (int) from.size(); a++) order[next[from[a]]++] = a;
+}
+
+int ArcTopology::getNodes() const {
+    return nodes;
+}
+
+int ArcTopology::getFrom(int arc) const {
+    return from[arc];
+}
+
+int ArcTopology::getTo(int arc) const {
+    return to[arc];
+}
+
+ResidualNetwork::ResidualNetwork(const ArcTopology& t): topology(t), residual(t.capacity) {}
+
+void ResidualNetwork::reset() {
+    residual = topology.capacity;
+}
+
+long long ResidualNetwork::maxFlow(int s, int t, long long limit, const vector<int>* distances) {
+    const vector<int>& first = topology.first;
+    const vector<int>& order = topology.order;
+    const vector<int>& from = topology.from;
+    const vector<int>& to = topology.to;
+    long long total = 0;
+    while (total < limit) {
+        if (distances != nullptr) {
+            // The search is done already, only t's distance is left to find
+            level = *distances;
+            level[t] = -1;
+            for (int i = first[t]; i < first[t + 1]; i++) {
+                int a = order[i];
+                int u = to[a];
+                if (residual[a ^ 1] > 0 && level[u] >= 0 && (level[t] < 0 || level[u] + 1 < level[t])) level[t] = level[u] + 1;
+            }
+            distances = nullptr;
+        }
+        else {
+            level.assign(topology.nodes, -1);
+            queue.clear();
+            level[s] = 0;
+            queue.push_back(s);
+            for (size_t head = 0; head < queue.size() && level[t] < 0; head++) {
+                int u = queue[head];
+                for (int i = first[u]; i < first[u + 1]; i++) {
+                    int a = order[i];
+                    if (residual[a] > 0 && level[to[a]] < 0) {
+                        level[to[a]] = level[u] + 1;
+                        queue.push_back(to[a]);
+                    }
+                }
+            }
+        }
+        if (level[t] < 0) {
+            return total;
+        }
+
+        // Depth-first with a stack, paths can be as long as the network is wide
+        current.assign(first.begin(), first.end() - 1);
+        path.clear();
+        int u = s;
+        while (total < limit) {
+            if (u == t) {
+                long long amount = limit - total;
+                for (int a : path) amount = std::min(amount, residual[a]);
+                for (int a : path) push(a, amount);
+                total += amount;
+                // Back up to the first arc the push used up
+                size_t keep = 0;
+                while (keep < path.size() && residual[path[keep]] > 0) keep++;
+                if (keep == path.size()) break;     // the limit was reached
+                u = from[path[keep]];
+                path.resize(keep);
+                continue;
+            }
+            bool advanced = false;
+            for (; current[u] < first[u + 1]; current[u]++) {
+                int a = order[current[u]];
+                // Nodes as far as t or farther cannot be on a shortest path to it
+                if (residual[a] > 0 && level[to[a]] == level[u] + 1 && (level[to[a]] < level[t] || to[a] == t)) {
+                    path.push_back(a);
+                    u = to[a];
+                    advanced = true;
+                    break;
+                }
+            }
+            if (advanced) continue;
+            level[u] = -1;  // a dead end for the rest of the phase
+            if (path.empty()) break;
+            u = from[path.back()];
+            path.pop_back();
+        }
+    }
+    return total;
+}
+
+vector<int> ResidualNetwork::distancesFrom(int s) const {
+    const vector<int>& first = topology.first;
+    const vector<int>& order = topology.order;
+    const vector<int>& to = topology.to;
+    vector<int> distances(topology.nodes, -1);
+    vector<int> pending{s};
+    distances[s] = 0;
+    for (size_t head = 0; head < pending.size(); head++) {
+        int u = pending[head];
+        for (int i = first[u]; i < first[u + 1]; i++) {
+            int a = order[i];
+            if (residual[a] > 0 && distances[to[a]] < 0) {
+                distances[to[a]] = distances[u] + 1;
+                pending.push_back(to[a]);
+            }
+        }
+    }
+    return distances;
+}
+
+vector<bool> ResidualNetwork::sourceSide(int t) const {
+    const vector<int>& first = topology.first;
+    const vector<int>& order = topology.order;
+    const vector<int>& to = topology.to;
+    vector<bool> reaches(topology.nodes, false);
+    vector<int> pending{t};
+    reaches[t] = true;
+    for (size_t head = 0; head < pending.size(); head++) {
+        int v = pending[head];
+        for (int i = first[v]; i < first[v + 1]; i++) {
+            int a = order[i];
+            // The reverse of an arc leaving v enters it
+            if (residual[a ^ 1] > 0 && !reaches[to[a]]) {
+                reaches[to[a]] = true;
+                pending.push_back(to[a]);
+            }
+        }
+    }
+    vector<bool> side(topology.nodes);
+    for (int v = 0; v < topology.nodes; v++) side[v] = !reaches[v];
+    return side;
+}
+
+long long ResidualNetwork::getFlow(int arc) const {
+    return residual[arc ^ 1] - topology.capacity[arc ^ 1];
+}
+
+long long ResidualNetwork::setCapacity(int arc, long long capacity) {
+    long long flow = getFlow(arc);
+    residual[arc] = capacity;
+    residual[arc ^ 1] = topology.capacity[arc ^ 1];
+    return flow;
+}
@@ -0,0 +1,152 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_RESIDUAL_H
+#define WATER_SUPPLY_MANAGEMENT_RESIDUAL_H
+
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include "graph.h"
+
+using namespace std;
+
+/**
+ * @brief An arc of a graph's network laid out by SplitNetwork
+ */
+struct SplitArc {
+    enum Kind { DELIVERY, DEMAND, LIMIT, PIPE };
+
+    Kind kind;
+    int from, to;
+    long long capacity;     // the reservoir's maximum delivery, the city's (truncated) demand, the limit or the pipe's
+    Vertex* vertex;         // the reservoir, the city, the limited station, or the vertex a pipe arc enters
+    Edge* edge;             // of a pipe, nullptr for the others
+    bool reverse;           // the way back of an undirected pipe, from its edge's destination
+};
+
+/**
+ * @brief A graph's network as nodes and arcs, with a source and a sink, for the solvers that work on arc arrays
+ *
+ * A limited station is an in node, where its pipes arrive, and an out node
+ * joined to it by its limit (a LIMIT arc); other vertices are one node. The
+ * source has a DELIVERY arc to every reservoir and every city a DEMAND arc to
+ * the sink. A pipe is a PIPE arc from the out node of one end to the in node
+ * of the other, and an undirected pipe a second one back, right after it.
+ * Closed pipes (capacity 0) and the super source and sink, if attached, are
+ * left out. Arcs come vertex by vertex: delivery, demand, limit, then pipes.
+ *
+ * Each solver reads the arcs into its own structure and gives them the
+ * capacities it needs, a sink arc closed until a city's turn for example.
+ */
+class SplitNetwork {
+    vector<Vertex*> vertices;       // the in node of vertices[i] is i
+    unordered_map<const Vertex*, int> in, out;
+    vector<SplitArc> arcs;
+    int nodes;
+    int source, sink;
+public:
+    SplitNetwork(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities);
+
+    int getNodes() const;
+    int getSource() const;
+    int getSink() const;
+    const vector<Vertex*>& getVertices() const;
+    const vector<SplitArc>& getArcs() const;
+    /**
+     * @brief The node a vertex's pipes arrive at
+     */
+    int getIn(const Vertex* v) const;
+    /**
+     * @brief The node a vertex's pipes leave from, and its demand arc
+     */
+    int getOut(const Vertex* v) const;
+};
+
+/**
+ * @brief The arcs of a network in compressed form: arc 2k is an arc and 2k + 1 its reverse
+ *
+ * Only the topology and the capacities; flows live in a ResidualNetwork, so
+ * one topology can be shared, read-only, by as many solves as run at once.
+ */
+class ArcTopology {
+    vector<int> from, to;
+    vector<long long> capacity;
+    vector<int> first, order;       // the arcs leaving each node are order[first[v] .. first[v + 1])
+    int nodes;
+
+    friend class ResidualNetwork;
+public:
+    explicit ArcTopology(int n);
+
+    /**
+     * @brief Add an arc and its reverse
+     *
+     * @param back The reverse's capacity, that of the arc the other way for a pipe that works both ways
+     *
+     * @return int The arc's number, its reverse is the number + 1
+     */
+    int addArc(int u, int v, long long c, long long back = 0);
+    /**
+     * @brief Group the arcs by the node they leave, once they are all added
+     */
+    void index();
+    int getNodes() const;
+    int getFrom(int arc) const;
+    int getTo(int arc) const;
+};
+
+/**
+ * @brief Residual capacities over an ArcTopology, and Dinic's algorithm on them
+ */
+class ResidualNetwork {
+    const ArcTopology& topology;
+    vector<long long> residual;
+    vector<int> level, current, path, queue;
+
+    void push(int a, long long amount) {
+        residual[a] -= amount;
+        residual[a ^ 1] += amount;
+    }
+public:
+    static constexpr long long UNLIMITED = numeric_limits<long long>::max() / 4;    // a capacity no flow reaches
+
+    /**
+     * @brief Start from the topology's capacities and no flow
+     */
+    explicit ResidualNetwork(const ArcTopology& topology);
+
+    /**
+     * @brief Back to the topology's capacities and no flow
+     */
+    void reset();
+    /**
+     * @brief Dinic's algorithm, from s to t
+     *
+     * @param limit Stop once this much is delivered
+     * @param distances If given, the distances from s in the residual network as it is now (see
+     * distancesFrom, t's may be missing), used for the first phase instead of a search
+     * @return long long The flow delivered
+     */
+    long long maxFlow(int s, int t, long long limit = numeric_limits<long long>::max(), const vector<int>* distances = nullptr);
+    /**
+     * @brief The number of arcs from s to each node in the residual network, -1 where s does not reach
+     */
+    vector<int> distancesFrom(int s) const;
+    /**
+     * @brief The nodes from which t cannot be reached in the residual network, the largest minimum cut's source side
+     */
+    vector<bool> sourceSide(int t) const;
+    /**
+     * @brief The flow an arc carries
+     */
+    long long getFlow(int arc) const;
+    /**
+     * @brief Give an arc a new capacity and no flow
+     *
+     * Whatever flow the arc carried is left as excess at the node it leaves
+     * and as a shortage at the one it enters, for the caller to route.
+     *
+     * @return long long The flow the arc carried
+     */
+    long long setCapacity(int arc, long long capacity);
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_RESIDUAL_H
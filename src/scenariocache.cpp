@@ -0,0 +1,112 @@
+#include "scenariocache.h"
+
+namespace {
+
+uint64_t mix(uint64_t h, uint64_t value) {
+    h ^= value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 27);
+}
+
+}
+
+bool ScenarioCache::Key::operator==(const Key& other) const {
+    return version == other.version && modified == other.modified;
+}
+
+ScenarioCache::ScenarioCache(size_t budget_): budget(budget_) {}
+
+uint64_t ScenarioCache::hash(const Key& key) {
+    uint64_t h = mix(0, key.version);
+    for (const auto& [edge, capacity] : key.modified) {
+        h = mix(h, ((uint64_t) (uint32_t) edge << 32) | (uint32_t) capacity);
+    }
+    return h;
+}
+
+const ScenarioCache::Entry* ScenarioCache::find(const Key& key) {
+    auto range = index.equal_range(hash(key));
+    for (auto it = range.first; it != range.second; it++) {
+        if (it->second->key == key) {
+            lru.splice(lru.begin(), lru, it->second);
+            hits++;
+            return &lru.front().entry;
+        }
+    }
+    misses++;
+    return nullptr;
+}
+
+void ScenarioCache::insert(const Key& key, Entry entry) {
+    size_t bytes = sizeof(Node) + key.modified.size() * sizeof(pair<int, int>)
+            + (entry.cityFlows.size() + entry.edgeFlows.size()) * sizeof(int);
+    if (bytes > budget) {
+        return;
+    }
+    uint64_t h = hash(key);
+    auto range = index.equal_range(h);
+    for (auto it = range.first; it != range.second; it++) {
+        if (it->second->key == key) {
+            memory -= it->second->bytes;
+            lru.erase(it->second);
+            index.erase(it);
+            break;
+        }
+    }
+    evict(budget - bytes);
+    lru.push_front({key, h, std::move(entry), bytes});
+    index.emplace(h, lru.begin());
+    memory += bytes;
+}
+
+void ScenarioCache::evict(size_t bytes) {
+    while (memory > bytes && !lru.empty()) {
+        Node& node = lru.back();
+        auto range = index.equal_range(node.hash);
+        for (auto it = range.first; it != range.second; it++) {
+            if (&*it->second == &node) {
+                index.erase(it);
+                break;
+            }
+        }
+        memory -= node.bytes;
+        lru.pop_back();
+        evictions++;
+    }
+}
+
+void ScenarioCache::clear() {
+    lru.clear();
+    index.clear();
+    memory = 0;
+}
+
+void ScenarioCache::setBudget(size_t bytes) {
+    budget = bytes;
+    evict(budget);
+}
+
+size_t ScenarioCache::getBudget() const {
+    return budget;
+}
+
+size_t ScenarioCache::getMemory() const {
+    return memory;
+}
+
+size_t ScenarioCache::getSize() const {
+    return lru.size();
+}
+
+size_t ScenarioCache::getHits() const {
+    return hits;
+}
+
+size_t ScenarioCache::getMisses() const {
+    return misses;
+}
+
+size_t ScenarioCache::getEvictions() const {
+    return evictions;
+}
@@ -0,0 +1,92 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_SCENARIOCACHE_H
+#define WATER_SUPPLY_MANAGEMENT_SCENARIOCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Maximum flow solutions remembered by scenario
+ *
+ * A scenario is a graph version (see Graph::getVersion) together with the
+ * edges whose capacity was changed from the one they were built with, which is
+ * how the analyses take reservoirs, stations and pipes out of service. Asking
+ * the same what-if twice, or asking for the baseline once per city, then costs
+ * a lookup instead of a solve.
+ *
+ * The least recently used solutions are dropped once the memory they take
+ * goes over the budget.
+ */
+class ScenarioCache {
+public:
+    struct Key {
+        unsigned long version = 0;
+        vector<pair<int, int>> modified; // edge index and its current capacity
+        bool operator==(const Key& other) const;
+    };
+    struct Entry {
+        vector<int> cityFlows; // indexed by city id - 1
+        vector<int> edgeFlows; // in Graph::getEdgeFlows order
+    };
+
+    static const size_t DEFAULT_BUDGET = 64 << 20;
+
+    explicit ScenarioCache(size_t budget = DEFAULT_BUDGET);
+    ScenarioCache(const ScenarioCache&) = delete;
+    ScenarioCache& operator=(const ScenarioCache&) = delete;
+    /**
+     * @brief Look up the solution of a scenario
+     *
+     * @param key
+     * @return const Entry* nullptr if the scenario is not cached; valid until the next insert
+     */
+    const Entry* find(const Key& key);
+    /**
+     * @brief Remember the solution of a scenario, evicting older ones to stay within budget
+     *
+     * Solutions larger than the whole budget are not kept.
+     *
+     * @param key
+     * @param entry
+     */
+    void insert(const Key& key, Entry entry);
+    void clear();
+    /**
+     * @brief Set the memory budget in bytes, 0 disables the cache
+     *
+     * @param bytes
+     */
+    void setBudget(size_t bytes);
+    size_t getBudget() const;
+    size_t getMemory() const;
+    size_t getSize() const;
+    size_t getHits() const;
+    size_t getMisses() const;
+    size_t getEvictions() const;
+
+private:
+    struct Node {
+        Key key;
+        uint64_t hash;
+        Entry entry;
+        size_t bytes;
+    };
+
+    list<Node> lru; // most recently used first
+    unordered_multimap<uint64_t, list<Node>::iterator> index;
+    size_t budget;
+    size_t memory = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+    static uint64_t hash(const Key& key);
+    void evict(size_t bytes);
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_SCENARIOCACHE_H
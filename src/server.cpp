@@ -0,0 +1,336 @@
+#include <iostream>
+#include "server.h"
+
+#ifdef _WIN32
+
+int runServer(const std::string&, int, const std::vector<Reservoir>&, const std::vector<Station>&,
+              const std::vector<Pipe>&, const std::vector<City>&) {
+    std::cerr << "Server mode needs Unix domain sockets and is not available on Windows\n";
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "flowmodel.h"
+#include "jobs.h"
+#include "trace.h"
+
+namespace {
+
+std::atomic<bool> stopping{false};
+std::atomic<int> wakeFd{-1};   // write end of the pipe the accept loop polls next to the listener
+
+/**
+ * @brief Stop the server, whichever thread the signal is delivered to
+ */
+void onSignal(int) {
+    stopping = true;
+    int fd = wakeFd;
+    if (fd >= 0) {
+        char byte = 0;
+        ssize_t written = write(fd, &byte, 1);
+        (void) written;
+    }
+}
+
+/**
+ * @brief Everything one solve needs; solves change the graphs while they run
+ */
+struct Workspace {
+    FlowModel model;
+    Graph plain;
+    Actions actions;
+
+    Workspace(const vector<Reservoir>& reservoirs, const vector<Station>& stations, const vector<Pipe>& pipes, const vector<City>& cities):
+        model(reservoirs, stations, pipes, cities), actions(reservoirs, stations, cities, pipes) {
+        Trace::Scope scope("build graph");
+        plain = plain.buildGraph(reservoirs, stations, pipes, cities);
+    }
+};
+
+/**
+ * @brief Hands out workspaces to client threads, one solve at a time
+ */
+class WorkspacePool {
+    std::vector<std::unique_ptr<Workspace>> all;
+    std::vector<Workspace*> free;
+    std::mutex mutex;
+    std::condition_variable available;
+public:
+    void add(std::unique_ptr<Workspace> w) {
+        free.push_back(w.get());
+        all.push_back(std::move(w));
+    }
+
+    const Workspace& any() const {
+        return *all.front();
+    }
+
+    Workspace* acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this] { return !free.empty(); });
+        Workspace* w = free.back();
+        free.pop_back();
+        return w;
+    }
+
+    void release(Workspace* w) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            free.push_back(w);
+        }
+        available.notify_one();
+    }
+};
+
+std::string toUpper(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char) std::toupper(c); });
+    return s;
+}
+
+std::string handle(const std::string& line, WorkspacePool& pool) {
+    std::istringstream iss(line);
+    std::string command;
+    iss >> command;
+    command = toUpper(command);
+
+    if (command == "PING") {
+        return "OK PONG";
+    }
+    if (command == "JOB") {
+        std::string rest;
+        getline(iss, rest);
+        Job job;
+        std::string error;
+        if (!parseJob(rest, job, error)) return "ERR " + error;
+        if (job.command.empty()) return "ERR empty job";
+        Workspace* w = pool.acquire();
+        std::string result = runJob(job, w->plain, w->actions, error);
+        pool.release(w);
+        return result.empty() ? "ERR " + error : "OK " + result;
+    }
+    if (command != "FLOW" && command != "FLOWS" && command != "NEED" && command != "TOTAL" && command != "SLACK") {
+        return "ERR unknown command " + command;
+    }
+
+    std::string city, word;
+    std::vector<std::string> disabled;
+    if (command == "FLOW" && !(iss >> city)) {
+        return "ERR FLOW needs a city";
+    }
+    if (iss >> word) {
+        if (toUpper(word) != "WITHOUT") return "ERR expected WITHOUT, got " + word;
+        while (iss >> word) disabled.push_back(word);
+        if (disabled.empty()) return "ERR WITHOUT needs at least one component";
+    }
+
+    const FlowModel& baseline = pool.any().model;
+    const CodeDictionary& cityCodes = baseline.getCityCodes();
+    // Before any solve, which would be wasted on a city that does not exist
+    int id = command == "FLOW" ? cityCodes.find(city) : -1;
+    if (command == "FLOW" && id < 0) return "ERR city " + city + " not found";
+    std::vector<int> flows;
+    SlackTally<int> slack;
+    if (disabled.empty()) {
+        flows = baseline.getBaseline();
+        slack = baseline.getBaselineSlack();
+    } else {
+        std::string error;
+        Workspace* w = pool.acquire();
+        bool solved = w->model.solve(disabled, flows, error, command == "SLACK" ? &slack : nullptr);
+        pool.release(w);
+        if (!solved) return "ERR " + error;
+    }
+
+    std::ostringstream out;
+    out << "OK";
+    if (command == "FLOW") {
+        out << " " << flows[id];
+    } else if (command == "TOTAL") {
+        int total = 0;
+        for (int f : flows) total += f;
+        out << " " << total;
+    } else if (command == "SLACK") {
+        out << " pipes=" << slack.getPipes() << " average=" << slack.getMean() << " variance=" << slack.getVariance()
+            << " max=" << slack.getMax() << " saturated=" << slack.getSaturated();
+    } else if (command == "FLOWS") {
+        for (int id : cityCodes.inCodeOrder()) out << " " << cityCodes.code(id) << "=" << flows[id];
+    } else {
+        const vector<City>& cities = baseline.getCities();
+        for (size_t i = 0; i < cities.size(); i++) {
+            int deficit = cities[i].getDemand() - flows[i];
+            if (deficit > 0) out << " " << cities[i].getCode() << "=" << deficit;
+        }
+    }
+    return out.str();
+}
+
+bool sendLine(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += (size_t) n;
+    }
+    return true;
+}
+
+void serveClient(int fd, WorkspacePool& pool) {
+    std::string buffer;
+    char chunk[4096];
+    bool open = true;
+    while (open) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer.append(chunk, (size_t) n);
+        size_t newline;
+        while (open && (newline = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.find_first_not_of(" \t") == std::string::npos) continue;
+            std::istringstream iss(line);
+            std::string command;
+            iss >> command;
+            if (toUpper(command) == "QUIT") {
+                open = false;
+                break;
+            }
+            Trace::Scope scope("request", line);
+            open = sendLine(fd, handle(line, pool));
+        }
+    }
+}
+
+}
+
+int runServer(const std::string& socketPath, int threads,
+              const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+              const std::vector<Pipe>& pipes, const std::vector<City>& cities) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << socketPath << "\n";
+        return 1;
+    }
+
+    // Every workspace solves the baseline once, in parallel
+    WorkspacePool pool;
+    std::vector<std::unique_ptr<Workspace>> workspaces(std::max(1, threads));
+    std::vector<std::thread> builders;
+    for (auto& w : workspaces)
+        builders.emplace_back([&] {
+            Trace::nameThread("workspace builder");
+            w = std::make_unique<Workspace>(reservoirs, stations, pipes, cities);
+        });
+    for (auto& b : builders)
+        b.join();
+    for (auto& w : workspaces)
+        pool.add(std::move(w));
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: Unable to create a socket: " << strerror(errno) << "\n";
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    // Replace a socket left behind by an earlier run, but nothing else
+    struct stat existing{};
+    if (lstat(socketPath.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::cerr << "Error: " << socketPath << " exists and is not a socket\n";
+            close(listener);
+            return 1;
+        }
+        unlink(socketPath.c_str());
+    }
+    if (bind(listener, (sockaddr*) &address, sizeof(address)) < 0 || listen(listener, 64) < 0) {
+        std::cerr << "Error: Unable to listen on " << socketPath << ": " << strerror(errno) << "\n";
+        close(listener);
+        return 1;
+    }
+
+    // The signal may land in any thread, so the handler wakes the accept loop through a pipe
+    int wake[2];
+    if (pipe(wake) < 0) {
+        std::cerr << "Error: Unable to create a pipe: " << strerror(errno) << "\n";
+        close(listener);
+        unlink(socketPath.c_str());
+        return 1;
+    }
+    fcntl(wake[1], F_SETFL, fcntl(wake[1], F_GETFL) | O_NONBLOCK);
+    wakeFd = wake[1];
+    struct sigaction action{};
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Listening on " << socketPath << " with " << workspaces.size() << " solver(s)" << std::endl;
+
+    std::set<int> clients;
+    std::mutex clientsMutex;
+    std::condition_variable clientsDone;
+    pollfd polled[2] = {{listener, POLLIN, 0}, {wake[0], POLLIN, 0}};
+    while (!stopping) {
+        if (poll(polled, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: poll failed: " << strerror(errno) << "\n";
+            break;
+        }
+        if (polled[1].revents != 0) break;
+        if ((polled[0].revents & POLLIN) == 0) continue;
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: accept failed: " << strerror(errno) << "\n";
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            clients.insert(fd);
+        }
+        std::thread([fd, &pool, &clients, &clientsMutex, &clientsDone] {
+            Trace::nameThread("client " + std::to_string(fd));
+            serveClient(fd, pool);
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            clients.erase(fd);
+            close(fd);
+            clientsDone.notify_all();
+        }).detach();
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    wakeFd = -1;
+    close(wake[0]);
+    close(wake[1]);
+
+    // Wake up clients waiting for a request and let them finish the one they are on
+    std::unique_lock<std::mutex> lock(clientsMutex);
+    for (int fd : clients)
+        shutdown(fd, SHUT_RDWR);
+    clientsDone.wait(lock, [&clients] { return clients.empty(); });
+    return 0;
+}
+
+#endif
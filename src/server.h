@@ -0,0 +1,39 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_SERVER_H
+#define WATER_SUPPLY_MANAGEMENT_SERVER_H
+
+#include <string>
+#include <vector>
+#include "Reservoir.h"
+#include "Station.h"
+#include "City.h"
+#include "Pipe.h"
+
+/**
+ * @brief Serve queries over a Unix domain socket until interrupted
+ *
+ * The network and its baseline flow stay in memory. Each client sends one
+ * request per line and gets one response line back, "OK ..." or "ERR ...":
+ *
+ *     PING                                   OK PONG
+ *     FLOW <city> [WITHOUT <component>...]   OK <flow>
+ *     FLOWS [WITHOUT <component>...]         OK <city>=<flow> ...
+ *     NEED [WITHOUT <component>...]          OK <city>=<deficit> ...
+ *     TOTAL [WITHOUT <component>...]         OK <flow>
+ *     SLACK [WITHOUT <component>...]         OK pipes=<n> average=<x> variance=<x> max=<x> saturated=<n>
+ *     JOB <batch job line>                   OK <JSON result>
+ *     QUIT                                   closes the connection
+ *
+ * Components are reservoir or station codes, or pipes written as A-B.
+ * Questions without components are answered from the cached baseline; the
+ * others are warm-started from it. Clients are served concurrently, with up
+ * to threads solves running at the same time.
+ *
+ * @param socketPath
+ * @param threads
+ * @return int 0 on a clean shutdown, 1 if the socket could not be set up
+ */
+int runServer(const std::string& socketPath, int threads,
+              const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+              const std::vector<Pipe>& pipes, const std::vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_SERVER_H
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include "simulation.h"
+#include "dictionary.h"
+#include "stats.h"
+#include "trace.h"
+
+bool parseProfile(const std::string& path, std::vector<ProfileChange>& changes, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Unable to open " + path;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 1;
+    getline(file, line);
+    while (getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        std::istringstream iss(line);
+        ProfileChange change;
+        char comma;
+        if (!getline(iss, change.code, ',') || change.code.empty() || !(iss >> change.hour >> comma >> change.value)
+            || comma != ',' || !(iss >> std::ws).eof()) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected Code,Hour,Value";
+            return false;
+        }
+        if (change.hour < 0 || change.value < 0) {
+            error = path + ":" + std::to_string(lineNumber) + ": hours and values cannot be negative";
+            return false;
+        }
+        changes.push_back(change);
+    }
+    return true;
+}
+
+bool writeProfile(const std::vector<ProfileChange>& changes, const std::string& path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "Code,Hour,Value\n";
+    file.setf(std::ios::fixed);
+    file.precision(2);
+    for (const auto& change : changes) {
+        file << change.code << ',' << change.hour << ',' << change.value << '\n';
+    }
+    return file.good();
+}
+
+Simulation::Simulation(const vector<Reservoir>& reservoirs, const vector<Station>& stations, const vector<Pipe>& pipes, const vector<City>& cities_): cities(cities_) {
+    graph = graph.buildGraph(reservoirs, stations, pipes, cities);
+
+    // Same super source and sink as FlowModel, their edges carry the profiles
+    graph.addVertex("Si", VertexType::CITY, 20000);
+    graph.addVertex("S", VertexType::RESERVOIR, 10000);
+    for (const auto& c : cities) {
+        graph.addEdge(c.getCode(), "Si", 1, (int) c.getDemand());
+        demandEdges.push_back(graph.findEdge(c.getCode(), "Si"));
+    }
+    for (const auto& r : reservoirs) {
+        graph.addEdge("S", r.getCode(), 1, r.getMaxDelivery());
+        deliveryEdges.push_back(graph.findEdge("S", r.getCode()));
+    }
+    source = graph.findVertex("S");
+    sink = graph.findVertex("Si");
+}
+
+bool Simulation::addProfile(const std::vector<ProfileChange>& changes, string& error) {
+    std::unordered_map<string, Edge*> edges;
+    for (size_t i = 0; i < cities.size(); i++) {
+        edges[cities[i].getCode()] = demandEdges[i];
+    }
+    for (Edge* e : deliveryEdges) {
+        edges[e->getDest()->getInfo()] = e;
+    }
+
+    vector<Scheduled> added;
+    for (const auto& change : changes) {
+        auto it = edges.find(change.code);
+        if (it == edges.end()) {
+            error = change.code + " is neither a city nor a reservoir";
+            return false;
+        }
+        if (change.hour >= hour) added.push_back({change.hour, it->second, (int) change.value});
+    }
+    // Drop the changes already applied and sort the rest stably, so later changes stay after earlier ones
+    schedule.erase(schedule.begin(), schedule.begin() + (long) next);
+    next = 0;
+    schedule.insert(schedule.end(), added.begin(), added.end());
+    std::stable_sort(schedule.begin(), schedule.end(), [](const Scheduled& a, const Scheduled& b) { return a.hour < b.hour; });
+    return true;
+}
+
+void Simulation::setWarmStart(bool warmStart) {
+    warm = warmStart;
+}
+
+void Simulation::step(vector<int>& flows) {
+    STATS_PHASE(SIMULATION);
+    bool changed = hour == 0 || !warm;
+    for (; next < schedule.size() && schedule[next].hour <= hour; next++) {
+        const Scheduled& s = schedule[next];
+        if (s.edge->getCapacity() == s.capacity) continue;
+        // Only the flow above the new capacity has to go, the rest of the hour before stays
+        if (warm && s.edge->getFlow() > s.capacity) graph.cancelFlow(s.edge, source, sink, s.capacity);
+        s.edge->setCapacity(s.capacity);
+        changed = true;
+    }
+    if (changed) {
+        if (warm) graph.augment(source, sink);
+        else graph.edmondsKarp("S", "Si");
+    }
+    {
+        STATS_PHASE(READ_FLOWS);
+        flows.resize(cities.size());
+        for (size_t i = 0; i < cities.size(); i++) {
+            flows[i] = demandEdges[i]->getFlow();
+        }
+    }
+    hour++;
+}
+
+int Simulation::getHour() const {
+    return hour;
+}
+
+vector<int> Simulation::getDemands() const {
+    vector<int> demands(cities.size());
+    for (size_t i = 0; i < cities.size(); i++) {
+        demands[i] = demandEdges[i]->getCapacity();
+    }
+    return demands;
+}
+
+const vector<City>& Simulation::getCities() const {
+    return cities;
+}
+
+int runSimulation(const std::vector<std::string>& profileFiles, int hours, const std::string& outputFile,
+                  const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+                  const std::vector<Pipe>& pipes, const std::vector<City>& cities) {
+    std::vector<ProfileChange> changes;
+    std::string error;
+    {
+        Trace::Scope scope("load profiles");
+        for (const auto& path : profileFiles) {
+            if (!parseProfile(path, changes, error)) {
+                std::cerr << "Error: " << error << "\n";
+                return 1;
+            }
+        }
+    }
+    Simulation simulation(reservoirs, stations, pipes, cities);
+    if (!simulation.addProfile(changes, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    std::ofstream output(outputFile);
+    if (!output.is_open()) {
+        std::cerr << "Error: Unable to open " << outputFile << "\n";
+        return 1;
+    }
+    CodeDictionary codes = CodeDictionary::of(cities);
+    const vector<int>& order = codes.inCodeOrder();
+    output << "Hour,Demand,Delivered,Deficit";
+    for (int id : order) output << ',' << cities[id].getCode();
+    output << '\n';
+
+    Trace::Scope scope("simulation", std::to_string(hours) + " hours");
+    auto start = std::chrono::steady_clock::now();
+    vector<int> flows;
+    long long totalDemand = 0, totalDelivered = 0, worstDeficit = 0;
+    int hoursShort = 0, worstHour = 0;
+    std::string line;
+    for (int h = 0; h < hours; h++) {
+        simulation.step(flows);
+        vector<int> demands = simulation.getDemands();
+        long long demand = 0, delivered = 0;
+        for (size_t i = 0; i < flows.size(); i++) {
+            demand += demands[i];
+            delivered += flows[i];
+        }
+        line = std::to_string(h) + ',' + std::to_string(demand) + ',' + std::to_string(delivered) + ','
+             + std::to_string(demand - delivered);
+        for (int id : order) {
+            line += ',';
+            line += std::to_string(demands[id] - flows[id]);
+        }
+        line += '\n';
+        output << line;
+
+        totalDemand += demand;
+        totalDelivered += delivered;
+        if (demand > delivered) hoursShort++;
+        if (demand - delivered > worstDeficit) {
+            worstDeficit = demand - delivered;
+            worstHour = h;
+        }
+    }
+    output.close();
+    if (output.fail()) {
+        std::cerr << "Error: Unable to write " << outputFile << "\n";
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Simulated " << hours << " hours in " << seconds << " s, written to " << outputFile << "\n"
+              << "Delivered " << totalDelivered << " of a demand of " << totalDemand << "; "
+              << hoursShort << " hour(s) fell short";
+    if (hoursShort > 0) std::cout << ", the worst by " << worstDeficit << " at hour " << worstHour;
+    std::cout << "\n";
+    return 0;
+}
@@ -0,0 +1,134 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_SIMULATION_H
+#define WATER_SUPPLY_MANAGEMENT_SIMULATION_H
+
+#include <string>
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief A city's demand or a reservoir's maximum delivery, from some hour of a simulation on
+ */
+struct ProfileChange {
+    int hour;
+    std::string code;   // of a city or a reservoir
+    double value;
+};
+
+/**
+ * @brief Read a profile file
+ *
+ * A profile is a CSV file with a header line and then Code,Hour,Value lines:
+ * from that hour on, the city's demand or the reservoir's maximum delivery is
+ * the value, until a later line for the same code. Lines need not be in hour
+ * order, and several files can describe the same network.
+ *
+ * @param path
+ * @param changes The file's lines are appended to it
+ * @param error Set to the file and line of the first malformed line
+ * @return false if the file could not be read or a line is malformed
+ */
+bool parseProfile(const std::string& path, std::vector<ProfileChange>& changes, std::string& error);
+/**
+ * @brief Write changes as a profile file parseProfile reads back
+ *
+ * @param changes
+ * @param path
+ * @return false if the file could not be written
+ */
+bool writeProfile(const std::vector<ProfileChange>& changes, const std::string& path);
+
+/**
+ * @brief A network whose demands and deliveries change hour by hour, kept at a maximum flow
+ *
+ * Every hour starts from the previous hour's flow. Where a capacity shrinks
+ * below the flow it carries, only the excess is cancelled (Graph::cancelFlow),
+ * then the flow is augmented back to a maximum. Consecutive hours differ in a
+ * few capacities, so each step finds a handful of augmenting paths instead of
+ * the thousands of a solve from zero, and hours without changes cost nothing.
+ *
+ * A warm-started hour delivers the same total as a cold solve, but may split
+ * it between cities differently when the maximum flow is not unique.
+ */
+class Simulation {
+    struct Scheduled {
+        int hour;
+        Edge* edge;     // to the super sink for a city, from the super source for a reservoir
+        int capacity;
+    };
+
+    Graph graph;
+    Vertex* source;
+    Vertex* sink;
+    vector<City> cities;
+    vector<Edge*> demandEdges;      // by city id
+    vector<Edge*> deliveryEdges;    // by reservoir id
+    vector<Scheduled> schedule;     // by hour
+    size_t next = 0;
+    int hour = 0;
+    bool warm = true;
+public:
+    Simulation(const vector<Reservoir>& reservoirs, const vector<Station>& stations, const vector<Pipe>& pipes, const vector<City>& cities);
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    /**
+     * @brief Add profile changes to the hours ahead
+     *
+     * Changes at hours already simulated are ignored; at the same hour and
+     * code, the one added last wins.
+     *
+     * @param changes
+     * @param error Set when a code is neither a city nor a reservoir
+     * @return false if a code is neither a city nor a reservoir, nothing is added then
+     */
+    bool addProfile(const std::vector<ProfileChange>& changes, string& error);
+    /**
+     * @brief Solve every hour from zero instead of from the previous hour's flow, to compare with
+     *
+     * @param warmStart
+     */
+    void setWarmStart(bool warmStart);
+    /**
+     * @brief Simulate the next hour: apply its changes and bring the flow back to a maximum
+     *
+     * @param flows Set to the flow reaching each city, by city id
+     */
+    void step(vector<int>& flows);
+    /**
+     * @brief Get the hour the next step simulates, 0 at first
+     *
+     * @return int
+     */
+    int getHour() const;
+    /**
+     * @brief Get the (truncated) demand of each city in the hour last simulated
+     *
+     * @return vector<int> By city id
+     */
+    vector<int> getDemands() const;
+    /**
+     * @brief Get the cities of the network
+     *
+     * @return const vector<City>&
+     */
+    const vector<City>& getCities() const;
+};
+
+/**
+ * @brief Simulate the network hour by hour and write every hour's deficits as CSV
+ *
+ * The output has an Hour,Demand,Delivered,Deficit header followed by the
+ * codes of the cities, and a line per hour with the totals and each city's
+ * deficit. Lines are written as the hours are simulated, so a long run can be
+ * followed (or stopped) as it goes. A summary is printed once it ends.
+ *
+ * @param profileFiles
+ * @param hours Number of hours to simulate
+ * @param outputFile
+ * @return int 0, or 1 if a file could not be read or written
+ */
+int runSimulation(const std::vector<std::string>& profileFiles, int hours, const std::string& outputFile,
+                  const std::vector<Reservoir>& reservoirs, const std::vector<Station>& stations,
+                  const std::vector<Pipe>& pipes, const std::vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_SIMULATION_H
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include "stats.h"
+
+namespace {
+
+std::mutex retiredMutex;
+Stats::Counters retired;
+
+/**
+ * @brief A thread's counters, added to the retired total when the thread ends
+ */
+struct ThreadCounters {
+    Stats::Counters counters;
+    ~ThreadCounters() {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired += counters;
+    }
+};
+
+thread_local ThreadCounters threadCounters;
+
+const char* const phaseNames[Stats::PHASE_COUNT] = {
+    "max flow", "cities in need", "balance", "demand sweep", "deliverable", "supply", "simulation", "reliability", "reservoir outage", "station outage", "pipe outage",
+    "cache lookup", "super nodes", "reset flow", "augment", "bfs", "cancel flow", "read flows",
+};
+
+/**
+ * @brief The hardware counters of each phase, n/a for the events the CPU or kernel does not count
+ */
+std::string hardwareReport(const Stats::Counters& c) {
+    using HC = HardwareCounters;
+    auto percent = [](const HC::Reading& r, HC::Event part, HC::Event whole) -> std::string {
+        if (!HC::isSupported(part) || !HC::isSupported(whole) || r[whole] == 0) return "n/a";
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(2) << 100.0 * (double) r[part] / (double) r[whole] << "%";
+        return s.str();
+    };
+    auto count = [](const HC::Reading& r, HC::Event e) -> std::string {
+        return HC::isSupported(e) ? std::to_string(r[e]) : "n/a";
+    };
+
+    std::ostringstream out;
+    out << "Hardware counters by phase (user space)\n";
+    out << "  " << std::left << std::setw(20) << "phase" << std::right << std::setw(14) << "instructions"
+        << std::setw(8) << "IPC" << std::setw(14) << "cache misses" << std::setw(10) << "of refs"
+        << std::setw(14) << "branch misses" << std::setw(10) << "of all" << "\n";
+    for (int i = 0; i < Stats::PHASE_COUNT; i++) {
+        const HC::Reading& r = c.phaseHardware[i];
+        if (c.phaseCalls[i] == 0 || r[HC::CYCLES] == 0) continue;
+        std::string ipc = "n/a";
+        if (HC::isSupported(HC::INSTRUCTIONS)) {
+            std::ostringstream s;
+            s << std::fixed << std::setprecision(2) << (double) r[HC::INSTRUCTIONS] / (double) r[HC::CYCLES];
+            ipc = s.str();
+        }
+        out << "  " << std::left << std::setw(20) << Stats::phaseName((Stats::Phase) i) << std::right
+            << std::setw(14) << count(r, HC::INSTRUCTIONS) << std::setw(8) << ipc
+            << std::setw(14) << count(r, HC::CACHE_MISSES) << std::setw(10) << percent(r, HC::CACHE_MISSES, HC::CACHE_REFERENCES)
+            << std::setw(14) << count(r, HC::BRANCH_MISSES) << std::setw(10) << percent(r, HC::BRANCH_MISSES, HC::BRANCHES) << "\n";
+    }
+    return out.str();
+}
+
+}
+
+Stats::Counters& Stats::Counters::operator+=(const Counters& other) {
+    solves += other.solves;
+    bfsPasses += other.bfsPasses;
+    augmentingPaths += other.augmentingPaths;
+    edgesScanned += other.edgesScanned;
+    verticesVisited += other.verticesVisited;
+    flowPushed += other.flowPushed;
+    maxPathsPerSolve = std::max(maxPathsPerSolve, other.maxPathsPerSolve);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        phaseCalls[i] += other.phaseCalls[i];
+        phaseSeconds[i] += other.phaseSeconds[i];
+        phaseHardware[i] += other.phaseHardware[i];
+        phaseAllocations[i] += other.phaseAllocations[i];
+        phaseBytes[i] += other.phaseBytes[i];
+        phasePeak[i] = std::max(phasePeak[i], other.phasePeak[i]);
+    }
+    return *this;
+}
+
+Stats::Timer::Timer(Phase p): phase(p), counting(HardwareCounters::read(startCounters)) {
+    start = std::chrono::steady_clock::now();
+}
+
+Stats::Timer::~Timer() {
+    Counters& c = local();
+    c.phaseCalls[phase]++;
+    c.phaseSeconds[phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    HardwareCounters::Reading end;
+    if (counting && HardwareCounters::read(end)) {
+        c.phaseHardware[phase] += end - startCounters;
+    }
+    Allocations::Usage usage = heap.usage();
+    c.phaseAllocations[phase] += usage.allocations;
+    c.phaseBytes[phase] += usage.bytes;
+    c.phasePeak[phase] = std::max(c.phasePeak[phase], usage.peak);
+}
+
+Stats::Counters& Stats::local() {
+    return threadCounters.counters;
+}
+
+Stats::Counters Stats::total() {
+    Counters sum;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        sum = retired;
+    }
+    sum += local();
+    return sum;
+}
+
+void Stats::reset() {
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired = Counters();
+    }
+    local() = Counters();
+}
+
+bool Stats::enabled() {
+#ifdef WATER_SUPPLY_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* Stats::phaseName(Phase phase) {
+    return phaseNames[phase];
+}
+
+std::string Stats::report(const Counters& c) {
+    std::ostringstream out;
+    if (!enabled()) {
+        out << "Statistics were compiled out (configure with -DWATER_SUPPLY_STATS=ON)\n";
+        return out.str();
+    }
+    auto ratio = [](uint64_t a, uint64_t b) { return b == 0 ? 0.0 : (double) a / (double) b; };
+
+    out << std::fixed << std::setprecision(1);
+    out << "Flow engine statistics\n";
+    out << "  solves              " << c.solves << "\n";
+    out << "  bfs passes          " << c.bfsPasses << "\n";
+    out << "  augmenting paths    " << c.augmentingPaths << " (" << ratio(c.augmentingPaths, c.solves)
+        << " per solve, at most " << c.maxPathsPerSolve << ")\n";
+    out << "  edges scanned       " << c.edgesScanned << " (" << ratio(c.edgesScanned, c.bfsPasses) << " per bfs)\n";
+    out << "  vertices visited    " << c.verticesVisited << " (" << ratio(c.verticesVisited, c.bfsPasses) << " per bfs)\n";
+    out << "  flow pushed         " << c.flowPushed << " (" << ratio(c.flowPushed, c.augmentingPaths) << " per path)\n";
+    out << "Time by phase (each includes the phases it contains)\n";
+    out << std::setprecision(3);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (c.phaseCalls[i] == 0) continue;
+        out << "  " << std::left << std::setw(20) << phaseNames[i] << std::right << std::setw(10) << c.phaseCalls[i]
+            << " calls " << std::setw(12) << c.phaseSeconds[i] * 1000 << " ms\n";
+    }
+    if (HardwareCounters::isEnabled()) {
+        out << hardwareReport(c);
+    }
+    if (Allocations::isTracking()) {
+        out << "Heap by phase\n";
+        out << "  " << std::left << std::setw(20) << "phase" << std::right << std::setw(14) << "allocations"
+            << std::setw(12) << "per call" << std::setw(14) << "KiB" << std::setw(12) << "KiB/call"
+            << std::setw(14) << "peak KiB" << "\n";
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            if (c.phaseCalls[i] == 0) continue;
+            out << "  " << std::left << std::setw(20) << phaseNames[i] << std::right << std::setprecision(1)
+                << std::setw(14) << c.phaseAllocations[i] << std::setw(12) << ratio(c.phaseAllocations[i], c.phaseCalls[i])
+                << std::setw(14) << (double) c.phaseBytes[i] / 1024
+                << std::setw(12) << ratio(c.phaseBytes[i], c.phaseCalls[i]) / 1024
+                << std::setw(14) << (double) c.phasePeak[i] / 1024 << "\n";
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,124 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_STATS_H
+#define WATER_SUPPLY_MANAGEMENT_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "perfcounters.h"
+#include "allocations.h"
+
+/**
+ * @brief Counters describing the work done by the flow engines
+ *
+ * Each thread counts into its own Counters, so counting costs a plain
+ * increment. When a thread ends its counters are added to a shared total.
+ *
+ * The hooks in the engines are the STATS_* macros below. They are compiled out
+ * entirely unless WATER_SUPPLY_STATS is defined (the CMake option of the same
+ * name, on by default).
+ */
+class Stats {
+public:
+    /**
+     * @brief Timed sections, which include the time of the sections they contain
+     */
+    enum Phase {
+        MAX_FLOW,           // Actions::maxFlowAllCities and maxFlowSpecificCity
+        CITIES_IN_NEED,
+        BALANCE,
+        DEMAND_SWEEP,
+        DELIVERABLE,        // every city's own maximum flow
+        SUPPLY,             // the reservoirs feeding each city, see traceSupply
+        SIMULATION,         // Simulation::step, an hour of a time series
+        RELIABILITY,        // a worker's share of a round of reliability samples
+        RESERVOIR_OUTAGE,
+        STATION_OUTAGE,
+        PIPE_OUTAGE,
+        CACHE_LOOKUP,       // scenario key and cache lookup before a solve
+        SUPER_NODES,        // adding and removing the super source and sink
+        RESET_FLOW,
+        AUGMENT,
+        BFS,                // Graph::bfs, the search for an augmenting path
+        CANCEL_FLOW,        // warm-start cancellation in FlowModel
+        READ_FLOWS,
+        PHASE_COUNT
+    };
+
+    struct Counters {
+        uint64_t solves = 0;           // calls to Graph::augment
+        uint64_t bfsPasses = 0;
+        uint64_t augmentingPaths = 0;
+        uint64_t edgesScanned = 0;
+        uint64_t verticesVisited = 0;
+        uint64_t flowPushed = 0;
+        uint64_t maxPathsPerSolve = 0;
+        uint64_t phaseCalls[PHASE_COUNT] = {};
+        double phaseSeconds[PHASE_COUNT] = {};
+        HardwareCounters::Reading phaseHardware[PHASE_COUNT];   // only counted once HardwareCounters are enabled
+        uint64_t phaseAllocations[PHASE_COUNT] = {};             // only counted when Allocations::isTracking
+        uint64_t phaseBytes[PHASE_COUNT] = {};
+        uint64_t phasePeak[PHASE_COUNT] = {};                    // the highest of any one call
+
+        Counters& operator+=(const Counters& other);
+    };
+
+    /**
+     * @brief Times a phase from construction to destruction
+     */
+    class Timer {
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+        HardwareCounters::Reading startCounters;
+        bool counting;
+        Allocations::Scope heap;
+    public:
+        explicit Timer(Phase p);
+        ~Timer();
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+
+    /**
+     * @brief Get the calling thread's counters
+     *
+     * @return Counters&
+     */
+    static Counters& local();
+    /**
+     * @brief Get the counters of the calling thread and of every thread that has ended
+     *
+     * @return Counters
+     */
+    static Counters total();
+    /**
+     * @brief Zero the calling thread's counters and those of the threads that have ended
+     */
+    static void reset();
+    /**
+     * @brief Whether the engines were compiled with their counting hooks
+     */
+    static bool enabled();
+    static const char* phaseName(Phase phase);
+    /**
+     * @brief Describe counters as a human readable report
+     *
+     * @param counters
+     * @return std::string
+     */
+    static std::string report(const Counters& counters);
+};
+
+#ifdef WATER_SUPPLY_STATS
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_ADD(field, n) (Stats::local().field += (n))
+#define STATS_MAX(field, n) (Stats::local().field = std::max<uint64_t>(Stats::local().field, (n)))
+#define STATS_PHASE(phase) Stats::Timer STATS_CONCAT(statsTimer, __LINE__)(Stats::phase)
+#else
+#define STATS_ADD(field, n) ((void) 0)
+#define STATS_MAX(field, n) ((void) 0)
+#define STATS_PHASE(phase) ((void) 0)
+#endif
+
+#endif //WATER_SUPPLY_MANAGEMENT_STATS_H
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <unordered_map>
+#include "supply.h"
+
+namespace {
+
+/**
+ * @brief The pipes carrying water, each in the direction the water goes, grouped by the node it leaves
+ */
+struct FlowNetwork {
+    vector<int> first;          // the arcs leaving node v are [first[v], first[v + 1])
+    vector<int> to;
+    vector<long long> flow;
+
+    int getNodes() const {
+        return (int) first.size() - 1;
+    }
+};
+
+enum State : char { NEW, OPEN, DONE };
+
+/**
+ * @brief Cancel every cycle of the flow and return the nodes in topological order
+ *
+ * A depth-first search along the arcs with flow. An arc back to a node still
+ * on the stack closes a cycle: the least flow on it is taken off all its arcs,
+ * and the search backs up to the first arc that emptied. Arcs that are empty or
+ * lead to finished nodes are passed over for good, so the search is linear but
+ * for the cycles it walks.
+ *
+ * @param network
+ * @param cancelled Incremented for every cycle cancelled
+ * @return vector<int>
+ */
+vector<int> cancelCycles(FlowNetwork& network, int& cancelled) {
+    int n = network.getNodes();
+    vector<State> state(n, NEW);
+    vector<int> next(network.first.begin(), network.first.end() - 1);  // the next arc to try from each node
+    vector<int> parent(n, -1);      // the arc the search reached the node through
+    vector<int> position(n, -1);    // on the stack
+    vector<int> stack, order;
+    order.reserve(n);
+    for (int root = 0; root < n; root++) {
+        if (state[root] != NEW) continue;
+        state[root] = OPEN;
+        position[root] = 0;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            int v = stack.back();
+            int& a = next[v];
+            while (a < network.first[v + 1] && (network.flow[a] == 0 || state[network.to[a]] == DONE)) a++;
+            if (a == network.first[v + 1]) {
+                state[v] = DONE;
+                order.push_back(v);
+                stack.pop_back();
+                continue;
+            }
+            int w = network.to[a];
+            if (state[w] == NEW) {
+                state[w] = OPEN;
+                parent[w] = a;
+                position[w] = (int) stack.size();
+                stack.push_back(w);
+                continue;
+            }
+
+            // The stack from w up to v, and back to w through a, is a cycle
+            long long least = network.flow[a];
+            for (size_t i = position[w] + 1; i < stack.size(); i++) {
+                least = std::min(least, network.flow[parent[stack[i]]]);
+            }
+            network.flow[a] -= least;
+            size_t keep = stack.size();
+            for (size_t i = position[w] + 1; i < stack.size(); i++) {
+                network.flow[parent[stack[i]]] -= least;
+                if (network.flow[parent[stack[i]]] == 0 && keep == stack.size()) keep = i;
+            }
+            for (size_t i = keep; i < stack.size(); i++) {
+                state[stack[i]] = NEW;
+            }
+            stack.resize(keep);
+            cancelled++;
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/**
+ * @brief Add up the entries of the same reservoir, leaving the mix sorted by reservoir
+ */
+void merge(vector<SupplySource>& mix) {
+    std::sort(mix.begin(), mix.end(), [](const SupplySource& a, const SupplySource& b) { return a.reservoir < b.reservoir; });
+    size_t last = 0;
+    for (size_t i = 1; i < mix.size(); i++) {
+        if (mix[i].reservoir == mix[last].reservoir) mix[last].flow += mix[i].flow;
+        else mix[++last] = mix[i];
+    }
+    if (!mix.empty()) mix.resize(last + 1);
+}
+
+}
+
+SupplyMatrix traceSupply(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities) {
+    vector<Vertex*> vertices;
+    for (Vertex* v : g.getVertexSet()) {
+        if (v->getInfo() != "S" && v->getInfo() != "Si") vertices.push_back(v);
+    }
+    int n = (int) vertices.size();
+    unordered_map<const Vertex*, int> index;
+    for (int i = 0; i < n; i++) {
+        index[vertices[i]] = i;
+    }
+
+    // Every pipe with water on it, turned the way the water goes
+    struct Carried {
+        int from, to;
+        long long flow;
+    };
+    vector<Carried> carried;
+    vector<long long> inflow(n, 0), outflow(n, 0);
+    for (int i = 0; i < n; i++) {
+        for (Edge* e : vertices[i]->getAdj()) {
+            auto w = index.find(e->getDest());
+            if (w == index.end() || e->getFlow() == 0) continue;
+            long long flow = e->getFlow();
+            if (flow > 0) carried.push_back({i, w->second, flow});
+            else carried.push_back({w->second, i, -flow});
+            outflow[carried.back().from] += carried.back().flow;
+            inflow[carried.back().to] += carried.back().flow;
+        }
+    }
+    FlowNetwork network;
+    network.first.assign(n + 1, 0);
+    for (const Carried& c : carried) network.first[c.from + 1]++;
+    for (int v = 0; v < n; v++) network.first[v + 1] += network.first[v];
+    network.to.resize(carried.size());
+    network.flow.resize(carried.size());
+    vector<int> fill(network.first.begin(), network.first.end() - 1);
+    for (const Carried& c : carried) {
+        int a = fill[c.from]++;
+        network.to[a] = c.to;
+        network.flow[a] = c.flow;
+    }
+
+    SupplyMatrix result;
+    result.cities.resize(cities.size());
+    result.delivered.assign(reservoirs.size(), 0);
+    vector<int> order = cancelCycles(network, result.cyclesCancelled);
+
+    // Cancelling a cycle takes as much from what enters a node as from what leaves it, so the balances hold
+    vector<vector<SupplySource>> pending(n);    // the water each node has been sent, not yet merged
+    for (int v : order) {
+        Vertex* vertex = vertices[v];
+        vector<SupplySource> mix = std::move(pending[v]);
+        merge(mix);
+        // What leaves the node once the cycles are gone, and what a city keeps, is what its mix adds up to
+        long long through = 0;
+        for (int a = network.first[v]; a < network.first[v + 1]; a++) through += network.flow[a];
+        long long kept = 0;
+        if (vertex->isType(VertexType::RESERVOIR)) {
+            long long supply = outflow[v] - inflow[v];
+            if (supply > 0) {
+                auto at = std::lower_bound(mix.begin(), mix.end(), vertex->getId() - 1,
+                                           [](const SupplySource& s, int r) { return s.reservoir < r; });
+                if (at != mix.end() && at->reservoir == vertex->getId() - 1) at->flow += (double) supply;
+                else mix.insert(at, {vertex->getId() - 1, (double) supply});
+            }
+        }
+        if (vertex->isType(VertexType::CITY)) {
+            kept = std::max(0LL, inflow[v] - outflow[v]);
+            through += kept;
+        }
+        if (through <= 0 || mix.empty()) continue;
+
+        if (kept > 0) {
+            double share = (double) kept / (double) through;
+            vector<SupplySource>& sources = result.cities[vertex->getId() - 1];
+            for (const SupplySource& s : mix) {
+                sources.push_back({s.reservoir, s.flow * share});
+                result.delivered[s.reservoir] += s.flow * share;
+            }
+        }
+        for (int a = network.first[v]; a < network.first[v + 1]; a++) {
+            if (network.flow[a] == 0) continue;
+            double share = (double) network.flow[a] / (double) through;
+            vector<SupplySource>& sent = pending[network.to[a]];
+            for (const SupplySource& s : mix) {
+                sent.push_back({s.reservoir, s.flow * share});
+            }
+        }
+    }
+    return result;
+}
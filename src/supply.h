@@ -0,0 +1,49 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_SUPPLY_H
+#define WATER_SUPPLY_MANAGEMENT_SUPPLY_H
+
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief Water of one reservoir reaching a city
+ */
+struct SupplySource {
+    int reservoir;  // id - 1
+    double flow;
+};
+
+/**
+ * @brief Which reservoirs feed each city in a flow, and how much, see traceSupply
+ */
+struct SupplyMatrix {
+    vector<vector<SupplySource>> cities;    // by city id, the reservoirs that reach it by id
+    vector<double> delivered;               // by reservoir id, its water reaching any city
+    int cyclesCancelled = 0;
+};
+
+/**
+ * @brief Split the water each city receives in the graph's current flow between the reservoirs it comes from
+ *
+ * Vertex::getInflow tells how much reaches a city, not from where. The flow
+ * on the pipes is first made acyclic: a depth-first search over the pipes
+ * that carry water cancels every cycle it closes (water going round a loop
+ * reaches no city) and leaves the vertices in topological order. Then, in
+ * that order, every vertex passes the mix of reservoirs' water it receives
+ * on to its pipes in proportion to what each of them carries, and a city
+ * keeps its share of the mix. Both passes are linear in the pipes, but for
+ * the length of the cycles cancelled.
+ *
+ * Closing a reservoir's pipes can cost the network no more than the water
+ * they carry: what it delivers, and what other reservoirs send through it.
+ *
+ * The flow is read as it is, with the super source and sink ignored if
+ * attached; the graph is not changed.
+ *
+ * @param g A graph holding a flow, such as one Actions::maxFlowAllCities left
+ * @param reservoirs
+ * @param cities
+ * @return SupplyMatrix
+ */
+SupplyMatrix traceSupply(const Graph& g, const vector<Reservoir>& reservoirs, const vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_SUPPLY_H
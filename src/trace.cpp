@@ -0,0 +1,114 @@
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <mutex>
+#include <vector>
+#include "trace.h"
+#include "json.h"
+
+namespace {
+
+struct Event {
+    const char* name;
+    std::string detail;
+    int64_t start; // nanoseconds since the trace started
+    int64_t duration;
+};
+
+struct ThreadBuffer {
+    int tid;
+    std::string name;
+    std::vector<Event> events;
+};
+
+std::atomic<bool> active(false);
+std::chrono::steady_clock::time_point epoch;
+
+// Buffers are only added to the list, under the mutex, when a thread records
+// its first event; after that each thread appends to its own buffer alone.
+std::mutex registryMutex;
+std::list<ThreadBuffer> buffers;
+thread_local ThreadBuffer* threadBuffer = nullptr;
+
+ThreadBuffer& localBuffer() {
+    if (threadBuffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers.push_back({(int) buffers.size() + 1, "", {}});
+        threadBuffer = &buffers.back();
+    }
+    return *threadBuffer;
+}
+
+int64_t sinceEpoch(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - epoch).count();
+}
+
+}
+
+Trace::Scope::Scope(const char* name_, std::string detail_): name(name_), active(Trace::isActive()) {
+    if (active) {
+        detail = std::move(detail_);
+        begin = std::chrono::steady_clock::now();
+    }
+}
+
+Trace::Scope::~Scope() {
+    if (!active || !Trace::isActive()) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    localBuffer().events.push_back({name, std::move(detail), sinceEpoch(begin), sinceEpoch(end) - sinceEpoch(begin)});
+}
+
+void Trace::start() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : buffers) {
+        buffer.events.clear();
+    }
+    epoch = std::chrono::steady_clock::now();
+    active = true;
+}
+
+bool Trace::isActive() {
+    return active.load(std::memory_order_relaxed);
+}
+
+void Trace::nameThread(const std::string& name) {
+    if (isActive()) {
+        localBuffer().name = name;
+    }
+}
+
+bool Trace::write(const std::string& path, std::string& error) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Water_Supply_Management\"}}";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& buffer : buffers) {
+        std::string name = buffer.name.empty() ? "thread " + std::to_string(buffer.tid) : buffer.name;
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.tid
+            << ",\"args\":{\"name\":" << jsonString(name) << "}}";
+        for (const auto& e : buffer.events) {
+            out << ",\n{\"name\":" << jsonString(e.name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.tid
+                << ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << e.duration / 1000.0;
+            if (!e.detail.empty()) {
+                out << ",\"args\":{\"detail\":" << jsonString(e.detail) << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
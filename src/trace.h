@@ -0,0 +1,63 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_TRACE_H
+#define WATER_SUPPLY_MANAGEMENT_TRACE_H
+
+#include <chrono>
+#include <string>
+
+/**
+ * @brief Timeline of what each thread did, in Chrome trace-event format
+ *
+ * Scopes record one complete event each into a buffer owned by the thread
+ * that opened them, so recording never takes a lock. The events are written
+ * out as JSON that Perfetto (ui.perfetto.dev) or chrome://tracing open
+ * offline, one track per thread.
+ *
+ * Nothing is recorded until start is called.
+ */
+class Trace {
+public:
+    /**
+     * @brief Records the time between its construction and destruction as an event
+     */
+    class Scope {
+        const char* name;
+        std::string detail;
+        std::chrono::steady_clock::time_point begin;
+        bool active;
+    public:
+        /**
+         * @brief Open a scope
+         *
+         * @param name A string literal naming what is being done
+         * @param detail What it is done to, shown as the event's argument
+         */
+        explicit Scope(const char* name, std::string detail = "");
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /**
+     * @brief Start recording, discarding anything recorded before
+     */
+    static void start();
+    static bool isActive();
+    /**
+     * @brief Name the calling thread's track
+     *
+     * @param name
+     */
+    static void nameThread(const std::string& name);
+    /**
+     * @brief Write every recorded event as Chrome trace-event JSON
+     *
+     * The other threads that recorded events must have finished or be idle.
+     *
+     * @param path
+     * @param error Set when the file cannot be written
+     * @return false if the file cannot be written
+     */
+    static bool write(const std::string& path, std::string& error);
+};
+
+#endif //WATER_SUPPLY_MANAGEMENT_TRACE_H
@@ -0,0 +1,213 @@
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+#include "verify.h"
+
+namespace {
+
+const size_t MAX_VIOLATIONS = 10;
+
+void violation(FlowCheck& check, const string& what) {
+    if (check.violations.size() < MAX_VIOLATIONS) {
+        check.violations.push_back(what);
+    }
+}
+
+template <typename F>
+bool isSuper(const BasicVertex<F>* v) {
+    const string& info = v->getInfo();
+    return info == "S" || info == "Si";
+}
+
+/**
+ * @brief Whether a is more than b, beyond the rounding FlowTraits tolerates
+ */
+template <typename F>
+bool exceeds(F a, F b) {
+    return FlowTraits<F>::positive(a - b);
+}
+
+template <typename F>
+string show(F value) {
+    ostringstream out;
+    out << FlowTraits<F>::toDouble(value);
+    return out.str();
+}
+
+}
+
+template <typename F>
+FlowCheck verifyFlow(const BasicGraph<F>& g, const vector<Reservoir>& reservoirs, const vector<Station>& stations,
+                     const vector<City>& cities) {
+    using Vertex = BasicVertex<F>;
+    using Edge = BasicEdge<F>;
+    FlowCheck check;
+    vector<Vertex*> vertices = g.getVertexSet();
+    unordered_map<const Vertex*, size_t> index;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        index[vertices[i]] = i;
+    }
+    unordered_map<string, F> limits;
+    for (const auto& r : reservoirs) {
+        limits[r.getCode()] = FlowTraits<F>::fromQuantity(r.getMaxDelivery());
+    }
+    for (const auto& s : stations) {
+        if (s.isLimited()) limits[s.getCode()] = FlowTraits<F>::fromQuantity(s.getCapacity());
+    }
+    for (const auto& c : cities) {
+        limits[c.getCode()] = FlowTraits<F>::fromQuantity(c.getDemand());   // truncated for integers, as Actions does
+    }
+    const F zero = F();
+
+    // Feasibility: pipe capacities, then what each vertex sends out net of what it receives
+    size_t n = vertices.size();
+    vector<F> net(n, zero), inflow(n, zero), limit(n, zero);
+    vector<bool> limited(n, false);
+    for (size_t i = 0; i < n; i++) {
+        Vertex* v = vertices[i];
+        if (isSuper(v)) continue;
+        auto it = limits.find(v->getInfo());
+        if (it != limits.end()) {
+            limit[i] = it->second;
+            limited[i] = v->isType(VertexType::STATION);
+        }
+        else if (!v->isType(VertexType::STATION)) {
+            check.feasible = false;
+            violation(check, v->getInfo() + " is not a known reservoir or city");
+            continue;
+        }
+        for (Edge* e : v->getAdj()) {
+            if (isSuper(e->getDest())) continue;
+            F least = e->isUndirected() ? zero - e->getCapacity() : zero;
+            if (exceeds(least, e->getFlow()) || exceeds(e->getFlow(), e->getCapacity())) {
+                check.feasible = false;
+                violation(check, "pipe " + v->getInfo() + "-" + e->getDest()->getInfo() + " carries " + show(e->getFlow())
+                                 + " with capacity " + show(e->getCapacity()));
+            }
+            size_t j = index[e->getDest()];
+            net[i] += e->getFlow();
+            net[j] -= e->getFlow();
+            if (e->getFlow() > zero) inflow[j] += e->getFlow();
+            else inflow[i] -= e->getFlow();
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        Vertex* v = vertices[i];
+        if (isSuper(v)) continue;
+        if (v->isType(VertexType::STATION) && (exceeds(net[i], zero) || exceeds(zero, net[i]))) {
+            check.feasible = false;
+            violation(check, "station " + v->getInfo() + " sends out " + show(net[i]) + " more than it receives");
+        }
+        if (limited[i] && exceeds(inflow[i], limit[i])) {
+            check.feasible = false;
+            violation(check, "station " + v->getInfo() + " pumps " + show(inflow[i]) + " of at most " + show(limit[i]));
+        }
+        if (v->isType(VertexType::RESERVOIR) && (exceeds(zero, net[i]) || exceeds(net[i], limit[i]))) {
+            check.feasible = false;
+            violation(check, "reservoir " + v->getInfo() + " delivers " + show(net[i]) + " of at most " + show(limit[i]));
+        }
+        if (v->isType(VertexType::CITY)) {
+            F received = zero - net[i];
+            if (exceeds(zero, received) || exceeds(received, limit[i])) {
+                check.feasible = false;
+                violation(check, "city " + v->getInfo() + " receives " + show(received) + " with a demand of " + show(limit[i]));
+            }
+            check.value += FlowTraits<F>::toDouble(received);
+        }
+    }
+    if (!check.feasible) {
+        return check;
+    }
+
+    // Optimality: search the residual network from the reservoirs with supply to spare. A limited
+    // station has an in side, where flow arrives, and an out side joined to it by its limit; the
+    // sides of any other vertex are one.
+    vector<bool> reachedIn(n, false), reachedOut(n, false);
+    queue<pair<size_t, bool>> q;
+    auto reach = [&](size_t j, bool out) {
+        if (isSuper(vertices[j])) return;
+        if (!limited[j]) {
+            if (reachedIn[j]) return;
+            reachedIn[j] = reachedOut[j] = true;
+        }
+        else {
+            vector<bool>::reference seen = out ? reachedOut[j] : reachedIn[j];
+            if (seen) return;
+            seen = true;
+        }
+        q.push({j, out});
+    };
+    for (size_t i = 0; i < n; i++) {
+        if (!isSuper(vertices[i]) && vertices[i]->isType(VertexType::RESERVOIR) && exceeds(limit[i], net[i])) {
+            reach(i, false);
+        }
+    }
+    check.maximum = true;
+    while (!q.empty()) {
+        size_t i = q.front().first;
+        bool out = q.front().second;
+        q.pop();
+        Vertex* u = vertices[i];
+        if (u->isType(VertexType::CITY) && exceeds(limit[i], zero - net[i])) {
+            check.maximum = false;
+            violation(check, "more can reach city " + u->getInfo() + ", whose demand is not met");
+        }
+        bool whole = !limited[i];
+        if (!whole && !out && exceeds(limit[i], inflow[i])) reach(i, true);
+        if (!whole && out && exceeds(inflow[i], zero)) reach(i, false);
+        // Sending more along an edge leaves from the out side, cancelling flow that comes in from the in side
+        auto cross = [&](const Edge* e, const Vertex* w) {
+            if (isSuper(w)) return;
+            F flow = u == e->getSource() ? e->getFlow() : zero - e->getFlow();   // flow running from u to w
+            bool forward = u == e->getSource() || e->isUndirected();
+            F more = forward ? e->getCapacity() - (flow > zero ? flow : zero) : zero;
+            F back = flow < zero ? zero - flow : zero;
+            if ((whole || out) && exceeds(more, zero)) reach(index[w], false);
+            if ((whole || !out) && exceeds(back, zero)) reach(index[w], true);
+        };
+        for (Edge* e : u->getAdj()) cross(e, e->getDest());
+        for (Edge* e : u->getPath()) cross(e, e->getSource());
+    }
+    if (!check.maximum) {
+        return check;
+    }
+
+    // The certificate: reservoirs left out, limits and pipes leaving the reached side, and reached cities
+    F cut = zero;
+    for (size_t i = 0; i < n; i++) {
+        Vertex* v = vertices[i];
+        if (isSuper(v)) continue;
+        if (reachedIn[i] || reachedOut[i]) {
+            check.sourceSide.push_back(v->getInfo());
+        }
+        if (v->isType(VertexType::CITY) && reachedIn[i]) cut += limit[i];
+        if (v->isType(VertexType::RESERVOIR) && !reachedIn[i]) cut += limit[i];
+        if (limited[i] && reachedIn[i] && !reachedOut[i]) cut += limit[i];
+        for (Edge* e : v->getAdj()) {
+            const Vertex* w = e->getDest();
+            if (isSuper(w)) continue;
+            size_t j = index[w];
+            if (reachedOut[i] && !reachedIn[j]) cut += e->getCapacity();
+            if (e->isUndirected() && reachedOut[j] && !reachedIn[i]) cut += e->getCapacity();
+        }
+    }
+    check.cutCapacity = FlowTraits<F>::toDouble(cut);
+    F value = zero;
+    for (size_t i = 0; i < n; i++) {
+        if (!isSuper(vertices[i]) && vertices[i]->isType(VertexType::CITY)) value -= net[i];
+    }
+    if (exceeds(cut, value) || exceeds(value, cut)) {
+        check.maximum = false;
+        violation(check, "the cut has capacity " + show(cut) + " but the flow is " + show(value));
+    }
+    return check;
+}
+
+template FlowCheck verifyFlow(const BasicGraph<int>&, const vector<Reservoir>&, const vector<Station>&,
+                                const vector<City>&);
+template FlowCheck verifyFlow(const BasicGraph<int64_t>&, const vector<Reservoir>&, const vector<Station>&,
+                                const vector<City>&);
+template FlowCheck verifyFlow(const BasicGraph<double>&, const vector<Reservoir>&, const vector<Station>&,
+                                const vector<City>&);
+template FlowCheck verifyFlow(const BasicGraph<Milli>&, const vector<Reservoir>&, const vector<Station>&,
+                                const vector<City>&);
@@ -0,0 +1,49 @@
+#ifndef WATER_SUPPLY_MANAGEMENT_VERIFY_H
+#define WATER_SUPPLY_MANAGEMENT_VERIFY_H
+
+#include <string>
+#include <vector>
+#include "graph.h"
+
+/**
+ * @brief The verdict on a flow found by a solver, with its proof
+ *
+ * A flow is feasible when every pipe carries at most its capacity, only its
+ * own way unless it is bidirectional, every station passes on all it receives
+ * and pumps at most its capacity, every reservoir sends out at most its
+ * maximum delivery and every city receives at most its demand. A feasible
+ * flow is maximum when no vertex from which a city with unmet demand could be
+ * reached has spare supply. The vertices reachable in the residual network
+ * are then one side of a cut whose capacity equals the flow's value, which
+ * certifies (max-flow min-cut) that no solver can deliver more.
+ */
+struct FlowCheck {
+    bool feasible = true;
+    bool maximum = false;
+    double value = 0;             // total flow reaching the cities
+    double cutCapacity = 0;       // capacity of the certificate cut, when maximum
+    vector<string> violations;    // why the flow is infeasible or not maximum, the first few only
+    vector<string> sourceSide;    // the certificate: vertices on the source side of the minimum cut
+};
+
+/**
+ * @brief Check the flow currently on a network's edges, in time linear in its size
+ *
+ * Compiled for every capacity type of the engine. With double, differences
+ * within FlowTraits<double>::EPSILON are tolerated.
+ *
+ * The graph is the network as built by Graph::buildGraph. The super source
+ * "S" and super sink "Si" may be attached or not: edges touching them are
+ * ignored and the reservoir and city limits come from the entities instead.
+ *
+ * @param g
+ * @param reservoirs Their maximum deliveries bound what leaves each reservoir
+ * @param stations Their capacities, where they have one, bound what passes through each station
+ * @param cities Their demands bound what reaches each city
+ * @return FlowCheck
+ */
+template <typename F>
+FlowCheck verifyFlow(const BasicGraph<F>& g, const vector<Reservoir>& reservoirs, const vector<Station>& stations,
+                     const vector<City>& cities);
+
+#endif //WATER_SUPPLY_MANAGEMENT_VERIFY_H
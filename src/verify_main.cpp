@@ -0,0 +1,599 @@
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include "Actions.h"
+#include "balance.h"
+#include "deliverable.h"
+#include "flowmodel.h"
+#include "generator.h"
+#include "parametric.h"
+#include "parse.h"
+#include "reliability.h"
+#include "simulation.h"
+#include "supply.h"
+#include "verify.h"
+
+// Runs every max-flow engine on the bundled dataset and on generated networks,
+// checks each flow it leaves with verifyFlow and compares the totals. An engine
+// is fit to replace another only once this passes on it.
+
+namespace {
+
+struct Options {
+    std::string dataset = "../Dataset";
+    std::vector<double> scales = {0.5, 1, 2};
+    std::vector<Topology> topologies = {Topology::GRID, Topology::TREE, Topology::SCALE_FREE, Topology::CLUSTERS};
+    int seeds = 3;
+    int outages = 20;
+    double limitedStations = 0.25;
+    bool verbose = false;
+};
+
+/**
+ * @brief A max-flow engine, run on a freshly built network
+ *
+ * Exact engines must find a maximum flow; the others are only required to
+ * find a feasible one, and are reported when they fall short.
+ */
+struct Solver {
+    std::string name;
+    bool exact;
+    std::function<void(Graph&, const Network&)> run;
+};
+
+template <typename F>
+void attachSuperNodes(BasicGraph<F>& g, const Network& network) {
+    g.addVertex("Si", VertexType::CITY, 20000);
+    g.addVertex("S", VertexType::RESERVOIR, 10000);
+    for (const auto& c : network.cities)
+        g.addEdge(c.getCode(), "Si", 1, FlowTraits<F>::fromQuantity(c.getDemand()));
+    for (const auto& r : network.reservoirs)
+        g.addEdge("S", r.getCode(), 1, FlowTraits<F>::fromQuantity(r.getMaxDelivery()));
+}
+
+std::vector<Solver> solvers() {
+    return {
+        {"edmonds-karp", true, [](Graph& g, const Network& network) {
+            attachSuperNodes(g, network);
+            g.edmondsKarp("S", "Si");
+        }},
+        {"actions", true, [](Graph& g, const Network& network) {
+            Actions a(network.reservoirs, network.stations, network.cities, network.pipes);
+            a.maxFlowAllCities(g);
+        }},
+        {"balanced", true, [](Graph& g, const Network& network) {
+            balanceFlows(g, network.reservoirs, network.cities);
+        }},
+        {"ford-fulkerson", false, [](Graph& g, const Network& network) {
+            attachSuperNodes(g, network);
+            g.fordFulkerson(g, "S", "Si");
+        }},
+    };
+}
+
+std::string describe(const FlowCheck& check) {
+    std::ostringstream out;
+    if (!check.feasible) out << "infeasible";
+    else if (!check.maximum) out << "not maximum";
+    else out << "maximum, cut of " << check.sourceSide.size() << " vertices";
+    for (const auto& v : check.violations) out << "\n      " << v;
+    return out.str();
+}
+
+/**
+ * @brief Print a check's ok or FAIL line, followed by its problems
+ *
+ * @param name
+ * @param ok
+ * @param summary What the check found, after its name
+ * @param problems One indented line each, as "\n      " followed by the problem
+ * @return int 0, or 1 if the check failed
+ */
+int report(const std::string& name, bool ok, const std::string& summary, const std::ostringstream& problems) {
+    std::cout << "  " << (ok ? "ok    " : "FAIL  ") << name << ": " << summary << problems.str() << "\n";
+    return ok ? 0 : 1;
+}
+
+template <typename F = int>
+BasicGraph<F> build(const Network& network) {
+    BasicGraph<F> g;
+    return g.buildGraph(network.reservoirs, network.stations, network.pipes, network.cities);
+}
+
+/**
+ * @brief Solve a network with Edmonds-Karp on capacities of type F and check the flow
+ */
+template <typename F>
+FlowCheck solveAs(const Network& network) {
+    BasicGraph<F> g = build<F>(network);
+    attachSuperNodes(g, network);
+    g.edmondsKarp("S", "Si");
+    return verifyFlow(g, network.reservoirs, network.stations, network.cities);
+}
+
+/**
+ * @brief Check the engine compiled for the other capacity types against the int solve
+ *
+ * int64 must reach the same total. double and Milli keep the fractional part
+ * of demands, so they may deliver a little more than int, and must agree with
+ * each other to within Milli's resolution per city.
+ *
+ * @return int The number of failures
+ */
+int verifyCapacityTypes(const Network& network, long long expected) {
+    int failures = 0;
+    auto report = [&](const char* type, const FlowCheck& check, bool agrees) {
+        bool ok = check.feasible && check.maximum && agrees;
+        std::cout << "  " << (ok ? "ok    " : "FAIL  ") << "edmonds-karp<" << type << "> " << check.value << ": "
+                  << describe(check) << "\n";
+        if (!ok) failures++;
+    };
+    FlowCheck wide = solveAs<int64_t>(network);
+    report(FlowTraits<int64_t>::NAME, wide, expected < 0 || wide.value == expected);
+    FlowCheck real = solveAs<double>(network);
+    FlowCheck fixed = solveAs<Milli>(network);
+    double resolution = (double) network.cities.size() / Milli::SCALE;
+    report(FlowTraits<double>::NAME, real, expected < 0 || real.value >= expected);
+    report(FlowTraits<Milli>::NAME, fixed, std::fabs(fixed.value - real.value) <= resolution);
+    return failures;
+}
+
+/**
+ * @brief Whether the graph's running slack tally matches a recount over its pipes
+ *
+ * The tally is kept up to date edge by edge as the engines change flows and
+ * capacities; with int capacities its sums are exact, so they must agree to the unit.
+ */
+bool tallyAgrees(const Graph& g, std::string& why) {
+    SlackTally<int> tally = g.getSlackTally();
+    size_t pipes = 0, saturated = 0;
+    long double sum = 0, squares = 0;
+    int max = 0;
+    for (Vertex* v : g.getVertexSet()) {
+        if (v->getInfo() == "S" || v->getInfo() == "Si") continue;
+        for (Edge* e : v->getAdj()) {
+            if (e->getDest()->getInfo() == "S" || e->getDest()->getInfo() == "Si") continue;
+            int slack = e->getCapacity() - e->getCarried();
+            if (pipes == 0 || slack > max) max = slack;
+            pipes++;
+            sum += slack;
+            squares += (long double) slack * slack;
+            if (slack <= 0) saturated++;
+        }
+    }
+    if (tally.getPipes() == pipes && tally.getSum() == sum && tally.getSumOfSquares() == squares
+        && tally.getMax() == max && tally.getSaturated() == saturated) {
+        return true;
+    }
+    std::ostringstream out;
+    out << "tally of " << tally.getPipes() << " pipes, sum " << (double) tally.getSum() << ", max " << tally.getMax()
+        << ", " << tally.getSaturated() << " saturated; recount of " << pipes << ", sum " << (double) sum << ", max "
+        << max << ", " << saturated << " saturated";
+    why = out.str();
+    return false;
+}
+
+/**
+ * @brief Check sweepDemands against cold solves with every demand multiplied by 1, 2 and 3
+ *
+ * At each factor the maximum flow must be the one read off the breakpoints,
+ * and every city whose deficit only starts at that factor or later must be
+ * served in full, whichever maximum flow the cold solve found.
+ *
+ * @return int The number of failures
+ */
+int verifySweep(const Network& network) {
+    Graph g = build(network);
+    DemandSweep sweep = sweepDemands(g, network.reservoirs, network.cities);
+    std::ostringstream problems;
+    for (int factor = 1; factor <= 3; factor++) {
+        Network scaled = network;
+        for (auto& c : scaled.cities) {
+            c = City(c.getName(), c.getId(), c.getCode(), (float) ((int) c.getDemand() * factor), c.getPopulation());
+        }
+        Graph h = build(scaled);
+        Actions a(scaled.reservoirs, scaled.stations, scaled.cities, scaled.pipes);
+        vector<int> flows = a.maxFlowAllCities(h);
+        long long total = std::accumulate(flows.begin(), flows.end(), 0LL);
+        if (std::fabs(sweep.flowAt(factor) - (double) total) > 1e-6 * std::max(1.0, (double) total)) {
+            problems << "\n      at " << factor << "x the breakpoints give " << sweep.flowAt(factor) << ", a cold solve " << total;
+        }
+        for (size_t i = 0; i < scaled.cities.size(); i++) {
+            if (sweep.deficitFrom[i] >= factor && flows[i] < (int) scaled.cities[i].getDemand()) {
+                problems << "\n      at " << factor << "x " << scaled.cities[i].getCode() << " gets " << flows[i]
+                         << " of " << (int) scaled.cities[i].getDemand() << ", its deficit should start at "
+                         << sweep.deficitFrom[i] << "x";
+            }
+        }
+    }
+    return report("demand sweep", problems.str().empty(), std::to_string(sweep.breakpoints.size()) + " breakpoints in "
+                  + std::to_string(sweep.solves) + " solves, cold solves at 1x, 2x and 3x agree", problems);
+}
+
+/**
+ * @brief Compare every city's own maximum flow with Edmonds-Karp to that city alone
+ *
+ * Runs on 1 and 3 threads must agree for every city, and a few cities, spread
+ * over the network, are solved again with the graph engine and only their
+ * edge to the super sink.
+ *
+ * @return int The number of failures
+ */
+int verifyDeliverable(const Network& network) {
+    Graph g = build(network);
+    vector<long long> flows = maxDeliverable(g, network.reservoirs, network.cities, 1);
+    vector<long long> parallel = maxDeliverable(g, network.reservoirs, network.cities, 3);
+    std::ostringstream problems;
+    for (size_t i = 0; i < network.cities.size(); i++) {
+        if (parallel[i] != flows[i]) {
+            problems << "\n      " << network.cities[i].getCode() << ": " << flows[i] << " on 1 thread, "
+                     << parallel[i] << " on 3";
+        }
+    }
+    int total = 0;
+    for (const auto& r : network.reservoirs) total += r.getMaxDelivery();
+    size_t step = std::max<size_t>(1, network.cities.size() / 4);
+    for (size_t i = 0; i < network.cities.size(); i += step) {
+        const std::string& code = network.cities[i].getCode();
+        Graph h = build(network);
+        h.addVertex("Si", VertexType::CITY, 20000);
+        h.addVertex("S", VertexType::RESERVOIR, 10000);
+        h.addEdge(code, "Si", 1, total + 1);
+        for (const auto& r : network.reservoirs) h.addEdge("S", r.getCode(), 1, r.getMaxDelivery());
+        h.edmondsKarp("S", "Si");
+        long long expected = h.findEdge(code, "Si")->getFlow();
+        if (flows[i] != expected) {
+            problems << "\n      " << code << ": " << flows[i] << ", Edmonds-Karp to it alone " << expected;
+        }
+        long long single = maxDeliverableTo(g, network.reservoirs, network.cities, (int) i);
+        if (single != flows[i]) {
+            problems << "\n      " << code << ": " << flows[i] << ", solved on its own " << single;
+        }
+    }
+    return report("deliverable", problems.str().empty(), std::to_string(network.cities.size())
+                  + " cities agree on 1 and 3 threads and with Edmonds-Karp", problems);
+}
+
+/**
+ * @brief Compare a warm-started time series with solves from zero, hour by hour
+ *
+ * A day of generated profiles, with every other reservoir halved from noon
+ * on, so that deliveries shrink under their flows as well as demands.
+ *
+ * @return int The number of failures
+ */
+int verifySimulation(const Network& network, uint64_t seed) {
+    const int hours = 24;
+    std::vector<ProfileChange> changes = generateProfiles(network, hours, seed);
+    for (size_t i = 0; i < network.reservoirs.size(); i += 2) {
+        const Reservoir& r = network.reservoirs[i];
+        changes.push_back({hours / 2, r.getCode(), (double) (r.getMaxDelivery() / 2)});
+    }
+    Simulation warm(network.reservoirs, network.stations, network.pipes, network.cities);
+    Simulation cold(network.reservoirs, network.stations, network.pipes, network.cities);
+    std::string error;
+    if (!warm.addProfile(changes, error) || !cold.addProfile(changes, error)) {
+        return report("simulation", false, error, std::ostringstream());
+    }
+    cold.setWarmStart(false);
+    std::ostringstream problems;
+    int agreed = 0;
+    vector<int> warmFlows, coldFlows;
+    for (int hour = 0; hour < hours; hour++) {
+        warm.step(warmFlows);
+        cold.step(coldFlows);
+        long long warmTotal = std::accumulate(warmFlows.begin(), warmFlows.end(), 0LL);
+        long long coldTotal = std::accumulate(coldFlows.begin(), coldFlows.end(), 0LL);
+        if (warmTotal == coldTotal) agreed++;
+        else problems << "\n      hour " << hour << ": warm start " << warmTotal << ", cold " << coldTotal;
+    }
+    return report("simulation", agreed == hours, std::to_string(agreed) + " of " + std::to_string(hours)
+                  + " warm-started hours agree with a cold solve", problems);
+}
+
+/**
+ * @brief Check that a reliability estimate does not depend on the number of threads
+ *
+ * Failures can only take flow away, so the expected total deficit cannot be
+ * below the baseline's either (a city's can, the flow may be split differently).
+ *
+ * @return int The number of failures
+ */
+int verifyReliability(const Network& network, uint64_t seed) {
+    ReliabilityOptions options;
+    options.pipeFailure = options.stationFailure = options.reservoirFailure = 0.02;
+    options.minSamples = options.maxSamples = 200;
+    options.seed = seed;
+    ReliabilityEstimate one = estimateReliability(network.reservoirs, network.stations, network.pipes, network.cities, options);
+    options.threads = 3;
+    ReliabilityEstimate three = estimateReliability(network.reservoirs, network.stations, network.pipes, network.cities, options);
+    std::ostringstream problems;
+    if (one.expectedDeficit != three.expectedDeficit || one.deficitHalfWidth != three.deficitHalfWidth || one.solves != three.solves) {
+        problems << "\n      1 thread expects " << one.expectedDeficit << " +- " << one.deficitHalfWidth << ", 3 threads "
+                 << three.expectedDeficit << " +- " << three.deficitHalfWidth;
+    }
+    long long baseline = 0;
+    for (size_t i = 0; i < network.cities.size(); i++) {
+        const CityReliability& a = one.cities[i];
+        const CityReliability& b = three.cities[i];
+        if (a.expectedDeficit != b.expectedDeficit || a.shortProbability != b.shortProbability) {
+            problems << "\n      " << network.cities[i].getCode() << " differs between 1 and 3 threads";
+        }
+        baseline += a.baselineDeficit;
+    }
+    if (one.expectedDeficit < (double) baseline) {
+        problems << "\n      the expected total deficit " << one.expectedDeficit << " is below the baseline's " << baseline;
+    }
+    return report("reliability", problems.str().empty(), std::to_string(one.samples) + " samples ("
+                  + std::to_string(one.solves) + " solved) agree on 1 and 3 threads", problems);
+}
+
+/**
+ * @brief Close the edges of a reservoir, a station or a pipe written "A-B", as the analyses do
+ */
+void closeComponent(Graph& g, const Network& network, const std::string& component) {
+    size_t dash = component.find('-');
+    if (dash == std::string::npos) {
+        for (auto e : g.getAdjacentEdges(component)) e->setCapacity(0);
+        return;
+    }
+    std::string a = component.substr(0, dash), b = component.substr(dash + 1);
+    for (const auto& pipe : network.pipes) {
+        if (pipe.getPointA() != a || pipe.getPointB() != b) continue;
+        if (Edge* e = g.findEdge(a, b)) e->setCapacity(0);
+        return;
+    }
+}
+
+/**
+ * @brief Check that the reservoirs traced to each city account for its flow
+ *
+ * On the maximum flow and on its balanced spread, every city's sources must
+ * add up to what it receives and no reservoir may deliver more than it has.
+ * Then a few reservoirs are closed and solved again from zero: the network
+ * must not lose more than the water they were traced to deliver, plus what
+ * passed through them.
+ *
+ * @return int The number of failures
+ */
+int verifySupply(const Network& network) {
+    Actions a(network.reservoirs, network.stations, network.cities, network.pipes);
+    Graph g = build(network);
+    vector<int> flows = a.maxFlowAllCities(g);
+    long long total = std::accumulate(flows.begin(), flows.end(), 0LL);
+    std::ostringstream problems;
+    int cycles = 0;
+    auto check = [&](const Graph& traced, const SupplyMatrix& supply, const char* flow) {
+        cycles += supply.cyclesCancelled;
+        for (size_t i = 0; i < network.cities.size(); i++) {
+            double sum = 0;
+            for (const SupplySource& s : supply.cities[i]) sum += s.flow;
+            double inflow = traced.findVertex(network.cities[i].getCode())->getInflow();
+            if (std::abs(sum - inflow) > 1e-6 * std::max(1.0, inflow)) {
+                problems << "\n      " << flow << ": " << network.cities[i].getCode() << " receives " << inflow
+                         << ", its sources add up to " << sum;
+            }
+        }
+        for (size_t r = 0; r < network.reservoirs.size(); r++) {
+            if (supply.delivered[r] > network.reservoirs[r].getMaxDelivery() * (1 + 1e-9)) {
+                problems << "\n      " << flow << ": " << network.reservoirs[r].getCode() << " delivers "
+                         << supply.delivered[r] << " of at most " << network.reservoirs[r].getMaxDelivery();
+            }
+        }
+    };
+    SupplyMatrix supply = a.supplySources(g);
+    check(g, supply, "maximum flow");
+    Graph balanced = build(network);
+    balanceFlows(balanced, network.reservoirs, network.cities);
+    check(balanced, traceSupply(balanced, network.reservoirs, network.cities), "balanced flow");
+
+    size_t step = std::max<size_t>(1, network.reservoirs.size() / 4);
+    for (size_t r = 0; r < network.reservoirs.size(); r += step) {
+        const std::string& code = network.reservoirs[r].getCode();
+        Graph h = build(network);
+        closeComponent(h, network, code);
+        vector<int> without = a.maxFlowAllCities(h);
+        long long lost = total - std::accumulate(without.begin(), without.end(), 0LL);
+        double carried = supply.delivered[r] + g.findVertex(code)->getInflow();
+        if ((double) lost > carried + 1e-6 * std::max(1.0, carried)) {
+            problems << "\n      without " << code << " the network loses " << lost << ", more than the "
+                     << carried << " its pipes carry";
+        }
+    }
+    return report("supply", problems.str().empty(), std::to_string(network.cities.size())
+                  + " cities' sources add up to their flows (" + std::to_string(cycles)
+                  + " cycles cancelled), reservoirs bound their outages", problems);
+}
+
+/**
+ * @brief Check every engine on one network, then the warm-started FlowModel against cold solves of random outages
+ *
+ * @return int The number of failures of exact engines
+ */
+int verifyNetwork(const std::string& name, const Network& network, const Options& options, uint64_t seed) {
+    int failures = 0;
+    long long expected = -1;
+    int tallies = 0;
+    std::string why;
+    std::cout << name << "\n";
+    for (const auto& solver : solvers()) {
+        Graph g = build(network);
+        solver.run(g, network);
+        if (tallyAgrees(g, why)) tallies++;
+        else std::cout << "  FAIL  slack tally after " << solver.name << ": " << why << "\n";
+        FlowCheck check = verifyFlow(g, network.reservoirs, network.stations, network.cities);
+        bool ok = check.feasible && (check.maximum || !solver.exact);
+        if (solver.exact && check.maximum) {
+            if (expected < 0) expected = check.value;
+            ok = ok && check.value == expected;
+        }
+        std::cout << "  " << (ok ? "ok    " : "FAIL  ") << solver.name << " " << check.value << ": " << describe(check) << "\n";
+        if (options.verbose && check.maximum) {
+            std::cout << "      source side:";
+            for (const auto& v : check.sourceSide) std::cout << " " << v;
+            std::cout << "\n";
+        }
+        if (!ok && solver.exact) failures++;
+    }
+    failures += verifyCapacityTypes(network, expected);
+    failures += verifySweep(network);
+    failures += verifyDeliverable(network);
+    failures += verifySupply(network);
+    failures += verifySimulation(network, seed);
+    failures += verifyReliability(network, seed);
+
+    std::vector<std::string> components;
+    for (const auto& r : network.reservoirs) components.push_back(r.getCode());
+    for (const auto& s : network.stations) components.push_back(s.getCode());
+    for (const auto& p : network.pipes) components.push_back(p.getPointA() + "-" + p.getPointB());
+
+    FlowModel model(network.reservoirs, network.stations, network.pipes, network.cities);
+    Actions a(network.reservoirs, network.stations, network.cities, network.pipes);
+    std::mt19937_64 random(seed);
+    int agreed = 0;
+    for (int i = 0; i < options.outages; i++) {
+        std::string component = components[random() % components.size()];
+        Graph g = build(network);
+        closeComponent(g, network, component);
+        vector<int> cold = a.maxFlowAllCities(g);
+        if (tallyAgrees(g, why)) tallies++;
+        else std::cout << "  FAIL  slack tally without " << component << ": " << why << "\n";
+        FlowCheck check = verifyFlow(g, network.reservoirs, network.stations, network.cities);
+        vector<int> warm;
+        std::string error;
+        if (!model.solve({component}, warm, error)) {
+            std::cout << "  FAIL  warm start without " << component << ": " << error << "\n";
+            failures++;
+            continue;
+        }
+        long long coldTotal = std::accumulate(cold.begin(), cold.end(), 0LL);
+        long long warmTotal = std::accumulate(warm.begin(), warm.end(), 0LL);
+        if (!check.maximum || coldTotal != check.value || warmTotal != coldTotal) {
+            std::cout << "  FAIL  without " << component << ": cold " << coldTotal << ", warm start " << warmTotal
+                      << ", cold flow " << describe(check) << "\n";
+            failures++;
+            continue;
+        }
+        agreed++;
+    }
+    std::cout << "  " << (agreed == options.outages ? "ok    " : "FAIL  ") << "warm start: " << agreed << " of "
+              << options.outages << " random outages agree with a certified cold solve\n";
+    int solves = (int) solvers().size() + options.outages;
+    std::cout << "  " << (tallies == solves ? "ok    " : "FAIL  ") << "slack tally: " << tallies << " of " << solves
+              << " solves agree with a recount\n";
+    failures += solves - tallies;
+    return failures;
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream iss(list);
+    std::string item;
+    while (getline(iss, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+void usage() {
+    std::cout << "Usage: Water_Supply_Verify [options]\n"
+              << "  --dataset <dir>       bundled dataset to check (default ../Dataset, 'none' to skip)\n"
+              << "  --scales <list>       generated network sizes relative to the dataset (default 0.5,1,2)\n"
+              << "  --topologies <list>   topologies to generate (default grid,tree,scale-free,clusters)\n"
+              << "  --seeds <n>           networks per topology and scale (default 3)\n"
+              << "  --outages <n>         random outages solved warm and cold per network (default 20)\n"
+              << "  --limited-stations <f>  also check every generated network with this share of its stations\n"
+              << "                        given a pumping limit (default 0.25, 0 to skip)\n"
+              << "  --verbose             print the source side of every minimum cut\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        if (arg == "--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--dataset") options.dataset = value;
+            else if (arg == "--scales") {
+                options.scales.clear();
+                for (const auto& s : split(value)) options.scales.push_back(std::stod(s));
+            }
+            else if (arg == "--topologies") {
+                options.topologies.clear();
+                for (const auto& t : split(value)) {
+                    Topology topology;
+                    if (!parseTopology(t, topology)) {
+                        std::cerr << "Unknown topology " << t << "\n";
+                        return 1;
+                    }
+                    options.topologies.push_back(topology);
+                }
+            }
+            else if (arg == "--seeds") options.seeds = std::max(0, std::stoi(value));
+            else if (arg == "--outages") options.outages = std::max(0, std::stoi(value));
+            else if (arg == "--limited-stations") options.limitedStations = std::stod(value);
+            else {
+                std::cerr << "Unknown option " << arg << "\n";
+                usage();
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return 1;
+        }
+    }
+
+    int failures = 0, networks = 0;
+    if (options.dataset != "none") {
+        Network dataset;
+        std::string error;
+        if (!parseDataset(options.dataset, dataset.reservoirs, dataset.stations, dataset.pipes, dataset.cities, error)) {
+            std::cerr << "Could not read the dataset: " << error << "\n";
+            return 1;
+        }
+        failures += verifyNetwork("dataset", dataset, options, 1);
+        networks++;
+    }
+    for (Topology topology : options.topologies) {
+        for (double scale : options.scales) {
+            for (int seed = 1; seed <= options.seeds; seed++) {
+                GeneratorOptions g;
+                g.topology = topology;
+                g.seed = (uint64_t) seed;
+                g.reservoirs = std::max(1, (int) (24 * scale));
+                g.stations = std::max(1, (int) (81 * scale));
+                g.cities = std::max(1, (int) (22 * scale));
+                g.pipes = std::max(1L, (long) (173 * scale));
+                std::ostringstream name;
+                name << topologyName(topology) << " x" << scale << " seed " << seed;
+                failures += verifyNetwork(name.str(), generateNetwork(g), options, (uint64_t) seed);
+                networks++;
+                if (options.limitedStations > 0) {
+                    g.limitedStations = options.limitedStations;
+                    failures += verifyNetwork(name.str() + " limited", generateNetwork(g), options, (uint64_t) seed);
+                    networks++;
+                }
+            }
+        }
+    }
+
+    std::cout << networks << " networks, " << failures << " failure(s)\n";
+    return failures == 0 ? 0 : 1;
+}